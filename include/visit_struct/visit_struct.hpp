@@ -81,6 +81,34 @@ struct common_type {
 
 } // end namespace traits
 
+namespace detail {
+
+// Mini-version of std::integer_sequence (we only require C++11)
+template <typename T, T... Is>
+struct integer_sequence {
+  static VISIT_STRUCT_CONSTEXPR std::size_t size() { return sizeof...(Is); }
+};
+
+template <typename T, std::size_t N, T... Is>
+struct make_integer_sequence_s : make_integer_sequence_s<T, N - 1, static_cast<T>(N - 1), Is...> {};
+
+template <typename T, T... Is>
+struct make_integer_sequence_s<T, 0, Is...> {
+  typedef integer_sequence<T, Is...> type;
+};
+
+template <typename T, std::size_t N>
+using make_integer_sequence = typename make_integer_sequence_s<T, N>::type;
+
+// Sequence of the member indices of a visitable struct
+template <typename S>
+using field_indices = make_integer_sequence<int, traits::visitable<traits::clean_t<S>>::field_count>;
+
+// Helper for evaluating an expression on each element of a pack, in order
+typedef int swallow[];
+
+} // end namespace detail
+
 // Tag for tag dispatch
 template <typename T>
 struct type_c { using type = T; };
@@ -229,6 +257,32 @@ VISIT_STRUCT_CONSTEXPR auto get_name(S &&) -> decltype(get_name<idx, S>()) {
   return get_name<idx, S>();
 }
 
+namespace detail {
+
+inline VISIT_STRUCT_CONSTEXPR bool names_equal(const char * a, const char * b) {
+  return *a == *b && (!*a || names_equal(a + 1, b + 1));
+}
+
+template <typename S, int I, int N = static_cast<int>(visit_struct::field_count<S>())>
+struct member_search {
+  static VISIT_STRUCT_CONSTEXPR int find(const char * name) {
+    return names_equal(visit_struct::get_name<I, S>(), name) ? I : member_search<S, I + 1, N>::find(name);
+  }
+};
+
+template <typename S, int N>
+struct member_search<S, N, N> {
+  static VISIT_STRUCT_CONSTEXPR int find(const char *) { return -1; }
+};
+
+} // end namespace detail
+
+// Index of the member called `name`, or -1
+template <typename S>
+VISIT_STRUCT_CONSTEXPR int member_index(const char * name) {
+  return detail::member_search<S, 0>::find(name);
+}
+
 // Get member pointer, by index
 template <int idx, typename S>
 VISIT_STRUCT_CONSTEXPR auto get_pointer() ->
@@ -287,6 +341,88 @@ VISIT_STRUCT_CONSTEXPR auto get_name(S &&) -> decltype(get_name<S>()) {
   return get_name<S>();
 }
 
+// Compile-time folds
+//
+// The visitation functions above consist of statements, so they can only be
+// constexpr with C++14 extended constexpr. The folds below are written as
+// single return expressions instead, so they can be evaluated in constant
+// expressions with C++11 constexpr as well.
+//
+// The fold function is called as f(acc, name, x) for each member in order, and
+// returns the new accumulator, which has the same type as `init`.
+
+namespace detail {
+
+template <typename S, int idx, int N>
+struct fold_helper {
+  using next = fold_helper<S, idx + 1, N>;
+
+  template <typename F, typename T>
+  static VISIT_STRUCT_CONSTEXPR T types(F f, T acc) {
+    return next::types(f, f(acc, visit_struct::get_name<idx, S>(), type_c<type_at<idx, S>>{}));
+  }
+
+  template <typename F, typename T>
+  static VISIT_STRUCT_CONSTEXPR T pointers(F f, T acc) {
+    return next::pointers(f, f(acc, visit_struct::get_name<idx, S>(), visit_struct::get_pointer<idx, S>()));
+  }
+
+  template <typename F, typename T>
+  static VISIT_STRUCT_CONSTEXPR T values(F f, T acc, const S & s) {
+    return next::values(f, f(acc, visit_struct::get_name<idx, S>(), visit_struct::get<idx>(s)), s);
+  }
+};
+
+template <typename S, int N>
+struct fold_helper<S, N, N> {
+  template <typename F, typename T>
+  static VISIT_STRUCT_CONSTEXPR T types(F, T acc) { return acc; }
+
+  template <typename F, typename T>
+  static VISIT_STRUCT_CONSTEXPR T pointers(F, T acc) { return acc; }
+
+  template <typename F, typename T>
+  static VISIT_STRUCT_CONSTEXPR T values(F, T acc, const S &) { return acc; }
+};
+
+template <typename S>
+using fold_all = fold_helper<traits::clean_t<S>, 0, static_cast<int>(traits::visitable<traits::clean_t<S>>::field_count)>;
+
+} // end namespace detail
+
+// Fold over the types (visit_struct::type_c<...>) of the registered members
+template <typename S, typename F, typename T>
+VISIT_STRUCT_CONSTEXPR auto fold_types(F f, T init) ->
+  typename std::enable_if<
+             traits::is_visitable<traits::clean_t<S>>::value,
+             T
+           >::type
+{
+  return detail::fold_all<S>::types(f, init);
+}
+
+// Fold over the member pointers of the registered members
+template <typename S, typename F, typename T>
+VISIT_STRUCT_CONSTEXPR auto fold_pointers(F f, T init) ->
+  typename std::enable_if<
+             traits::is_visitable<traits::clean_t<S>>::value,
+             T
+           >::type
+{
+  return detail::fold_all<S>::pointers(f, init);
+}
+
+// Fold over the values of the registered members of an instance
+template <typename S, typename F, typename T>
+VISIT_STRUCT_CONSTEXPR auto fold(const S & s, F f, T init) ->
+  typename std::enable_if<
+             traits::is_visitable<S>::value,
+             T
+           >::type
+{
+  return detail::fold_all<S>::values(f, init, s);
+}
+
 /***
  * To implement the VISITABLE_STRUCT macro, we need a map-macro, which can take
  * the name of a macro and some other arguments, and apply that macro to each other argument.
@@ -0,0 +1,296 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_ARENA_HPP_INCLUDED
+#define VISIT_STRUCT_ARENA_HPP_INCLUDED
+
+/***
+ * Arena allocation for deserialized strings and vectors.
+ *
+ * `visit_struct::arena` hands out memory from large blocks and never frees
+ * individual allocations. Everything is given back at once by `release()`,
+ * which keeps the memory for reuse, or by the destructor.
+ *
+ * Members declared with `arena_allocator` (`arena_string`, `arena_vector<T>`)
+ * allocate from the arena of the `binary::source` they are read from:
+ *
+ *   struct quote {
+ *     visit_struct::arena_string symbol;
+ *     visit_struct::arena_vector<double> levels;
+ *   };
+ *
+ *   visit_struct::arena memory;
+ *   visit_struct::binary::source in{data, size, &memory};
+ *   while (in.remaining()) {
+ *     visit_struct::binary::deserialize(in, q);   // no calls to operator new
+ *     ...
+ *   }
+ *   memory.release();
+ *
+ * Such members must not outlive the arena. Without an arena, `arena_allocator`
+ * uses operator new and delete, so the same types work everywhere.
+ *
+ * Each `release()` starts a new generation of the arena, and allocators from
+ * an older generation compare unequal to current ones. Deserializing into an
+ * object again after a release therefore rebuilds its containers in fresh
+ * memory, without touching the released memory. Otherwise, containers from
+ * before a release must not be used; objects which will be destroyed or
+ * reused in other ways must be reset before `release()`, unless their
+ * containers only hold trivially destructible elements.
+ *
+ * With C++17 `<memory_resource>`, `arena` is also a `std::pmr::memory_resource`,
+ * and `std::pmr` strings and vectors are bound to it in the same way. Their
+ * allocators carry no generation, so they must always be reset before
+ * `release()`.
+ *
+ * `binary::uses_arena<T>()` tells whether any member of T, at any depth, can
+ * allocate from an arena.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if defined(__has_include)
+#  if __has_include(<memory_resource>) && (__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#    define VISIT_STRUCT_HAS_PMR
+#    include <memory_resource>
+#  endif
+#endif
+
+namespace visit_struct {
+
+class arena
+#ifdef VISIT_STRUCT_HAS_PMR
+  : public std::pmr::memory_resource
+#endif
+{
+  // Header of a block, followed by its memory
+  struct block {
+    block * next;
+    std::size_t size;
+  };
+
+  block * head_;
+  char * pos_;
+  char * end_;
+  std::size_t next_size_;
+  std::size_t used_;
+  std::uint64_t generation_;
+
+  static char * data(block * b) { return reinterpret_cast<char *>(b + 1); }
+
+  static std::uintptr_t align_up(const char * p, std::size_t align) {
+    return (reinterpret_cast<std::uintptr_t>(p) + align - 1) & ~std::uintptr_t(align - 1);
+  }
+
+  void add_block(std::size_t min_size) {
+    std::size_t size = next_size_;
+    while (size < min_size) { size *= 2; }
+    block * b = static_cast<block *>(::operator new(sizeof(block) + size));
+    b->next = head_;
+    b->size = size;
+    head_ = b;
+    pos_ = data(b);
+    end_ = pos_ + size;
+    next_size_ = size * 2;
+  }
+
+  void free_blocks(block * b) {
+    while (b) {
+      block * next = b->next;
+      ::operator delete(b);
+      b = next;
+    }
+  }
+
+public:
+  explicit arena(std::size_t block_size = 4096)
+    : head_(nullptr)
+    , pos_(nullptr)
+    , end_(nullptr)
+    , next_size_(block_size ? block_size : 1)
+    , used_(0)
+    , generation_(0)
+  {}
+
+  arena(const arena &) = delete;
+  arena & operator = (const arena &) = delete;
+
+  ~arena() { this->free_blocks(head_); }
+
+  void * allocate(std::size_t size, std::size_t align = alignof(std::max_align_t)) {
+    std::uintptr_t p = align_up(pos_, align);
+    if (!pos_ || p > reinterpret_cast<std::uintptr_t>(end_) || reinterpret_cast<std::uintptr_t>(end_) - p < size) {
+      this->add_block(size + align);
+      p = align_up(pos_, align);
+    }
+    pos_ = reinterpret_cast<char *>(p + size);
+    used_ += size;
+    return reinterpret_cast<void *>(p);
+  }
+
+  // Give back all memory. Several blocks are replaced by one block of their
+  // total size, so that repeating the same work allocates no more blocks.
+  void release() {
+    ++generation_;
+    if (!head_) { return; }
+    if (head_->next) {
+      const std::size_t total = this->reserved();
+      this->free_blocks(head_);
+      head_ = nullptr;
+      next_size_ = total;
+      this->add_block(total);
+    } else {
+      pos_ = data(head_);
+    }
+    used_ = 0;
+  }
+
+  // Bytes handed out since construction or the last release
+  std::size_t used() const { return used_; }
+
+  // Number of releases so far
+  std::uint64_t generation() const { return generation_; }
+
+  // Bytes held in blocks
+  std::size_t reserved() const {
+    std::size_t result = 0;
+    for (block * b = head_; b; b = b->next) { result += b->size; }
+    return result;
+  }
+
+#ifdef VISIT_STRUCT_HAS_PMR
+private:
+  void * do_allocate(std::size_t size, std::size_t align) override { return this->allocate(size, align); }
+  void do_deallocate(void *, std::size_t, std::size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override { return this == &other; }
+#endif
+};
+
+// Allocator drawing from an arena, or from operator new when it has none.
+// Deallocation from an arena does nothing. Allocators are equal if they use the
+// same arena, in the same generation.
+template <typename T>
+class arena_allocator {
+  arena * arena_;
+  std::uint64_t generation_;
+
+public:
+  typedef T value_type;
+  typedef std::true_type propagate_on_container_copy_assignment;
+  typedef std::true_type propagate_on_container_move_assignment;
+  typedef std::true_type propagate_on_container_swap;
+
+  arena_allocator() noexcept : arena_(nullptr), generation_(0) {}
+  arena_allocator(arena * a) noexcept : arena_(a), generation_(a ? a->generation() : 0) {}
+
+  template <typename U>
+  arena_allocator(const arena_allocator<U> & other) noexcept : arena_(other.resource()), generation_(other.generation()) {}
+
+  arena * resource() const noexcept { return arena_; }
+  std::uint64_t generation() const noexcept { return generation_; }
+
+  // Whether the arena was released since this allocator was made
+  bool released() const noexcept { return arena_ && arena_->generation() != generation_; }
+
+  T * allocate(std::size_t n) {
+    if (n > std::numeric_limits<std::size_t>::max() / sizeof(T)) { throw std::bad_alloc(); }
+    if (!arena_) { return static_cast<T *>(::operator new(n * sizeof(T))); }
+    return static_cast<T *>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T * p, std::size_t) noexcept {
+    if (!arena_) { ::operator delete(p); }
+  }
+
+  template <typename U>
+  friend bool operator == (const arena_allocator & a, const arena_allocator<U> & b) {
+    return a.resource() == b.resource() && a.generation() == b.generation();
+  }
+
+  template <typename U>
+  friend bool operator != (const arena_allocator & a, const arena_allocator<U> & b) { return !(a == b); }
+};
+
+typedef std::basic_string<char, std::char_traits<char>, arena_allocator<char>> arena_string;
+
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+namespace binary {
+
+template <typename T>
+struct arena_binding<arena_allocator<T>> : std::true_type {
+  static arena_allocator<T> make(arena * a) { return arena_allocator<T>(a); }
+  static bool released(const arena_allocator<T> & a) { return a.released(); }
+};
+
+#ifdef VISIT_STRUCT_HAS_PMR
+template <typename T>
+struct arena_binding<std::pmr::polymorphic_allocator<T>> : std::true_type {
+  static std::pmr::polymorphic_allocator<T> make(arena * a) { return std::pmr::polymorphic_allocator<T>(a); }
+  static bool released(const std::pmr::polymorphic_allocator<T> &) { return false; }
+};
+#endif
+
+namespace detail {
+
+// Whether a type, or anything it contains, can allocate from an arena
+template <typename T, typename ENABLE = void>
+struct arena_aware : std::false_type {};
+
+template <typename C, typename Tr, typename A>
+struct arena_aware<std::basic_string<C, Tr, A>> : arena_binding<A> {};
+
+template <typename T, typename A>
+struct arena_aware<std::vector<T, A>> : std::integral_constant<bool, arena_binding<A>::value || arena_aware<T>::value> {};
+
+template <typename T, std::size_t N>
+struct arena_aware<T[N]> : arena_aware<T> {};
+
+template <typename T, std::size_t N>
+struct arena_aware<std::array<T, N>> : arena_aware<T> {};
+
+struct arena_aware_step {
+  template <typename T>
+  VISIT_STRUCT_CONSTEXPR bool operator()(bool acc, const char *, type_c<T>) const {
+    return acc || arena_aware<traits::clean_t<T>>::value;
+  }
+};
+
+template <typename T>
+struct arena_aware<T, typename std::enable_if<traits::is_visitable<T>::value>::type>
+  : std::integral_constant<bool, visit_struct::fold_types<T>(arena_aware_step{}, false)> {};
+
+} // end namespace detail
+
+template <typename T>
+VISIT_STRUCT_CONSTEXPR bool uses_arena() {
+  return detail::arena_aware<traits::clean_t<T>>::value;
+}
+
+// Deserialize one object which must occupy the whole buffer, allocating its
+// members from `memory`
+template <typename T>
+bool deserialize(const std::string & buffer, T & t, arena & memory) {
+  static_assert(binary::uses_arena<T>(), "no member of this type can allocate from an arena");
+  source in{buffer.data(), buffer.size(), &memory};
+  return binary::deserialize(in, t) && !in.remaining();
+}
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_ARENA_HPP_INCLUDED
@@ -0,0 +1,648 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_ASYNC_WRITER_HPP_INCLUDED
+#define VISIT_STRUCT_ASYNC_WRITER_HPP_INCLUDED
+
+/***
+ * Asynchronous, batched persistence of visitable records.
+ *
+ * `visit_struct::binary::async_writer` serializes records with the binary
+ * codecs directly into a small pool of fixed buffers. When a buffer is full
+ * (or on `flush()`) it is submitted as a single positioned write, and the
+ * caller continues filling the next buffer while the write is in flight.
+ *
+ * On Linux the writes are submitted through io_uring, with the buffer pool
+ * registered with the kernel when possible. Elsewhere, or when io_uring is
+ * unavailable at runtime (old kernel, seccomp, ...), a background thread
+ * performs the writes with `pwrite`. Defining VISIT_STRUCT_NO_IO_URING
+ * removes the io_uring path entirely. If io_uring fails while writes are in
+ * flight, those writes complete with the error and the writer continues with
+ * the background thread.
+ *
+ * Each record may carry a completion callback, which receives 0 or a negative
+ * errno value. Callbacks run on the thread which owns the writer, from within
+ * `write`, `poll` or `drain`, never concurrently. Records are laid out in the
+ * file in the order they were written, but buffers may complete out of order.
+ *
+ * With `datasync` enabled, each buffer is followed by `fdatasync` (linked to
+ * the write on io_uring) before its callbacks run, so syncing is pipelined
+ * with serialization of the following records.
+ *
+ * This header is POSIX only, and an async_writer must only be used from one
+ * thread at a time.
+ */
+
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#if defined(__linux__) && !defined(VISIT_STRUCT_NO_IO_URING)
+#  include <sys/syscall.h>
+#  if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter) && defined(__NR_io_uring_register)
+#    define VISIT_STRUCT_HAS_IO_URING
+#    include <linux/io_uring.h>
+#    include <sys/mman.h>
+#  endif
+#endif
+
+namespace visit_struct {
+
+namespace binary {
+
+struct async_writer_options {
+  // Size of each buffer. Records larger than this are written on their own.
+  std::size_t buffer_size = 64 * 1024;
+  // Number of buffers, i.e. the maximum number of writes in flight. At least 1.
+  unsigned queue_depth = 8;
+  // Follow every write with fdatasync before reporting completion
+  bool datasync = false;
+  // Try io_uring before falling back to a pwrite thread
+  bool use_io_uring = true;
+};
+
+namespace detail {
+
+// Sink which fills a fixed buffer and records overflow instead of growing
+class buffer_sink {
+  char * data_;
+  std::size_t capacity_;
+  std::size_t used_;
+  bool overflow_;
+
+public:
+  buffer_sink(char * data, std::size_t capacity)
+    : data_(data)
+    , capacity_(capacity)
+    , used_(0)
+    , overflow_(false)
+  {}
+
+  void put(const void * data, std::size_t size) {
+    if (overflow_ || size > capacity_ - used_) {
+      overflow_ = true;
+      return;
+    }
+    if (size) { std::memcpy(data_ + used_, data, size); }
+    used_ += size;
+  }
+
+  void put_range(const void * data, std::size_t size) {
+    this->put(data, size);
+  }
+
+  std::size_t used() const { return used_; }
+  bool overflow() const { return overflow_; }
+};
+
+// One buffer and the bookkeeping for the write which persists it
+struct write_batch {
+  char * data = nullptr;
+  std::size_t capacity = 0;
+  std::size_t size = 0;
+  std::string oversize;  // storage for a single record larger than a buffer
+  int buf_index = -1;    // index of the registered buffer, if any
+  off_t offset = 0;
+  std::size_t done = 0;
+  int error = 0;
+  int pending = 0;       // outstanding completions
+  iovec iov;
+  std::vector<std::function<void(int)>> callbacks;
+
+  void reset() {
+    size = 0;
+    done = 0;
+    error = 0;
+    pending = 0;
+    oversize.clear();
+    callbacks.clear();
+  }
+};
+
+#ifdef VISIT_STRUCT_HAS_IO_URING
+
+// Minimal io_uring wrapper, using the raw system calls.
+class uring {
+  int fd_ = -1;
+  void * sq_ptr_ = MAP_FAILED;
+  void * cq_ptr_ = MAP_FAILED;
+  std::size_t sq_size_ = 0;
+  std::size_t cq_size_ = 0;
+  io_uring_sqe * sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+  std::size_t sqes_size_ = 0;
+
+  unsigned * sq_tail_ = nullptr;
+  unsigned * sq_array_ = nullptr;
+  unsigned sq_mask_ = 0;
+  unsigned * cq_head_ = nullptr;
+  unsigned * cq_tail_ = nullptr;
+  io_uring_cqe * cqes_ = nullptr;
+  unsigned cq_mask_ = 0;
+  unsigned local_tail_ = 0;
+  unsigned to_submit_ = 0;
+
+public:
+  uring() = default;
+  uring(const uring &) = delete;
+  uring & operator = (const uring &) = delete;
+
+  ~uring() {
+    if (sqes_ != MAP_FAILED) { ::munmap(sqes_, sqes_size_); }
+    if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) { ::munmap(cq_ptr_, cq_size_); }
+    if (sq_ptr_ != MAP_FAILED) { ::munmap(sq_ptr_, sq_size_); }
+    if (fd_ >= 0) { ::close(fd_); }
+  }
+
+  // Returns false if io_uring is not usable here
+  bool init(unsigned entries) {
+    io_uring_params p;
+    std::memset(&p, 0, sizeof(p));
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &p));
+    if (fd_ < 0) { return false; }
+
+    sq_size_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_size_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+    const bool single_mmap = p.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap && cq_size_ > sq_size_) { sq_size_ = cq_size_; }
+
+    sq_ptr_ = ::mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sq_ptr_ == MAP_FAILED) { return false; }
+    cq_ptr_ = single_mmap ? sq_ptr_
+                          : ::mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+    if (cq_ptr_ == MAP_FAILED) { return false; }
+
+    sqes_size_ = p.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe *>(::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) { return false; }
+
+    char * sq = static_cast<char *>(sq_ptr_);
+    char * cq = static_cast<char *>(cq_ptr_);
+    sq_tail_ = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+    sq_array_ = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+    sq_mask_ = *reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+    cq_head_ = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+    cq_mask_ = *reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+    local_tail_ = *sq_tail_;
+    return true;
+  }
+
+  bool register_buffers(const iovec * iov, unsigned count) {
+    return ::syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov, count) == 0;
+  }
+
+  // Next free submission entry, zeroed. The caller guarantees there is room.
+  io_uring_sqe * get_sqe() {
+    unsigned idx = local_tail_ & sq_mask_;
+    io_uring_sqe * sqe = &sqes_[idx];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sq_array_[idx] = idx;
+    ++local_tail_;
+    ++to_submit_;
+    return sqe;
+  }
+
+  // Withdraw up to the last `count` queued entries, as far as the kernel has
+  // not consumed them. Returns the number withdrawn.
+  unsigned unqueue(unsigned count) {
+    const unsigned n = count < to_submit_ ? count : to_submit_;
+    local_tail_ -= n;
+    to_submit_ -= n;
+    __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+    return n;
+  }
+
+  // Publish queued entries and optionally wait for completions.
+  // Returns false on a hard error (errno is set).
+  bool enter(unsigned min_complete) {
+    __atomic_store_n(sq_tail_, local_tail_, __ATOMIC_RELEASE);
+    const unsigned flags = min_complete ? IORING_ENTER_GETEVENTS : 0;
+    for (;;) {
+      long r = ::syscall(__NR_io_uring_enter, fd_, to_submit_, min_complete, flags, nullptr, 0);
+      if (r < 0) {
+        if (errno == EINTR) { continue; }
+        // Completion queue is backed up, the caller should reap first
+        if ((errno == EAGAIN || errno == EBUSY) && min_complete) { return true; }
+        if (errno == EAGAIN || errno == EBUSY) { continue; }
+        return false;
+      }
+      const unsigned consumed = static_cast<unsigned>(r);
+      to_submit_ -= consumed < to_submit_ ? consumed : to_submit_;
+      if (!to_submit_ || min_complete) { return true; }
+    }
+  }
+
+  // Call f(user_data, res) for every available completion
+  template <typename F>
+  unsigned reap(F && f) {
+    unsigned head = *cq_head_;
+    unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    while (head != tail) {
+      const io_uring_cqe & cqe = cqes_[head & cq_mask_];
+      f(cqe.user_data, cqe.res);
+      ++head;
+      ++count;
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    return count;
+  }
+};
+
+#endif // VISIT_STRUCT_HAS_IO_URING
+
+// Fallback: a background thread which performs the writes with pwrite
+class pwrite_worker {
+  struct job {
+    int id;
+    int fd;
+    const char * data;
+    std::size_t size;
+    off_t offset;
+    bool datasync;
+  };
+
+  std::mutex mutex_;
+  std::condition_variable work_cv_;
+  std::condition_variable done_cv_;
+  std::deque<job> jobs_;
+  std::vector<std::pair<int, int>> done_;
+  bool stop_ = false;
+  std::thread thread_;
+
+  static int perform(const job & j) {
+    std::size_t written = 0;
+    while (written < j.size) {
+      ssize_t r = ::pwrite(j.fd, j.data + written, j.size - written, j.offset + static_cast<off_t>(written));
+      if (r < 0) {
+        if (errno == EINTR) { continue; }
+        return -errno;
+      }
+      if (r == 0) { return -EIO; }
+      written += static_cast<std::size_t>(r);
+    }
+    if (j.datasync && ::fdatasync(j.fd) < 0) { return -errno; }
+    return 0;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      work_cv_.wait(lock, [this] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) { return; }
+      job j = jobs_.front();
+      jobs_.pop_front();
+
+      lock.unlock();
+      int result = perform(j);
+      lock.lock();
+
+      done_.emplace_back(j.id, result);
+      done_cv_.notify_one();
+    }
+  }
+
+public:
+  pwrite_worker() : thread_([this] { this->run(); }) {}
+
+  ~pwrite_worker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_cv_.notify_one();
+    thread_.join();
+  }
+
+  void submit(int id, int fd, const char * data, std::size_t size, off_t offset, bool datasync) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      jobs_.push_back(job{id, fd, data, size, offset, datasync});
+    }
+    work_cv_.notify_one();
+  }
+
+  // Call f(id, result) for finished jobs, waiting for at least one if `wait`
+  template <typename F>
+  void reap(bool wait, F && f) {
+    std::vector<std::pair<int, int>> finished;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (wait) { done_cv_.wait(lock, [this] { return !done_.empty(); }); }
+      finished.swap(done_);
+    }
+    for (const auto & p : finished) { f(p.first, p.second); }
+  }
+};
+
+} // end namespace detail
+
+// Whether io_uring can be set up in this process
+inline bool io_uring_available() {
+#ifdef VISIT_STRUCT_HAS_IO_URING
+  detail::uring ring;
+  return ring.init(2);
+#else
+  return false;
+#endif
+}
+
+class async_writer {
+public:
+  typedef std::function<void(int)> callback;
+
+  // Writes begin at `offset` in the file, and continue contiguously
+  explicit async_writer(int fd, off_t offset = 0, async_writer_options options = async_writer_options())
+    : fd_(fd)
+    , offset_(offset)
+    , options_(options)
+    , storage_(new char[options.buffer_size * options.queue_depth])
+    , batches_(options.queue_depth + 1)
+  {
+    if (!options_.queue_depth) { throw std::invalid_argument("async_writer: queue_depth must be at least 1"); }
+
+    for (unsigned i = 0; i < options_.queue_depth; ++i) {
+      detail::write_batch & b = batches_[i];
+      b.data = storage_.get() + i * options_.buffer_size;
+      b.capacity = options_.buffer_size;
+      free_.push_back(static_cast<int>(i));
+    }
+    oversize_free_ = true;
+
+#ifdef VISIT_STRUCT_HAS_IO_URING
+    if (options_.use_io_uring) {
+      std::unique_ptr<detail::uring> ring(new detail::uring);
+      // Each batch has at most a write and an fsync in flight
+      if (ring->init(2 * (options_.queue_depth + 1))) {
+        std::vector<iovec> iov;
+        for (unsigned i = 0; i < options_.queue_depth; ++i) {
+          iov.push_back(iovec{batches_[i].data, batches_[i].capacity});
+        }
+        if (ring->register_buffers(iov.data(), static_cast<unsigned>(iov.size()))) {
+          for (unsigned i = 0; i < options_.queue_depth; ++i) { batches_[i].buf_index = static_cast<int>(i); }
+        }
+        ring_ = std::move(ring);
+      }
+    }
+#endif
+    if (!this->uses_io_uring()) { worker_.reset(new detail::pwrite_worker); }
+  }
+
+  async_writer(const async_writer &) = delete;
+  async_writer & operator = (const async_writer &) = delete;
+
+  // Waits for outstanding writes, running their callbacks
+  ~async_writer() {
+    this->drain();
+  }
+
+  // Serialize a record into the current buffer, submitting the buffer if it is full
+  template <typename T>
+  void write(const T & record, callback cb = callback()) {
+    for (;;) {
+      detail::write_batch & b = batches_[this->current()];
+      detail::buffer_sink sink{b.data + b.size, b.capacity - b.size};
+      binary::serialize(record, sink);
+      if (!sink.overflow()) {
+        b.size += sink.used();
+        if (cb) { b.callbacks.push_back(std::move(cb)); }
+        return;
+      }
+      if (!b.size) { break; }
+      this->flush();
+    }
+
+    // Record does not fit in an empty buffer, give it storage of its own
+    while (!oversize_free_) { this->reap(true); }
+    oversize_free_ = false;
+    detail::write_batch & b = batches_[options_.queue_depth];
+    binary::serialize(record, b.oversize);
+    b.data = &b.oversize[0];
+    b.size = b.capacity = b.oversize.size();
+    if (cb) { b.callbacks.push_back(std::move(cb)); }
+    this->submit(static_cast<int>(options_.queue_depth));
+  }
+
+  // Submit the partially filled buffer, if any
+  void flush() {
+    if (current_ >= 0 && batches_[current_].size) {
+      int id = current_;
+      current_ = -1;
+      this->submit(id);
+    }
+  }
+
+  // Run callbacks of completed writes without blocking
+  void poll() {
+    this->reap(false);
+  }
+
+  // Submit everything and wait for all writes to complete
+  void drain() {
+    this->flush();
+    while (in_flight_) { this->reap(true); }
+  }
+
+  bool uses_io_uring() const {
+#ifdef VISIT_STRUCT_HAS_IO_URING
+    return static_cast<bool>(ring_);
+#else
+    return false;
+#endif
+  }
+
+  // File offset at which the next submitted buffer will be written
+  off_t offset() const { return offset_; }
+
+private:
+  int fd_;
+  off_t offset_;
+  async_writer_options options_;
+  std::unique_ptr<char[]> storage_;
+  std::vector<detail::write_batch> batches_;  // the last one is for oversize records
+  std::vector<int> free_;
+  bool oversize_free_;
+  int current_ = -1;
+  unsigned in_flight_ = 0;
+#ifdef VISIT_STRUCT_HAS_IO_URING
+  std::unique_ptr<detail::uring> ring_;
+#endif
+  std::unique_ptr<detail::pwrite_worker> worker_;
+
+  // Index of the buffer being filled, waiting for one to be free if necessary
+  int current() {
+    if (current_ < 0) {
+      while (free_.empty()) { this->reap(true); }
+      current_ = free_.back();
+      free_.pop_back();
+    }
+    return current_;
+  }
+
+  void submit(int id) {
+    detail::write_batch & b = batches_[id];
+    b.offset = offset_;
+    offset_ += static_cast<off_t>(b.size);
+    ++in_flight_;
+#ifdef VISIT_STRUCT_HAS_IO_URING
+    if (ring_) {
+      this->submit_uring(id);
+      return;
+    }
+#endif
+    worker_->submit(id, fd_, b.data, b.size, b.offset, options_.datasync);
+  }
+
+#ifdef VISIT_STRUCT_HAS_IO_URING
+  // Queue a write of the unwritten part of the batch, and the fsync after it
+  void submit_uring(int id) {
+    detail::write_batch & b = batches_[id];
+    const std::size_t len = b.size - b.done;
+    const unsigned entries = options_.datasync ? 2 : 1;
+
+    io_uring_sqe * sqe = ring_->get_sqe();
+    sqe->fd = fd_;
+    sqe->off = static_cast<__u64>(b.offset + static_cast<off_t>(b.done));
+    sqe->user_data = static_cast<__u64>(id) << 1;
+    if (b.buf_index >= 0) {
+      sqe->opcode = IORING_OP_WRITE_FIXED;
+      sqe->addr = static_cast<__u64>(reinterpret_cast<std::uintptr_t>(b.data + b.done));
+      sqe->len = static_cast<__u32>(len);
+      sqe->buf_index = static_cast<__u16>(b.buf_index);
+    } else {
+      b.iov.iov_base = b.data + b.done;
+      b.iov.iov_len = len;
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->addr = static_cast<__u64>(reinterpret_cast<std::uintptr_t>(&b.iov));
+      sqe->len = 1;
+    }
+    ++b.pending;
+
+    if (options_.datasync) {
+      sqe->flags |= IOSQE_IO_LINK;
+      io_uring_sqe * sync = ring_->get_sqe();
+      sync->opcode = IORING_OP_FSYNC;
+      sync->fd = fd_;
+      sync->fsync_flags = IORING_FSYNC_DATASYNC;
+      sync->user_data = (static_cast<__u64>(id) << 1) | 1;
+      ++b.pending;
+    }
+
+    if (!ring_->enter(0)) {
+      // Take back the entries the kernel did not consume, so that they are
+      // not submitted later for a finished batch. Any it did consume complete
+      // as usual, and finish the batch with the error.
+      b.error = -errno;
+      b.pending -= ring_->unqueue(entries);
+      if (!b.pending) { this->finish(id); }
+    }
+  }
+
+  void on_uring_completion(__u64 user_data, int res) {
+    const int id = static_cast<int>(user_data >> 1);
+    const bool is_sync = user_data & 1;
+    detail::write_batch & b = batches_[id];
+    --b.pending;
+
+    if (!is_sync) {
+      if (res < 0) {
+        if (!b.error) { b.error = res; }
+      } else if (res == 0 && b.done < b.size) {
+        if (!b.error) { b.error = -EIO; }
+      } else {
+        b.done += static_cast<std::size_t>(res);
+      }
+    } else if (res < 0 && res != -ECANCELED && !b.error) {
+      b.error = res;
+    }
+
+    if (b.pending) { return; }
+    if (!b.error && b.done < b.size) {
+      // Short write: the linked fsync was cancelled, go again with the rest
+      this->submit_uring(id);
+      return;
+    }
+    this->finish(id);
+  }
+
+  // io_uring_enter failed hard: close the ring, which cancels what the kernel
+  // still holds, fail the batches in flight and continue on the worker thread
+  void abandon_uring(int error) {
+    ring_.reset();
+    worker_.reset(new detail::pwrite_worker);
+    for (unsigned id = 0; id <= options_.queue_depth; ++id) {
+      detail::write_batch & b = batches_[id];
+      if (!b.pending) { continue; }
+      b.pending = 0;
+      if (!b.error) { b.error = error; }
+      this->finish(static_cast<int>(id));
+    }
+  }
+#endif
+
+  void reap(bool wait) {
+#ifdef VISIT_STRUCT_HAS_IO_URING
+    if (ring_) {
+      auto handler = [this](__u64 user_data, int res) { this->on_uring_completion(user_data, res); };
+      if (!ring_->reap(handler) && wait && in_flight_) {
+        if (ring_->enter(1)) {
+          ring_->reap(handler);
+        } else {
+          this->abandon_uring(-errno);
+        }
+      }
+      return;
+    }
+#endif
+    if (!wait || in_flight_) {
+      worker_->reap(wait, [this](int id, int res) {
+        batches_[id].error = res;
+        this->finish(id);
+      });
+    }
+  }
+
+  // Run the callbacks of a batch and return it to the pool
+  void finish(int id) {
+    detail::write_batch & b = batches_[id];
+    std::vector<callback> callbacks;
+    callbacks.swap(b.callbacks);
+    const int result = b.error;
+
+    b.reset();
+    if (id == static_cast<int>(options_.queue_depth)) {
+      oversize_free_ = true;
+    } else {
+      free_.push_back(id);
+    }
+    --in_flight_;
+
+    for (callback & cb : callbacks) { cb(result); }
+  }
+};
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_ASYNC_WRITER_HPP_INCLUDED
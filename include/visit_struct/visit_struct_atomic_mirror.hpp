@@ -0,0 +1,145 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_ATOMIC_MIRROR_HPP_INCLUDED
+#define VISIT_STRUCT_ATOMIC_MIRROR_HPP_INCLUDED
+
+/***
+ * `visit_struct::atomic_mirror<S>` holds a `std::atomic<T>` for each
+ * registered member of type T of a visitable structure, so that the members
+ * can be updated from many threads without locks.
+ *
+ * Each member is atomic on its own: `load_snapshot` reads the members one by
+ * one, so a snapshot taken during concurrent updates may combine values from
+ * different moments. Use `seqlock<S>` if snapshots must be consistent.
+ *
+ * With `atomic_mirror<S, true>`, each member is aligned to its own cache line,
+ * so that threads updating different members don't contend.
+ *
+ * Members must be trivially copyable. `add` requires arithmetic members.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_cache_line.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+namespace visit_struct {
+
+namespace detail {
+
+template <typename T, bool Padded>
+struct mirror_cell {
+  std::atomic<T> value;
+};
+
+template <typename T>
+struct alignas(VISIT_STRUCT_CACHE_LINE_SIZE) mirror_cell<T, true> {
+  std::atomic<T> value;
+};
+
+template <typename T>
+void atomic_add(std::atomic<T> & a, T delta, std::memory_order order,
+                typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value>::type * = nullptr) {
+  a.fetch_add(delta, order);
+}
+
+template <typename T>
+void atomic_add(std::atomic<T> & a, T delta, std::memory_order order,
+                typename std::enable_if<std::is_floating_point<T>::value>::type * = nullptr) {
+  T current = a.load(std::memory_order_relaxed);
+  while (!a.compare_exchange_weak(current, current + delta, order, std::memory_order_relaxed)) {}
+}
+
+template <typename S, bool Padded, typename Seq = field_indices<S>>
+struct mirror_cells;
+
+template <typename S, bool Padded, int... Is>
+struct mirror_cells<S, Padded, integer_sequence<int, Is...>> {
+  typedef std::tuple<mirror_cell<type_at<Is, S>, Padded>...> type;
+
+  static void store(type & cells, const S & s, std::memory_order order) {
+    (void) swallow{ 0, (std::get<Is>(cells).value.store(visit_struct::get<Is>(s), order), 0)... };
+  }
+
+  static void load(const type & cells, S & s, std::memory_order order) {
+    (void) swallow{ 0, (visit_struct::get<Is>(s) = std::get<Is>(cells).value.load(order), 0)... };
+  }
+
+  static void add(type & cells, const S & s, std::memory_order order) {
+    (void) swallow{ 0, (atomic_add(std::get<Is>(cells).value, visit_struct::get<Is>(s), order), 0)... };
+  }
+
+  template <typename V>
+  static void visit(type & cells, V & v) {
+    (void) swallow{ 0, (v(visit_struct::get_name<Is, S>(), std::get<Is>(cells).value), 0)... };
+  }
+
+  template <typename V>
+  static void visit(const type & cells, V & v) {
+    (void) swallow{ 0, (v(visit_struct::get_name<Is, S>(), std::get<Is>(cells).value), 0)... };
+  }
+};
+
+} // end namespace detail
+
+template <typename S, bool Padded = false>
+class atomic_mirror {
+  static_assert(traits::is_visitable<S>::value, "atomic_mirror requires a visitable structure");
+
+  typedef detail::mirror_cells<S, Padded> cells;
+
+  typename cells::type cells_;
+
+public:
+  explicit atomic_mirror(const S & s = S{}) {
+    cells::store(cells_, s, std::memory_order_relaxed);
+  }
+
+  atomic_mirror(const atomic_mirror &) = delete;
+  atomic_mirror & operator = (const atomic_mirror &) = delete;
+
+  // The atomic for member `idx`
+  template <int idx>
+  std::atomic<type_at<idx, S>> & get() { return std::get<idx>(cells_).value; }
+
+  template <int idx>
+  const std::atomic<type_at<idx, S>> & get() const { return std::get<idx>(cells_).value; }
+
+  // Read every member
+  void load_snapshot(S & s, std::memory_order order = std::memory_order_relaxed) const {
+    cells::load(cells_, s, order);
+  }
+
+  S load_snapshot(std::memory_order order = std::memory_order_relaxed) const {
+    S s;
+    this->load_snapshot(s, order);
+    return s;
+  }
+
+  // Write every member
+  void store_from(const S & s, std::memory_order order = std::memory_order_relaxed) {
+    cells::store(cells_, s, order);
+  }
+
+  // Atomically add each member of `delta` to the corresponding member
+  void add(const S & delta, std::memory_order order = std::memory_order_relaxed) {
+    cells::add(cells_, delta, order);
+  }
+
+  // Call v(name, std::atomic<T> &) for each member
+  template <typename V>
+  void visit(V && v) { cells::visit(cells_, v); }
+
+  template <typename V>
+  void visit(V && v) const { cells::visit(cells_, v); }
+};
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_ATOMIC_MIRROR_HPP_INCLUDED
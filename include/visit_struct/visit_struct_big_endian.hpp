@@ -0,0 +1,608 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_BIG_ENDIAN_HPP_INCLUDED
+#define VISIT_STRUCT_BIG_ENDIAN_HPP_INCLUDED
+
+/***
+ * A big endian ("network byte order") variant of the binary serializer, for
+ * exchanging data with big endian systems.
+ *
+ * The encoding is the same as in visit_struct_binary.hpp, except that every
+ * arithmetic and enum value, including lengths, is written most significant
+ * byte first. The result doesn't depend on the byte order of the host.
+ *
+ * The work is planned at compile time from the member types:
+ *
+ *   - a value whose encoding has a fixed size (scalars, arrays of scalars, and
+ *     visitable structures made only of those) is copied into a buffer of
+ *     exactly that size and written with a single `put`, or read with a single
+ *     `get` and copied back. The buffer is converted in place, with one loop
+ *     per run of consecutive scalars of the same width, also across nested
+ *     arrays and structures
+ *   - sequences of scalars are byte swapped in tight loops over contiguous
+ *     memory, which compilers turn into vector shuffles, and one byte elements
+ *     are not touched at all
+ *
+ * Scalars must have 1, 2, 4 or 8 bytes, so e.g. `long double` is not supported.
+ * Types without a big endian codec fall back to `visit_struct::binary::codec`.
+ * Support for other types can be added by specializing
+ * `visit_struct::binary::big_endian::codec`.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
+namespace visit_struct {
+
+namespace binary {
+
+namespace big_endian {
+
+// Primary template, specialize to support more types.
+// Specializations have the same interface as `binary::codec`.
+template <typename T, typename ENABLE = void>
+struct codec : binary::codec<T> {};
+
+namespace detail {
+
+using binary::detail::is_bitwise;
+
+template <typename T>
+struct codec_for {
+  using type = codec<traits::clean_t<T>>;
+};
+
+/***
+ * Byte swapping
+ */
+
+inline std::uint8_t byteswap(std::uint8_t x) { return x; }
+
+#if defined(__GNUC__)
+inline std::uint16_t byteswap(std::uint16_t x) { return __builtin_bswap16(x); }
+inline std::uint32_t byteswap(std::uint32_t x) { return __builtin_bswap32(x); }
+inline std::uint64_t byteswap(std::uint64_t x) { return __builtin_bswap64(x); }
+#elif defined(_MSC_VER)
+inline std::uint16_t byteswap(std::uint16_t x) { return _byteswap_ushort(x); }
+inline std::uint32_t byteswap(std::uint32_t x) { return _byteswap_ulong(x); }
+inline std::uint64_t byteswap(std::uint64_t x) { return _byteswap_uint64(x); }
+#else
+inline std::uint16_t byteswap(std::uint16_t x) {
+  return static_cast<std::uint16_t>((x >> 8) | (x << 8));
+}
+inline std::uint32_t byteswap(std::uint32_t x) {
+  return (x >> 24) | ((x >> 8) & 0xff00u) | ((x << 8) & 0xff0000u) | (x << 24);
+}
+inline std::uint64_t byteswap(std::uint64_t x) {
+  return (std::uint64_t(byteswap(static_cast<std::uint32_t>(x))) << 32) | byteswap(static_cast<std::uint32_t>(x >> 32));
+}
+#endif
+
+template <std::size_t N>
+struct uint_of {
+  static_assert(N == 1 || N == 2 || N == 4 || N == 8,
+                "big endian codec only supports scalars of 1, 2, 4 or 8 bytes (not e.g. long double)");
+};
+
+template <> struct uint_of<1> { typedef std::uint8_t type; };
+template <> struct uint_of<2> { typedef std::uint16_t type; };
+template <> struct uint_of<4> { typedef std::uint32_t type; };
+template <> struct uint_of<8> { typedef std::uint64_t type; };
+
+// Write the big endian encoding of a scalar to p
+template <typename T>
+void store_scalar(unsigned char * p, const T & t) {
+  typedef typename uint_of<sizeof(T)>::type U;
+  U u;
+  std::memcpy(&u, &t, sizeof(u));
+#if VISIT_STRUCT_LITTLE_ENDIAN
+  u = byteswap(u);
+  std::memcpy(p, &u, sizeof(u));
+#else
+  for (std::size_t i = 0; i < sizeof(U); ++i) {
+    p[i] = static_cast<unsigned char>(u >> (8 * (sizeof(U) - 1 - i)));
+  }
+#endif
+}
+
+template <typename T>
+void load_scalar(const unsigned char * p, T & t) {
+  typedef typename uint_of<sizeof(T)>::type U;
+  U u;
+#if VISIT_STRUCT_LITTLE_ENDIAN
+  std::memcpy(&u, p, sizeof(u));
+  u = byteswap(u);
+#else
+  u = 0;
+  for (std::size_t i = 0; i < sizeof(U); ++i) {
+    u = static_cast<U>((u << 8) | p[i]);
+  }
+#endif
+  std::memcpy(&t, &u, sizeof(u));
+}
+
+// Convert scalars between host and big endian order, in place
+template <typename T>
+void swap_in_place(T * data, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i) {
+    unsigned char buffer[sizeof(T)];
+    std::memcpy(buffer, data + i, sizeof(T));
+    load_scalar(buffer, data[i]);
+  }
+}
+
+/***
+ * Compile-time size of the encoding, or 0 if it isn't fixed
+ */
+
+template <std::size_t... Ns>
+struct all_fixed_sum;
+
+template <>
+struct all_fixed_sum<> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = 0;
+};
+
+template <std::size_t N, std::size_t... Ns>
+struct all_fixed_sum<N, Ns...> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t rest = all_fixed_sum<Ns...>::value;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = (N && (rest || !sizeof...(Ns))) ? N + rest : 0;
+};
+
+template <typename T, typename ENABLE = void>
+struct fixed_size : std::integral_constant<std::size_t, 0> {};
+
+template <typename T>
+struct fixed_size<T, typename std::enable_if<is_bitwise<T>::value>::type>
+  : std::integral_constant<std::size_t, sizeof(T)> {};
+
+template <typename T, std::size_t N>
+struct fixed_size<T[N]> : std::integral_constant<std::size_t, N * fixed_size<T>::value> {};
+
+template <typename T, std::size_t N>
+struct fixed_size<std::array<T, N>> : fixed_size<T[N]> {};
+
+template <typename S, typename Seq = visit_struct::detail::field_indices<S>>
+struct fixed_members_size;
+
+template <typename S, int... Is>
+struct fixed_members_size<S, visit_struct::detail::integer_sequence<int, Is...>>
+  : std::integral_constant<std::size_t, all_fixed_sum<fixed_size<type_at<Is, S>>::value...>::value> {};
+
+template <typename T>
+struct fixed_size<T, typename std::enable_if<traits::is_visitable<T>::value>::type>
+  : fixed_members_size<T> {};
+
+// Values are staged through a stack buffer if their encoding is fixed and not too large
+static VISIT_STRUCT_CONSTEXPR const std::size_t max_staged_size = 1024;
+
+template <typename T>
+struct is_staged : std::integral_constant<bool, fixed_size<T>::value && fixed_size<T>::value <= max_staged_size> {};
+
+/***
+ * Conversion of fixed size values to and from a buffer
+ */
+
+// Copy values into a buffer and back as they are, without padding
+template <typename T, typename ENABLE = void>
+struct native_codec;
+
+template <typename T>
+struct native_codec<T, typename std::enable_if<is_bitwise<T>::value>::type> {
+  static void store(unsigned char * p, const T * data, std::size_t n) { std::memcpy(p, data, n * sizeof(T)); }
+  static void load(const unsigned char * p, T * data, std::size_t n) { std::memcpy(data, p, n * sizeof(T)); }
+};
+
+template <typename T, std::size_t N>
+struct native_codec<T[N]> {
+  static void store(unsigned char * p, const T (*data)[N], std::size_t n) { native_codec<T>::store(p, data[0], n * N); }
+  static void load(const unsigned char * p, T (*data)[N], std::size_t n) { native_codec<T>::load(p, data[0], n * N); }
+};
+
+template <typename T, std::size_t N>
+struct native_codec<std::array<T, N>> {
+  static void store(unsigned char * p, const std::array<T, N> * data, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) { native_codec<T>::store(p + i * fixed_size<T[N]>::value, data[i].data(), N); }
+  }
+  static void load(const unsigned char * p, std::array<T, N> * data, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) { native_codec<T>::load(p + i * fixed_size<T[N]>::value, data[i].data(), N); }
+  }
+};
+
+struct native_store_visitor {
+  unsigned char * pos;
+
+  template <typename T>
+  void operator()(const char *, const T & t) {
+    native_codec<T>::store(pos, &t, 1);
+    pos += fixed_size<T>::value;
+  }
+};
+
+struct native_load_visitor {
+  const unsigned char * pos;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    native_codec<T>::load(pos, &t, 1);
+    pos += fixed_size<T>::value;
+  }
+};
+
+template <typename T>
+struct native_codec<T, typename std::enable_if<traits::is_visitable<T>::value>::type> {
+  static void store(unsigned char * p, const T * data, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) { visit_struct::for_each(data[i], native_store_visitor{p + i * fixed_size<T>::value}); }
+  }
+  static void load(const unsigned char * p, T * data, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) { visit_struct::for_each(data[i], native_load_visitor{p + i * fixed_size<T>::value}); }
+  }
+};
+
+// Convert `n` scalars of type U in place, from host to big endian order or back
+template <typename U>
+void convert_block(unsigned char * p, std::size_t n, bool to_big_endian) {
+  for (std::size_t i = 0; i < n; ++i, p += sizeof(U)) {
+    U u;
+    if (to_big_endian) {
+      std::memcpy(&u, p, sizeof(u));
+      store_scalar(p, u);
+    } else {
+      load_scalar(p, u);
+      std::memcpy(p, &u, sizeof(u));
+    }
+  }
+}
+
+// Converts a buffer of copied values in place, one run of scalars of the same width at a time
+struct run_converter {
+  unsigned char * pos;
+  bool to_big_endian;
+  std::size_t width;
+  std::size_t count;
+
+  void add(std::size_t w, std::size_t n) {
+    if (w != width) {
+      this->flush();
+      width = w;
+    }
+    count += n;
+  }
+
+  void flush() {
+    switch (width) {
+      case 2: convert_block<std::uint16_t>(pos, count, to_big_endian); break;
+      case 4: convert_block<std::uint32_t>(pos, count, to_big_endian); break;
+      case 8: convert_block<std::uint64_t>(pos, count, to_big_endian); break;
+      default: break;
+    }
+    pos += width * count;
+    count = 0;
+  }
+};
+
+// Report the scalars in the encoding of `n` values of type T, in order
+template <typename T, typename ENABLE = void>
+struct scalar_layout;
+
+template <typename T>
+struct scalar_layout<T, typename std::enable_if<is_bitwise<T>::value>::type> {
+  static void add(run_converter & conv, std::size_t n) {
+    static_assert(sizeof(typename uint_of<sizeof(T)>::type) == sizeof(T), "");
+    conv.add(sizeof(T), n);
+  }
+};
+
+template <typename T, std::size_t N>
+struct scalar_layout<T[N]> {
+  static void add(run_converter & conv, std::size_t n) { scalar_layout<T>::add(conv, n * N); }
+};
+
+template <typename T, std::size_t N>
+struct scalar_layout<std::array<T, N>> : scalar_layout<T[N]> {};
+
+struct scalar_layout_visitor {
+  run_converter & conv;
+
+  template <typename T>
+  void operator()(const char *, type_c<T>) const {
+    scalar_layout<T>::add(conv, 1);
+  }
+};
+
+template <typename T>
+struct scalar_layout<T, typename std::enable_if<traits::is_visitable<T>::value>::type> {
+  static void add(run_converter & conv, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) { visit_struct::visit_types<T>(scalar_layout_visitor{conv}); }
+  }
+};
+
+// Write the big endian encoding of `n` values to p
+template <typename T>
+void store_fixed(unsigned char * p, const T * data, std::size_t n) {
+  native_codec<T>::store(p, data, n);
+  run_converter conv{p, true, 0, 0};
+  scalar_layout<T>::add(conv, n);
+  conv.flush();
+}
+
+// Read `n` values from their big endian encoding at p, which is overwritten
+template <typename T>
+void load_fixed(unsigned char * p, T * data, std::size_t n) {
+  run_converter conv{p, false, 0, 0};
+  scalar_layout<T>::add(conv, n);
+  conv.flush();
+  native_codec<T>::load(p, data, n);
+}
+
+/***
+ * Sequences
+ */
+
+template <typename Sink>
+void write_size(Sink & out, std::size_t n) {
+  unsigned char buffer[sizeof(size_type)];
+  store_scalar(buffer, static_cast<size_type>(n));
+  out.put(buffer, sizeof(buffer));
+}
+
+inline bool read_size(source & in, std::size_t & n) {
+  unsigned char buffer[sizeof(size_type)];
+  if (!in.get(buffer, sizeof(buffer))) { return false; }
+  size_type s;
+  load_scalar(buffer, s);
+  n = static_cast<std::size_t>(s);
+  return static_cast<size_type>(n) == s;
+}
+
+// 0: one byte scalars, written as they are
+// 1: other fixed size elements, converted a chunk at a time
+// 2: elements with a variable encoding
+template <typename T>
+using element_kind = std::integral_constant<int, (is_bitwise<T>::value && sizeof(T) == 1) ? 0 : is_staged<T>::value ? 1 : 2>;
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n, std::integral_constant<int, 0>) {
+  if (n) { out.put_range(data, n); }
+}
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n, std::integral_constant<int, 1>) {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t chunk = max_staged_size / fixed_size<T>::value;
+  unsigned char buffer[chunk * fixed_size<T>::value];
+  while (n) {
+    const std::size_t k = n < chunk ? n : chunk;
+    store_fixed(buffer, data, k);
+    out.put(buffer, k * fixed_size<T>::value);
+    data += k;
+    n -= k;
+  }
+}
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n, std::integral_constant<int, 2>) {
+  for (std::size_t i = 0; i < n; ++i) {
+    codec_for<T>::type::write(out, data[i]);
+  }
+}
+
+// Scalars are read straight into place and swapped there
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n, std::true_type) {
+  if (!in.get(data, n * sizeof(T))) { return false; }
+  swap_in_place(data, n);
+  return true;
+}
+
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n, std::false_type) {
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!codec_for<T>::type::read(in, data[i])) { return false; }
+  }
+  return true;
+}
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n) {
+  write_sequence(out, data, n, element_kind<T>{});
+}
+
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n) {
+  return read_sequence(in, data, n, is_bitwise<T>{});
+}
+
+// Read a length prefixed sequence into a string or vector
+template <typename C>
+bool read_container(source & in, C & c, std::size_t n, std::true_type) {
+  if (!binary::detail::read_contiguous(in, c, n)) { return false; }
+  if (n) { swap_in_place(&c[0], n); }
+  return true;
+}
+
+// Don't trust `n` for preallocation, a corrupt stream could make it huge
+template <typename C>
+bool read_container(source & in, C & c, std::size_t n, std::false_type) {
+  c.clear();
+  c.reserve(n < in.remaining() ? n : in.remaining());
+  for (std::size_t i = 0; i < n; ++i) {
+    c.push_back(typename C::value_type{});
+    if (!codec_for<typename C::value_type>::type::read(in, c.back())) { return false; }
+  }
+  return true;
+}
+
+template <typename C>
+bool read_container(source & in, C & c) {
+  std::size_t n;
+  binary::detail::bind_arena(in, c);
+  return read_size(in, n) && read_container(in, c, n, is_bitwise<typename C::value_type>{});
+}
+
+template <typename Sink>
+struct write_visitor {
+  Sink & out;
+
+  template <typename T>
+  void operator()(const char *, const T & t) const {
+    codec_for<T>::type::write(out, t);
+  }
+};
+
+struct read_visitor {
+  source & in;
+  bool ok;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    ok = ok && codec_for<T>::type::read(in, t);
+  }
+};
+
+} // end namespace detail
+
+// Values with a small fixed size encoding: scalars, arrays of them, and structures of those
+template <typename T>
+struct codec<T, typename std::enable_if<detail::is_staged<T>::value>::type> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t size = detail::fixed_size<T>::value;
+
+  template <typename Sink>
+  static void write(Sink & out, const T & t) {
+    unsigned char buffer[size];
+    detail::store_fixed(buffer, &t, 1);
+    out.put(buffer, size);
+  }
+
+  static bool read(source & in, T & t) {
+    unsigned char buffer[size];
+    if (!in.get(buffer, size)) { return false; }
+    detail::load_fixed(buffer, &t, 1);
+    return true;
+  }
+};
+
+// Other visitable structures
+template <typename T>
+struct codec<T, typename std::enable_if<traits::is_visitable<T>::value && !detail::is_staged<T>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const T & t) {
+    visit_struct::for_each(t, detail::write_visitor<Sink>{out});
+  }
+
+  static bool read(source & in, T & t) {
+    detail::read_visitor vis{in, true};
+    visit_struct::for_each(t, vis);
+    return vis.ok;
+  }
+};
+
+// Other fixed-size arrays
+template <typename T, std::size_t N>
+struct codec<T[N], typename std::enable_if<!detail::is_staged<T[N]>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const T (&t)[N]) {
+    detail::write_sequence(out, t, N);
+  }
+
+  static bool read(source & in, T (&t)[N]) {
+    return detail::read_sequence(in, t, N);
+  }
+};
+
+template <typename T, std::size_t N>
+struct codec<std::array<T, N>, typename std::enable_if<!detail::is_staged<std::array<T, N>>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const std::array<T, N> & t) {
+    detail::write_sequence(out, t.data(), N);
+  }
+
+  static bool read(source & in, std::array<T, N> & t) {
+    return detail::read_sequence(in, t.data(), N);
+  }
+};
+
+// Strings
+template <typename C, typename Tr, typename A>
+struct codec<std::basic_string<C, Tr, A>> {
+  using string_type = std::basic_string<C, Tr, A>;
+
+  template <typename Sink>
+  static void write(Sink & out, const string_type & s) {
+    detail::write_size(out, s.size());
+    detail::write_sequence(out, s.data(), s.size());
+  }
+
+  static bool read(source & in, string_type & s) {
+    return detail::read_container(in, s);
+  }
+};
+
+// Vectors (except std::vector<bool>, which has no codec)
+template <typename T, typename A>
+struct codec<std::vector<T, A>, typename std::enable_if<!std::is_same<T, bool>::value>::type> {
+  using vector_type = std::vector<T, A>;
+
+  template <typename Sink>
+  static void write(Sink & out, const vector_type & v) {
+    detail::write_size(out, v.size());
+    detail::write_sequence(out, v.data(), v.size());
+  }
+
+  static bool read(source & in, vector_type & v) {
+    return detail::read_container(in, v);
+  }
+};
+
+/***
+ * User interface
+ */
+
+// Serialize to a sink
+template <typename T, typename Sink>
+void serialize(const T & t, Sink & out) {
+  detail::codec_for<T>::type::write(out, t);
+}
+
+// Serialize, appending to a string
+template <typename T>
+void serialize(const T & t, std::string & out) {
+  string_sink sink{out};
+  big_endian::serialize(t, sink);
+}
+
+// Deserialize one object from the source, advancing it.
+// Returns false if the input is truncated or malformed.
+template <typename T>
+bool deserialize(source & in, T & t) {
+  return detail::codec_for<T>::type::read(in, t);
+}
+
+// Deserialize one object which must occupy the whole buffer
+template <typename T>
+bool deserialize(const std::string & buffer, T & t) {
+  source in{buffer.data(), buffer.size()};
+  return big_endian::deserialize(in, t) && !in.remaining();
+}
+
+} // end namespace big_endian
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_BIG_ENDIAN_HPP_INCLUDED
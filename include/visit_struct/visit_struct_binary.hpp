@@ -0,0 +1,536 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_BINARY_HPP_INCLUDED
+#define VISIT_STRUCT_BINARY_HPP_INCLUDED
+
+/***
+ * A simple binary serializer for visitable structures.
+ *
+ * The wire format is native byte order with no padding and no framing:
+ *
+ *   - arithmetic and enum members are written as their object representation
+ *   - std::array and C arrays are written as their elements, in order
+ *   - std::basic_string and std::vector are written as an element count
+ *     (binary::size_type), followed by the elements
+ *   - visitable structures are written as their registered members, in order
+ *
+ * Members of these kinds may be nested arbitrarily. Support for other types can
+ * be added by specializing `visit_struct::binary::codec`.
+ *
+ * A `source` may carry an arena (see visit_struct_arena.hpp). Strings and
+ * vectors whose allocator can draw from it are then rebound to the arena
+ * before they are read into.
+ *
+ * Output goes to a "sink", which is any object with two member functions:
+ *
+ *   void put(const void * data, std::size_t size);
+ *   void put_range(const void * data, std::size_t size);
+ *
+ * `put` is used for small pieces of the encoding, `put_range` for the payload
+ * of a contiguous range (string contents, arrays of scalars). A sink which
+ * simply copies may treat them the same. The `gather_list` sink below does not:
+ * it keeps a pointer to large ranges instead of copying them, so that a record
+ * can be written out with a single scatter / gather call.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// Whether the target is little endian, for code paths which depend on the byte order.
+// If the guess is wrong, define it yourself before including this header.
+#ifndef VISIT_STRUCT_LITTLE_ENDIAN
+#   if (defined __BYTE_ORDER__) && (defined __ORDER_LITTLE_ENDIAN__)
+#     define VISIT_STRUCT_LITTLE_ENDIAN (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#   elif defined _MSC_VER
+#     define VISIT_STRUCT_LITTLE_ENDIAN 1
+#   else
+#     define VISIT_STRUCT_LITTLE_ENDIAN 0
+#   endif
+#endif
+
+namespace visit_struct {
+
+class arena;
+class symbol_table;
+
+namespace binary {
+
+// Type used on the wire for the length of strings and vectors
+typedef std::uint64_t size_type;
+
+// Input for deserialization: a bounds-checked cursor over a byte buffer,
+// optionally with an arena for the containers which are read, and a table
+// for interned strings (see visit_struct_symbol.hpp)
+class source {
+  const char * pos_;
+  const char * end_;
+  visit_struct::arena * arena_;
+  visit_struct::symbol_table * symbols_;
+
+public:
+  source(const void * data, std::size_t size, visit_struct::arena * a = nullptr, visit_struct::symbol_table * symbols = nullptr)
+    : pos_(static_cast<const char *>(data))
+    , end_(static_cast<const char *>(data) + size)
+    , arena_(a)
+    , symbols_(symbols)
+  {}
+
+  const char * position() const { return pos_; }
+  visit_struct::arena * memory() const { return arena_; }
+  visit_struct::symbol_table * symbols() const { return symbols_; }
+  std::size_t remaining() const { return static_cast<std::size_t>(end_ - pos_); }
+
+  bool get(void * dest, std::size_t size) {
+    if (size > this->remaining()) { return false; }
+    if (size) { std::memcpy(dest, pos_, size); }
+    pos_ += size;
+    return true;
+  }
+
+  bool skip(std::size_t size) {
+    if (size > this->remaining()) { return false; }
+    pos_ += size;
+    return true;
+  }
+};
+
+// Sink which appends everything to a std::string
+class string_sink {
+  std::string & buffer_;
+
+public:
+  explicit string_sink(std::string & buffer) : buffer_(buffer) {}
+
+  void put(const void * data, std::size_t size) {
+    buffer_.append(static_cast<const char *>(data), size);
+  }
+
+  void put_range(const void * data, std::size_t size) {
+    this->put(data, size);
+  }
+};
+
+/***
+ * Codecs
+ */
+
+// Primary template, specialize to support more types.
+// A specialization provides:
+//
+//   template <typename Sink>
+//   static void write(Sink & out, const T & t);
+//   static bool read(source & in, T & t);
+//
+template <typename T, typename ENABLE = void>
+struct codec;
+
+// Whether allocator `A` can be bound to an arena, specialized in
+// visit_struct_arena.hpp. A specialization provides:
+//
+//   static A make(arena * a);
+//   static bool released(const A & a);   // its memory was given back since
+//
+template <typename A, typename ENABLE = void>
+struct arena_binding : std::false_type {};
+
+namespace detail {
+
+// Types which are written as their object representation
+template <typename T>
+struct is_bitwise : std::integral_constant<bool, std::is_arithmetic<T>::value || std::is_enum<T>::value> {};
+
+template <typename T>
+struct codec_for {
+  using type = codec<traits::clean_t<T>>;
+};
+
+template <typename Sink>
+struct write_visitor {
+  Sink & out;
+
+  template <typename T>
+  void operator()(const char *, const T & t) const {
+    codec_for<T>::type::write(out, t);
+  }
+};
+
+struct read_visitor {
+  source & in;
+  bool ok;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    ok = ok && codec_for<T>::type::read(in, t);
+  }
+};
+
+template <typename Sink>
+void write_size(Sink & out, std::size_t n) {
+  size_type s = static_cast<size_type>(n);
+  out.put(&s, sizeof(s));
+}
+
+inline bool read_size(source & in, std::size_t & n) {
+  size_type s;
+  if (!in.get(&s, sizeof(s))) { return false; }
+  n = static_cast<std::size_t>(s);
+  return static_cast<size_type>(n) == s;
+}
+
+// Elementwise encoding of a sequence, for non-bitwise elements
+template <typename Sink, typename It>
+void write_elements(Sink & out, It first, It last) {
+  for (; first != last; ++first) {
+    codec_for<decltype(*first)>::type::write(out, *first);
+  }
+}
+
+template <typename It>
+bool read_elements(source & in, It first, It last) {
+  for (; first != last; ++first) {
+    if (!codec_for<decltype(*first)>::type::read(in, *first)) { return false; }
+  }
+  return true;
+}
+
+// Before reading into a string or vector, move it to the arena of the source.
+// The container is recreated, since some allocators don't propagate on assignment.
+// A container whose arena memory was released is not destroyed: that memory
+// may have been handed out again, so its elements are gone.
+template <typename C>
+void bind_arena(source & in, C & c, std::true_type) {
+  typedef arena_binding<typename C::allocator_type> binding;
+  if (!in.memory()) { return; }
+  typename C::allocator_type a = binding::make(in.memory());
+  if (!(c.get_allocator() == a)) {
+    if (!binding::released(c.get_allocator())) { c.~C(); }
+    new (&c) C(a);
+  }
+}
+
+template <typename C>
+void bind_arena(source &, C &, std::false_type) {}
+
+template <typename C>
+void bind_arena(source & in, C & c) {
+  detail::bind_arena(in, c, arena_binding<typename C::allocator_type>{});
+}
+
+// Read `n` bitwise elements into a contiguous container (string or vector)
+template <typename C>
+bool read_contiguous(source & in, C & c, std::size_t n) {
+  using value_type = typename C::value_type;
+  if (n > in.remaining() / sizeof(value_type)) { return false; }
+  c.resize(n);
+  if (!n) { return true; }
+  return in.get(&c[0], n * sizeof(value_type));
+}
+
+} // end namespace detail
+
+// Arithmetic and enum types
+template <typename T>
+struct codec<T, typename std::enable_if<detail::is_bitwise<T>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const T & t) {
+    out.put(&t, sizeof(T));
+  }
+
+  static bool read(source & in, T & t) {
+    return in.get(&t, sizeof(T));
+  }
+};
+
+// Visitable structures
+template <typename T>
+struct codec<T, typename std::enable_if<traits::is_visitable<T>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const T & t) {
+    visit_struct::for_each(t, detail::write_visitor<Sink>{out});
+  }
+
+  static bool read(source & in, T & t) {
+    detail::read_visitor vis{in, true};
+    visit_struct::for_each(t, vis);
+    return vis.ok;
+  }
+};
+
+// Fixed-size arrays
+template <typename T, std::size_t N>
+struct codec<T[N]> {
+  template <typename Sink>
+  static void write(Sink & out, const T (&t)[N]) {
+    write_impl(out, t, detail::is_bitwise<T>{});
+  }
+
+  static bool read(source & in, T (&t)[N]) {
+    return read_impl(in, t, detail::is_bitwise<T>{});
+  }
+
+private:
+  template <typename Sink>
+  static void write_impl(Sink & out, const T (&t)[N], std::true_type) {
+    out.put_range(t, sizeof(t));
+  }
+
+  template <typename Sink>
+  static void write_impl(Sink & out, const T (&t)[N], std::false_type) {
+    detail::write_elements(out, t, t + N);
+  }
+
+  static bool read_impl(source & in, T (&t)[N], std::true_type) {
+    return in.get(t, sizeof(t));
+  }
+
+  static bool read_impl(source & in, T (&t)[N], std::false_type) {
+    return detail::read_elements(in, t, t + N);
+  }
+};
+
+template <typename T, std::size_t N>
+struct codec<std::array<T, N>> {
+  template <typename Sink>
+  static void write(Sink & out, const std::array<T, N> & t) {
+    write_impl(out, t, detail::is_bitwise<T>{});
+  }
+
+  static bool read(source & in, std::array<T, N> & t) {
+    return read_impl(in, t, detail::is_bitwise<T>{});
+  }
+
+private:
+  template <typename Sink>
+  static void write_impl(Sink & out, const std::array<T, N> & t, std::true_type) {
+    out.put_range(t.data(), N * sizeof(T));
+  }
+
+  template <typename Sink>
+  static void write_impl(Sink & out, const std::array<T, N> & t, std::false_type) {
+    detail::write_elements(out, t.begin(), t.end());
+  }
+
+  static bool read_impl(source & in, std::array<T, N> & t, std::true_type) {
+    return in.get(t.data(), N * sizeof(T));
+  }
+
+  static bool read_impl(source & in, std::array<T, N> & t, std::false_type) {
+    return detail::read_elements(in, t.begin(), t.end());
+  }
+};
+
+// Strings
+template <typename C, typename Tr, typename A>
+struct codec<std::basic_string<C, Tr, A>> {
+  using string_type = std::basic_string<C, Tr, A>;
+
+  template <typename Sink>
+  static void write(Sink & out, const string_type & s) {
+    detail::write_size(out, s.size());
+    if (!s.empty()) { out.put_range(s.data(), s.size() * sizeof(C)); }
+  }
+
+  static bool read(source & in, string_type & s) {
+    std::size_t n;
+    detail::bind_arena(in, s);
+    return detail::read_size(in, n) && detail::read_contiguous(in, s, n);
+  }
+};
+
+// Vectors (except std::vector<bool>, which has no codec)
+template <typename T, typename A>
+struct codec<std::vector<T, A>, typename std::enable_if<!std::is_same<T, bool>::value>::type> {
+  using vector_type = std::vector<T, A>;
+
+  template <typename Sink>
+  static void write(Sink & out, const vector_type & v) {
+    detail::write_size(out, v.size());
+    write_impl(out, v, detail::is_bitwise<T>{});
+  }
+
+  static bool read(source & in, vector_type & v) {
+    std::size_t n;
+    detail::bind_arena(in, v);
+    return detail::read_size(in, n) && read_impl(in, v, n, detail::is_bitwise<T>{});
+  }
+
+private:
+  template <typename Sink>
+  static void write_impl(Sink & out, const vector_type & v, std::true_type) {
+    if (!v.empty()) { out.put_range(v.data(), v.size() * sizeof(T)); }
+  }
+
+  template <typename Sink>
+  static void write_impl(Sink & out, const vector_type & v, std::false_type) {
+    detail::write_elements(out, v.begin(), v.end());
+  }
+
+  static bool read_impl(source & in, vector_type & v, std::size_t n, std::true_type) {
+    return detail::read_contiguous(in, v, n);
+  }
+
+  // Don't trust `n` for preallocation, a corrupt stream could make it huge
+  static bool read_impl(source & in, vector_type & v, std::size_t n, std::false_type) {
+    v.clear();
+    v.reserve(n < in.remaining() ? n : in.remaining());
+    for (std::size_t i = 0; i < n; ++i) {
+      v.emplace_back();
+      if (!codec<T>::read(in, v.back())) { return false; }
+    }
+    return true;
+  }
+};
+
+/***
+ * Scatter / gather output
+ *
+ * `gather_list` is a sink which produces a list of (pointer, size) segments
+ * describing the encoding, suitable for `writev` and similar calls.
+ *
+ * Small pieces of the encoding are copied into an internal staging buffer.
+ * Ranges passed to `put_range` of at least `threshold` bytes are not copied,
+ * the segment refers directly to the member's storage. Such segments are only
+ * valid while the serialized objects are alive and unmodified.
+ *
+ * Several objects may be gathered into the same list before it is flushed.
+ */
+
+struct segment {
+  const void * data;
+  std::size_t size;
+};
+
+class gather_list {
+  // A staged entry has data == nullptr and refers to staging_[offset]
+  struct entry {
+    const void * data;
+    std::size_t offset;
+    std::size_t size;
+  };
+
+  std::string staging_;
+  std::vector<entry> entries_;
+  std::vector<segment> segments_;
+  std::size_t threshold_;
+  std::size_t total_;
+
+public:
+  static VISIT_STRUCT_CONSTEXPR const std::size_t default_threshold = 256;
+
+  explicit gather_list(std::size_t threshold = default_threshold)
+    : threshold_(threshold)
+    , total_(0)
+  {}
+
+  void put(const void * data, std::size_t size) {
+    if (!size) { return; }
+    // Coalesce with the previous entry if it is also staged
+    if (!entries_.empty() && !entries_.back().data) {
+      entries_.back().size += size;
+    } else {
+      entries_.push_back(entry{nullptr, staging_.size(), size});
+    }
+    staging_.append(static_cast<const char *>(data), size);
+    total_ += size;
+  }
+
+  void put_range(const void * data, std::size_t size) {
+    if (size < threshold_) {
+      this->put(data, size);
+    } else {
+      entries_.push_back(entry{data, 0, size});
+      total_ += size;
+    }
+  }
+
+  // Total number of bytes described by the list
+  std::size_t size() const { return total_; }
+  bool empty() const { return total_ == 0; }
+
+  // Resolve the entries to segments. Valid until the list is next modified.
+  const std::vector<segment> & segments() {
+    segments_.clear();
+    segments_.reserve(entries_.size());
+    for (const entry & e : entries_) {
+      segments_.push_back(segment{e.data ? e.data : staging_.data() + e.offset, e.size});
+    }
+    return segments_;
+  }
+
+  // Drop the first `n` bytes, for instance those already written out
+  void consume(std::size_t n) {
+    if (n >= total_) { this->clear(); return; }
+    total_ -= n;
+    std::size_t done = 0;
+    while (n >= entries_[done].size) { n -= entries_[done++].size; }
+    entries_.erase(entries_.begin(), entries_.begin() + static_cast<std::ptrdiff_t>(done));
+    entry & e = entries_.front();
+    if (e.data) {
+      e.data = static_cast<const char *>(e.data) + n;
+    } else {
+      e.offset += n;
+    }
+    e.size -= n;
+  }
+
+  void clear() {
+    staging_.clear();
+    entries_.clear();
+    segments_.clear();
+    total_ = 0;
+  }
+};
+
+/***
+ * User interface
+ */
+
+// Serialize to a sink
+template <typename T, typename Sink>
+void serialize(const T & t, Sink & out) {
+  detail::codec_for<T>::type::write(out, t);
+}
+
+// Serialize, appending to a string
+template <typename T>
+void serialize(const T & t, std::string & out) {
+  string_sink sink{out};
+  binary::serialize(t, sink);
+}
+
+// Describe the encoding as segments, referencing large ranges in place
+template <typename T>
+void gather(const T & t, gather_list & out) {
+  binary::serialize(t, out);
+}
+
+// Deserialize one object from the source, advancing it.
+// Returns false if the input is truncated or malformed.
+template <typename T>
+bool deserialize(source & in, T & t) {
+  return detail::codec_for<T>::type::read(in, t);
+}
+
+// Deserialize one object which must occupy the whole buffer
+template <typename T>
+bool deserialize(const std::string & buffer, T & t) {
+  source in{buffer.data(), buffer.size()};
+  return binary::deserialize(in, t) && !in.remaining();
+}
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_BINARY_HPP_INCLUDED
@@ -0,0 +1,435 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_BITPACK_HPP_INCLUDED
+#define VISIT_STRUCT_BITPACK_HPP_INCLUDED
+
+/***
+ * Bit-packed representation of visitable structures with scalar members.
+ *
+ * Each registered member is given a width in bits:
+ *
+ *   VISITABLE_STRUCT(sample, kind, valid, level, value);
+ *   VISITABLE_BIT_WIDTHS(sample, 3, 1, 12, 32);
+ *
+ * `binary::packed<S>` then stores the members back to back in an array of
+ * 64 bit words, member 0 in the lowest bits. The word, shift and mask of each
+ * member are compile-time constants, so packing and unpacking compile to
+ * straight-line shifts and masks, and single members can be read or written
+ * in place with `get<idx>` and `set<idx>`.
+ *
+ * Integers and enums keep their low bits; signed values are sign extended
+ * when unpacked. `pack` reports whether every value fit in its width.
+ * Floating point members must be given their full width. bool needs one bit.
+ *
+ * Integer and enum members with a known range can instead be stored as their
+ * offset from the lower bound, in ceil(log2(max - min + 1)) bits:
+ *
+ *   VISITABLE_BIT_FIELDS(quote, bit_width<3>, bit_range<-2000, 2000>, bit_range<100, 115>);
+ *
+ * Here the second member takes 12 bits and the third 4. A value outside its
+ * range makes `pack` and `set` return false. Bounds are `std::int64_t`.
+ *
+ * The binary codec of `packed<S>` writes the bits as ceil(bits / 8) bytes,
+ * least significant first, independent of the byte order of the host.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace visit_struct {
+
+namespace binary {
+
+template <unsigned... Widths>
+struct bit_layout {};
+
+// Primary template, specialize it (usually with VISITABLE_BIT_WIDTHS) to derive
+// from a `bit_layout` with one width per registered member
+template <typename S>
+struct bit_widths;
+
+// Member descriptions for `bit_fields`: the low `W` bits of the value, or the
+// offset of the value from `Min`, in as many bits as the range needs
+template <unsigned W>
+struct bit_width {};
+
+template <std::int64_t Min, std::int64_t Max>
+struct bit_range {
+  static_assert(Min <= Max, "empty bit range");
+};
+
+template <typename... Fields>
+struct bit_field_list {};
+
+namespace detail {
+
+template <unsigned... Ws>
+bit_field_list<bit_width<Ws>...> fields_of(const bit_layout<Ws...> &);
+
+} // end namespace detail
+
+// Primary template, specialize it (usually with VISITABLE_BIT_FIELDS) to derive
+// from a `bit_field_list` with one description per registered member. By
+// default the widths given by `bit_widths` are used.
+template <typename S>
+struct bit_fields : decltype(detail::fields_of(bit_widths<S>{})) {};
+
+namespace detail {
+
+template <typename... Fs>
+bit_field_list<Fs...> layout_of(const bit_field_list<Fs...> &);
+
+template <typename S>
+using layout_t = decltype(detail::layout_of(bit_fields<S>{}));
+
+// Number of bits needed to store 0 ... span
+inline VISIT_STRUCT_CONSTEXPR unsigned bits_for(std::uint64_t span) {
+  return span ? 1 + bits_for(span >> 1) : 0;
+}
+
+template <typename F>
+struct field_width;
+
+template <unsigned W>
+struct field_width<bit_width<W>> {
+  static VISIT_STRUCT_CONSTEXPR const unsigned value = W;
+};
+
+template <std::int64_t Min, std::int64_t Max>
+struct field_width<bit_range<Min, Max>> {
+  static VISIT_STRUCT_CONSTEXPR const unsigned value = bits_for(static_cast<std::uint64_t>(Max) - static_cast<std::uint64_t>(Min));
+};
+
+// Description, width and offset of member `idx`
+template <typename L, std::size_t idx>
+struct layout_at;
+
+template <typename F, typename... Fs>
+struct layout_at<bit_field_list<F, Fs...>, 0> {
+  typedef F field;
+  static VISIT_STRUCT_CONSTEXPR const unsigned width = field_width<F>::value;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t offset = 0;
+};
+
+template <typename F, typename... Fs, std::size_t idx>
+struct layout_at<bit_field_list<F, Fs...>, idx> {
+  typedef layout_at<bit_field_list<Fs...>, idx - 1> rest;
+  typedef typename rest::field field;
+  static VISIT_STRUCT_CONSTEXPR const unsigned width = rest::width;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t offset = field_width<F>::value + rest::offset;
+};
+
+template <typename L>
+struct layout_bits;
+
+template <>
+struct layout_bits<bit_field_list<>> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = 0;
+};
+
+template <typename F, typename... Fs>
+struct layout_bits<bit_field_list<F, Fs...>> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = field_width<F>::value + layout_bits<bit_field_list<Fs...>>::value;
+};
+
+template <typename L>
+struct layout_size;
+
+template <typename... Fs>
+struct layout_size<bit_field_list<Fs...>> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = sizeof...(Fs);
+};
+
+template <unsigned W>
+struct width_mask {
+  static VISIT_STRUCT_CONSTEXPR const std::uint64_t value = W >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << (W % 64)) - 1;
+};
+
+// Conversion between a member value and its low `W` bits
+template <typename T, unsigned W, typename ENABLE = void>
+struct bit_value;
+
+template <typename T, unsigned W>
+struct bit_value<T, W, typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value>::type> {
+  typedef typename std::conditional<std::is_enum<T>::value, std::underlying_type<T>, std::common_type<T>>::type::type int_type;
+  static_assert(W >= 1 && W <= 8 * sizeof(T), "bit width must be between 1 and the width of the member type");
+
+  static std::uint64_t encode(T t) {
+    return static_cast<std::uint64_t>(static_cast<int_type>(t)) & width_mask<W>::value;
+  }
+
+  static T decode(std::uint64_t v) {
+    return decode(v, std::integral_constant<bool, std::is_signed<int_type>::value && (W < 64)>{});
+  }
+
+  static bool fits(T t) {
+    return decode(encode(t)) == t;
+  }
+
+private:
+  static T decode(std::uint64_t v, std::false_type) {
+    return static_cast<T>(static_cast<int_type>(v));
+  }
+
+  // Sign extend
+  static T decode(std::uint64_t v, std::true_type) {
+    if (v >> (W - 1)) { v |= ~width_mask<W>::value; }
+    return static_cast<T>(static_cast<int_type>(static_cast<std::int64_t>(v)));
+  }
+};
+
+template <typename T, unsigned W>
+struct bit_value<T, W, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  typedef typename std::conditional<sizeof(T) == 4, std::uint32_t, std::uint64_t>::type bits_type;
+  static_assert(sizeof(T) == sizeof(bits_type), "unsupported floating point type");
+  static_assert(W == 8 * sizeof(T), "floating point members must be given their full width");
+
+  static std::uint64_t encode(T t) {
+    bits_type b;
+    std::memcpy(&b, &t, sizeof(b));
+    return b;
+  }
+
+  static T decode(std::uint64_t v) {
+    const bits_type b = static_cast<bits_type>(v);
+    T t;
+    std::memcpy(&t, &b, sizeof(t));
+    return t;
+  }
+
+  static bool fits(T) { return true; }
+};
+
+// Conversion between an integer or enum member and its offset from `Min`
+template <typename T, std::int64_t Min, std::int64_t Max>
+struct range_value {
+  static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "bit ranges require integer or enum members");
+  typedef typename std::conditional<std::is_enum<T>::value, std::underlying_type<T>, std::common_type<T>>::type::type int_type;
+  static VISIT_STRUCT_CONSTEXPR const unsigned width = field_width<bit_range<Min, Max>>::value;
+
+  static std::uint64_t encode(T t) {
+    return (static_cast<std::uint64_t>(static_cast<int_type>(t)) - static_cast<std::uint64_t>(Min)) & width_mask<width>::value;
+  }
+
+  static T decode(std::uint64_t v) {
+    return static_cast<T>(static_cast<int_type>(static_cast<std::int64_t>(v + static_cast<std::uint64_t>(Min))));
+  }
+
+  static bool fits(T t) {
+    return in_range(static_cast<int_type>(t), std::is_signed<int_type>{});
+  }
+
+private:
+  static bool in_range(int_type v, std::true_type) {
+    return static_cast<std::int64_t>(v) >= Min && static_cast<std::int64_t>(v) <= Max;
+  }
+
+  static bool in_range(int_type v, std::false_type) {
+    return Max >= 0 && static_cast<std::uint64_t>(v) <= static_cast<std::uint64_t>(Max) &&
+           (Min <= 0 || static_cast<std::uint64_t>(v) >= static_cast<std::uint64_t>(Min));
+  }
+};
+
+// Conversion for the member description `F`
+template <typename T, typename F>
+struct field_value;
+
+template <typename T, unsigned W>
+struct field_value<T, bit_width<W>> : bit_value<T, W> {};
+
+template <typename T, std::int64_t Min, std::int64_t Max>
+struct field_value<T, bit_range<Min, Max>> : range_value<T, Min, Max> {};
+
+// Position of a field of `Width` bits at bit `Offset`, in an array of words
+template <std::size_t Offset, unsigned Width>
+struct bit_field {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t word = Offset / 64;
+  static VISIT_STRUCT_CONSTEXPR const unsigned shift = Offset % 64;
+  static VISIT_STRUCT_CONSTEXPR const std::uint64_t mask = width_mask<Width>::value;
+  typedef std::integral_constant<bool, (shift + Width > 64)> straddles;
+
+  static void store(std::uint64_t * words, std::uint64_t v) {
+    words[word] = (words[word] & ~(mask << shift)) | (v << shift);
+    store_high(words, v, straddles{});
+  }
+
+  static std::uint64_t load(const std::uint64_t * words) {
+    return ((words[word] >> shift) | load_high(words, straddles{})) & mask;
+  }
+
+private:
+  static void store_high(std::uint64_t *, std::uint64_t, std::false_type) {}
+
+  static void store_high(std::uint64_t * words, std::uint64_t v, std::true_type) {
+    words[word + 1] = (words[word + 1] & ~(mask >> (64 - shift))) | (v >> (64 - shift));
+  }
+
+  static std::uint64_t load_high(const std::uint64_t *, std::false_type) { return 0; }
+
+  static std::uint64_t load_high(const std::uint64_t * words, std::true_type) {
+    return words[word + 1] << (64 - shift);
+  }
+};
+
+// A range of a single value takes no bits
+template <std::size_t Offset>
+struct bit_field<Offset, 0> {
+  static void store(std::uint64_t *, std::uint64_t) {}
+  static std::uint64_t load(const std::uint64_t *) { return 0; }
+};
+
+} // end namespace detail
+
+template <typename S>
+class packed {
+  static_assert(traits::is_visitable<S>::value, "packed requires a visitable structure");
+
+  typedef detail::layout_t<S> layout;
+  static_assert(detail::layout_size<layout>::value == visit_struct::field_count<S>(),
+                "bit_widths or bit_fields must describe each registered member");
+
+  template <int idx>
+  using value_type = detail::field_value<type_at<idx, S>, typename detail::layout_at<layout, idx>::field>;
+
+  template <int idx>
+  using field_type = detail::bit_field<detail::layout_at<layout, idx>::offset, detail::layout_at<layout, idx>::width>;
+
+public:
+  static VISIT_STRUCT_CONSTEXPR const std::size_t bits = detail::layout_bits<layout>::value;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t bytes = (bits + 7) / 8;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t words = (bits + 63) / 64;
+
+  packed() : words_() {}
+
+  explicit packed(const S & s) : words_() { this->pack(s); }
+
+  // Store all members. Returns false if some value was truncated to its width.
+  bool pack(const S & s) {
+    return this->pack_members(s, visit_struct::detail::field_indices<S>{});
+  }
+
+  void unpack(S & s) const {
+    this->unpack_members(s, visit_struct::detail::field_indices<S>{});
+  }
+
+  S unpack() const {
+    S s;
+    this->unpack(s);
+    return s;
+  }
+
+  // Access to single members
+  template <int idx>
+  type_at<idx, S> get() const {
+    return value_type<idx>::decode(field_type<idx>::load(words_));
+  }
+
+  template <int idx>
+  bool set(const type_at<idx, S> & t) {
+    field_type<idx>::store(words_, value_type<idx>::encode(t));
+    return value_type<idx>::fits(t);
+  }
+
+  // Raw words, member 0 in the low bits of word 0
+  const std::uint64_t * data() const { return words_; }
+  std::uint64_t * data() { return words_; }
+
+  friend bool operator == (const packed & a, const packed & b) {
+    return !std::memcmp(a.words_, b.words_, sizeof(a.words_));
+  }
+
+  friend bool operator != (const packed & a, const packed & b) {
+    return !(a == b);
+  }
+
+private:
+  template <int... Is>
+  bool pack_members(const S & s, visit_struct::detail::integer_sequence<int, Is...>) {
+    bool ok = true;
+    (void) visit_struct::detail::swallow{ 0, (ok = this->set<Is>(visit_struct::get<Is>(s)) && ok, 0)... };
+    return ok;
+  }
+
+  template <int... Is>
+  void unpack_members(S & s, visit_struct::detail::integer_sequence<int, Is...>) const {
+    (void) visit_struct::detail::swallow{ 0, (visit_struct::get<Is>(s) = this->get<Is>(), 0)... };
+  }
+
+  std::uint64_t words_[words ? words : 1];
+};
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR const std::size_t packed<S>::bits;
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR const std::size_t packed<S>::bytes;
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR const std::size_t packed<S>::words;
+
+// Encoding of a packed structure: its bytes, least significant first
+template <typename S>
+struct codec<packed<S>> {
+  template <typename Sink>
+  static void write(Sink & out, const packed<S> & p) {
+#if VISIT_STRUCT_LITTLE_ENDIAN
+    out.put(p.data(), packed<S>::bytes);
+#else
+    unsigned char buffer[packed<S>::bytes];
+    for (std::size_t i = 0; i < packed<S>::bytes; ++i) {
+      buffer[i] = static_cast<unsigned char>(p.data()[i / 8] >> (8 * (i % 8)));
+    }
+    out.put(buffer, sizeof(buffer));
+#endif
+  }
+
+  static bool read(source & in, packed<S> & p) {
+    unsigned char buffer[packed<S>::bytes];
+    if (!in.get(buffer, sizeof(buffer))) { return false; }
+    std::uint64_t * words = p.data();
+    for (std::size_t w = 0; w < packed<S>::words; ++w) { words[w] = 0; }
+    for (std::size_t i = 0; i < packed<S>::bytes; ++i) {
+      words[i / 8] |= std::uint64_t(buffer[i]) << (8 * (i % 8));
+    }
+    return true;
+  }
+};
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+// Register the bit widths of the members of a visitable structure, in registration order
+#define VISITABLE_BIT_WIDTHS(STRUCT_NAME, ...)                                                     \
+namespace visit_struct {                                                                           \
+namespace binary {                                                                                 \
+                                                                                                   \
+template <>                                                                                        \
+struct bit_widths<STRUCT_NAME> : bit_layout<__VA_ARGS__> {};                                       \
+                                                                                                   \
+}                                                                                                  \
+}                                                                                                  \
+static_assert(true, "")
+
+// Register the bit descriptions of the members of a visitable structure, in
+// registration order, as `bit_width<W>` or `bit_range<Min, Max>`
+#define VISITABLE_BIT_FIELDS(STRUCT_NAME, ...)                                                     \
+namespace visit_struct {                                                                           \
+namespace binary {                                                                                 \
+                                                                                                   \
+template <>                                                                                        \
+struct bit_fields<STRUCT_NAME> : bit_field_list<__VA_ARGS__> {};                                   \
+                                                                                                   \
+}                                                                                                  \
+}                                                                                                  \
+static_assert(true, "")
+
+#endif // VISIT_STRUCT_BITPACK_HPP_INCLUDED
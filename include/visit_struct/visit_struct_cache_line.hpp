@@ -0,0 +1,19 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_CACHE_LINE_HPP_INCLUDED
+#define VISIT_STRUCT_CACHE_LINE_HPP_INCLUDED
+
+/***
+ * The assumed size of a cache line, shared by the headers which align data
+ * written by one thread and read by others, to avoid false sharing.
+ */
+
+// Define it yourself before including any visit_struct header to override it.
+#ifndef VISIT_STRUCT_CACHE_LINE_SIZE
+#define VISIT_STRUCT_CACHE_LINE_SIZE 64
+#endif
+
+#endif // VISIT_STRUCT_CACHE_LINE_HPP_INCLUDED
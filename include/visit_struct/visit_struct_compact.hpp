@@ -0,0 +1,472 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_COMPACT_HPP_INCLUDED
+#define VISIT_STRUCT_COMPACT_HPP_INCLUDED
+
+/***
+ * A compact variant of the binary serializer, for data dominated by small
+ * integers.
+ *
+ * The encoding is the same as in visit_struct_binary.hpp, except that:
+ *
+ *   - integers and enums wider than one byte are written as LEB128 varints,
+ *     signed ones after zigzag encoding, so that small magnitudes of either
+ *     sign take one byte
+ *   - string and vector lengths are written as varints
+ *
+ * Floating point values and one byte types are written as they are. Types
+ * without a compact codec fall back to `visit_struct::binary::codec`, so
+ * custom codecs keep working. Support for other types can be added by
+ * specializing `visit_struct::binary::compact::codec`.
+ *
+ * Decoding a sequence of varints (vectors and arrays of integers, or
+ * `read_varints`) works eight input bytes at a time on little endian targets:
+ * a run of eight one-byte varints is widened in one step, and longer varints
+ * are decoded without a loop over their bytes.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace visit_struct {
+
+namespace binary {
+
+namespace compact {
+
+// Primary template, specialize to support more types.
+// Specializations have the same interface as `binary::codec`.
+template <typename T, typename ENABLE = void>
+struct codec : binary::codec<T> {};
+
+namespace detail {
+
+using binary::detail::is_bitwise;
+
+template <typename T, bool = std::is_enum<T>::value>
+struct integer_type {
+  typedef T type;
+};
+
+template <typename T>
+struct integer_type<T, true> {
+  typedef typename std::underlying_type<T>::type type;
+};
+
+// Types which are written as varints
+template <typename T>
+struct is_varint : std::integral_constant<bool, is_bitwise<T>::value &&
+                                                std::is_integral<typename integer_type<T>::type>::value &&
+                                                (sizeof(T) > 1)> {};
+
+// Types which are written as their object representation
+template <typename T>
+struct is_raw : std::integral_constant<bool, is_bitwise<T>::value && !is_varint<T>::value> {};
+
+template <typename T>
+struct codec_for {
+  using type = codec<traits::clean_t<T>>;
+};
+
+/***
+ * Varints
+ */
+
+static VISIT_STRUCT_CONSTEXPR const std::size_t max_varint_size = 10;
+
+inline std::uint64_t zigzag_encode(std::int64_t v) {
+  return (static_cast<std::uint64_t>(v) << 1) ^ static_cast<std::uint64_t>(v >> 63);
+}
+
+inline std::int64_t zigzag_decode(std::uint64_t u) {
+  return static_cast<std::int64_t>(u >> 1) ^ -static_cast<std::int64_t>(u & 1);
+}
+
+template <typename Sink>
+void write_varint(Sink & out, std::uint64_t v) {
+  unsigned char buffer[max_varint_size];
+  std::size_t n = 0;
+  while (v >= 0x80) {
+    buffer[n++] = static_cast<unsigned char>(v | 0x80);
+    v >>= 7;
+  }
+  buffer[n++] = static_cast<unsigned char>(v);
+  out.put(buffer, n);
+}
+
+// Decode one varint from [p, end), returns the number of bytes used or 0 if it is truncated or overlong
+inline std::size_t decode_varint(const unsigned char * p, const unsigned char * end, std::uint64_t & v) {
+  v = 0;
+  for (std::size_t i = 0; i < max_varint_size && p + i != end; ++i) {
+    const std::uint64_t b = p[i];
+    // The tenth byte may only hold the top bit of a 64 bit value
+    if (i == max_varint_size - 1 && b > 1) { return 0; }
+    v |= (b & 0x7f) << (7 * i);
+    if (!(b & 0x80)) { return i + 1; }
+  }
+  return 0;
+}
+
+inline bool read_varint(source & in, std::uint64_t & v) {
+  const unsigned char * p = reinterpret_cast<const unsigned char *>(in.position());
+  const std::size_t n = decode_varint(p, p + in.remaining(), v);
+  return n && in.skip(n);
+}
+
+inline unsigned count_trailing_zeros(std::uint64_t x) {
+#if defined(__GNUC__)
+  return static_cast<unsigned>(__builtin_ctzll(x));
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long idx;
+  _BitScanForward64(&idx, x);
+  return static_cast<unsigned>(idx);
+#else
+  unsigned n = 0;
+  while (!(x & 1)) { x >>= 1; ++n; }
+  return n;
+#endif
+}
+
+// Conversion of a decoded varint to the member type, with a range check
+template <typename T, typename I = typename integer_type<T>::type, bool = std::is_signed<I>::value>
+struct varint_value {
+  static std::uint64_t encode(T t) {
+    return static_cast<std::uint64_t>(static_cast<I>(t));
+  }
+
+  static bool decode(std::uint64_t u, T & t) {
+    if (u > static_cast<std::uint64_t>(std::numeric_limits<I>::max())) { return false; }
+    t = static_cast<T>(static_cast<I>(u));
+    return true;
+  }
+};
+
+template <typename T, typename I>
+struct varint_value<T, I, true> {
+  static std::uint64_t encode(T t) {
+    return zigzag_encode(static_cast<std::int64_t>(static_cast<I>(t)));
+  }
+
+  static bool decode(std::uint64_t u, T & t) {
+    const std::int64_t v = zigzag_decode(u);
+    if (v < std::numeric_limits<I>::min() || v > std::numeric_limits<I>::max()) { return false; }
+    t = static_cast<T>(static_cast<I>(v));
+    return true;
+  }
+};
+
+} // end namespace detail
+
+/***
+ * Bulk decoding of `n` varints into `out`, advancing the source.
+ * Returns false if the input is truncated or malformed, or if a value is out of
+ * range for T, in which case the contents of `out` are unspecified.
+ */
+template <typename T>
+bool read_varints(source & in, T * out, std::size_t n) {
+  typedef detail::varint_value<T> conv;
+  const unsigned char * const begin = reinterpret_cast<const unsigned char *>(in.position());
+  const unsigned char * const end = begin + in.remaining();
+  const unsigned char * p = begin;
+  std::size_t i = 0;
+
+#if VISIT_STRUCT_LITTLE_ENDIAN
+  const std::uint64_t high_bits = 0x8080808080808080ull;
+  while (i < n && end - p >= 8) {
+    std::uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    const std::uint64_t stops = ~w & high_bits;
+
+    // Eight one byte varints
+    if (stops == high_bits && n - i >= 8) {
+      for (unsigned k = 0; k < 8; ++k) {
+        if (!conv::decode((w >> (8 * k)) & 0xff, out[i + k])) { return false; }
+      }
+      i += 8;
+      p += 8;
+      continue;
+    }
+
+    // Longer than eight bytes, use the scalar path
+    if (!stops) { break; }
+
+    // Gather the 7 bit groups of the first varint: 8 x 7 -> 4 x 14 -> 2 x 28 -> 56 bits
+    const unsigned len = detail::count_trailing_zeros(stops) / 8 + 1;
+    std::uint64_t x = w & 0x7f7f7f7f7f7f7f7full;
+    if (len < 8) { x &= (std::uint64_t(1) << (8 * len)) - 1; }
+    x = ((x & 0x7f007f007f007f00ull) >> 1) | (x & 0x007f007f007f007full);
+    x = ((x & 0x3fff00003fff0000ull) >> 2) | (x & 0x00003fff00003fffull);
+    x = ((x & 0x0fffffff00000000ull) >> 4) | (x & 0x000000000fffffffull);
+
+    if (!conv::decode(x, out[i])) { return false; }
+    ++i;
+    p += len;
+  }
+#endif
+
+  for (; i < n; ++i) {
+    std::uint64_t v;
+    const std::size_t len = detail::decode_varint(p, end, v);
+    if (!len || !conv::decode(v, out[i])) { return false; }
+    p += len;
+  }
+  return in.skip(static_cast<std::size_t>(p - begin));
+}
+
+namespace detail {
+
+template <typename Sink>
+struct write_visitor {
+  Sink & out;
+
+  template <typename T>
+  void operator()(const char *, const T & t) const {
+    codec_for<T>::type::write(out, t);
+  }
+};
+
+struct read_visitor {
+  source & in;
+  bool ok;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    ok = ok && codec_for<T>::type::read(in, t);
+  }
+};
+
+inline bool read_size(source & in, std::size_t & n) {
+  std::uint64_t s;
+  if (!read_varint(in, s)) { return false; }
+  n = static_cast<std::size_t>(s);
+  return static_cast<std::uint64_t>(n) == s;
+}
+
+// Encoding of a contiguous sequence of elements, by element kind
+template <typename T>
+using element_kind = std::integral_constant<int, is_raw<T>::value ? 0 : is_varint<T>::value ? 1 : 2>;
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n, std::integral_constant<int, 0>) {
+  if (n) { out.put_range(data, n * sizeof(T)); }
+}
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n, std::integral_constant<int, 1>) {
+  for (std::size_t i = 0; i < n; ++i) {
+    write_varint(out, varint_value<T>::encode(data[i]));
+  }
+}
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n, std::integral_constant<int, 2>) {
+  for (std::size_t i = 0; i < n; ++i) {
+    codec_for<T>::type::write(out, data[i]);
+  }
+}
+
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n, std::integral_constant<int, 0>) {
+  return in.get(data, n * sizeof(T));
+}
+
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n, std::integral_constant<int, 1>) {
+  return compact::read_varints(in, data, n);
+}
+
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n, std::integral_constant<int, 2>) {
+  for (std::size_t i = 0; i < n; ++i) {
+    if (!codec_for<T>::type::read(in, data[i])) { return false; }
+  }
+  return true;
+}
+
+template <typename T, typename Sink>
+void write_sequence(Sink & out, const T * data, std::size_t n) {
+  write_sequence(out, data, n, element_kind<T>{});
+}
+
+template <typename T>
+bool read_sequence(source & in, T * data, std::size_t n) {
+  return read_sequence(in, data, n, element_kind<T>{});
+}
+
+// Read `n` elements into a string or vector. Raw elements and varints take at
+// least one byte each, so the remaining input bounds the preallocation.
+template <typename C>
+bool read_container(source & in, C & c, std::size_t n, std::integral_constant<int, 0>) {
+  if (n > in.remaining() / sizeof(typename C::value_type)) { return false; }
+  c.resize(n);
+  return !n || in.get(&c[0], n * sizeof(typename C::value_type));
+}
+
+template <typename C>
+bool read_container(source & in, C & c, std::size_t n, std::integral_constant<int, 1>) {
+  if (n > in.remaining()) { return false; }
+  c.resize(n);
+  return !n || compact::read_varints(in, &c[0], n);
+}
+
+// Don't trust `n` for preallocation, a corrupt stream could make it huge
+template <typename C>
+bool read_container(source & in, C & c, std::size_t n, std::integral_constant<int, 2>) {
+  c.clear();
+  c.reserve(n < in.remaining() ? n : in.remaining());
+  for (std::size_t i = 0; i < n; ++i) {
+    c.push_back(typename C::value_type{});
+    if (!codec_for<typename C::value_type>::type::read(in, c.back())) { return false; }
+  }
+  return true;
+}
+
+template <typename C>
+bool read_container(source & in, C & c) {
+  std::size_t n;
+  binary::detail::bind_arena(in, c);
+  return read_size(in, n) && read_container(in, c, n, element_kind<typename C::value_type>{});
+}
+
+} // end namespace detail
+
+// Integers and enums wider than one byte
+template <typename T>
+struct codec<T, typename std::enable_if<detail::is_varint<T>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const T & t) {
+    detail::write_varint(out, detail::varint_value<T>::encode(t));
+  }
+
+  static bool read(source & in, T & t) {
+    std::uint64_t v;
+    return detail::read_varint(in, v) && detail::varint_value<T>::decode(v, t);
+  }
+};
+
+// Visitable structures
+template <typename T>
+struct codec<T, typename std::enable_if<traits::is_visitable<T>::value>::type> {
+  template <typename Sink>
+  static void write(Sink & out, const T & t) {
+    visit_struct::for_each(t, detail::write_visitor<Sink>{out});
+  }
+
+  static bool read(source & in, T & t) {
+    detail::read_visitor vis{in, true};
+    visit_struct::for_each(t, vis);
+    return vis.ok;
+  }
+};
+
+// Fixed-size arrays
+template <typename T, std::size_t N>
+struct codec<T[N]> {
+  template <typename Sink>
+  static void write(Sink & out, const T (&t)[N]) {
+    detail::write_sequence(out, t, N);
+  }
+
+  static bool read(source & in, T (&t)[N]) {
+    return detail::read_sequence(in, t, N);
+  }
+};
+
+template <typename T, std::size_t N>
+struct codec<std::array<T, N>> {
+  template <typename Sink>
+  static void write(Sink & out, const std::array<T, N> & t) {
+    detail::write_sequence(out, t.data(), N);
+  }
+
+  static bool read(source & in, std::array<T, N> & t) {
+    return detail::read_sequence(in, t.data(), N);
+  }
+};
+
+// Strings
+template <typename C, typename Tr, typename A>
+struct codec<std::basic_string<C, Tr, A>> {
+  using string_type = std::basic_string<C, Tr, A>;
+
+  template <typename Sink>
+  static void write(Sink & out, const string_type & s) {
+    detail::write_varint(out, s.size());
+    detail::write_sequence(out, s.data(), s.size());
+  }
+
+  static bool read(source & in, string_type & s) {
+    return detail::read_container(in, s);
+  }
+};
+
+// Vectors (except std::vector<bool>, which has no codec)
+template <typename T, typename A>
+struct codec<std::vector<T, A>, typename std::enable_if<!std::is_same<T, bool>::value>::type> {
+  using vector_type = std::vector<T, A>;
+
+  template <typename Sink>
+  static void write(Sink & out, const vector_type & v) {
+    detail::write_varint(out, v.size());
+    detail::write_sequence(out, v.data(), v.size());
+  }
+
+  static bool read(source & in, vector_type & v) {
+    return detail::read_container(in, v);
+  }
+};
+
+/***
+ * User interface
+ */
+
+// Serialize to a sink
+template <typename T, typename Sink>
+void serialize(const T & t, Sink & out) {
+  detail::codec_for<T>::type::write(out, t);
+}
+
+// Serialize, appending to a string
+template <typename T>
+void serialize(const T & t, std::string & out) {
+  string_sink sink{out};
+  compact::serialize(t, sink);
+}
+
+// Deserialize one object from the source, advancing it.
+// Returns false if the input is truncated or malformed.
+template <typename T>
+bool deserialize(source & in, T & t) {
+  return detail::codec_for<T>::type::read(in, t);
+}
+
+// Deserialize one object which must occupy the whole buffer
+template <typename T>
+bool deserialize(const std::string & buffer, T & t) {
+  source in{buffer.data(), buffer.size()};
+  return compact::deserialize(in, t) && !in.remaining();
+}
+
+} // end namespace compact
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_COMPACT_HPP_INCLUDED
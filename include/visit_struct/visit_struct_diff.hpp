@@ -0,0 +1,181 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_DIFF_HPP_INCLUDED
+#define VISIT_STRUCT_DIFF_HPP_INCLUDED
+
+/***
+ * Compute a compact difference between two instances of a visitable structure,
+ * and apply it to another instance as a patch.
+ *
+ * The difference is computed with the two-instance `for_each`. Members which
+ * are themselves visitable are compared recursively, other members are
+ * compared with `operator ==` (elementwise for C arrays).
+ *
+ * Encoding of a patch, for a structure:
+ *
+ *   count (std::uint16_t), followed by `count` entries in increasing index order
+ *   entry: index (std::uint16_t), followed by
+ *            - the patch of the member, if the member is visitable
+ *            - the binary encoding of the new value, otherwise
+ *
+ * Values use the codecs from visit_struct_binary.hpp.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+namespace visit_struct {
+
+namespace binary {
+
+namespace detail {
+
+typedef std::uint16_t patch_index_type;
+
+template <typename T>
+bool leaf_equal(const T & a, const T & b) {
+  return a == b;
+}
+
+template <typename T, std::size_t N>
+bool leaf_equal(const T (&a)[N], const T (&b)[N]) {
+  for (std::size_t i = 0; i < N; ++i) {
+    if (!detail::leaf_equal(a[i], b[i])) { return false; }
+  }
+  return true;
+}
+
+template <typename S>
+std::size_t write_diff(const S & from, const S & to, std::string & out);
+
+template <typename S>
+bool read_patch(source & in, S & s);
+
+struct diff_visitor {
+  std::string & out;
+  patch_index_type index;
+  patch_index_type count;
+  std::size_t leaves;
+
+  template <typename T>
+  void operator()(const char *, const T & a, const T & b) {
+    this->visit(a, b, traits::is_visitable<T>{});
+    ++index;
+  }
+
+  template <typename T>
+  void visit(const T & a, const T & b, std::true_type) {
+    const std::size_t pos = out.size();
+    out.append(reinterpret_cast<const char *>(&index), sizeof(index));
+    const std::size_t nested = detail::write_diff(a, b, out);
+    if (nested) {
+      leaves += nested;
+      ++count;
+    } else {
+      out.resize(pos);
+    }
+  }
+
+  template <typename T>
+  void visit(const T & a, const T & b, std::false_type) {
+    if (detail::leaf_equal(a, b)) { return; }
+    out.append(reinterpret_cast<const char *>(&index), sizeof(index));
+    binary::serialize(b, out);
+    ++leaves;
+    ++count;
+  }
+};
+
+// Returns the number of differing leaf members
+template <typename S>
+std::size_t write_diff(const S & from, const S & to, std::string & out) {
+  const std::size_t count_pos = out.size();
+  out.append(sizeof(patch_index_type), '\0');
+
+  diff_visitor vis{out, 0, 0, 0};
+  visit_struct::for_each(from, to, vis);
+
+  std::memcpy(&out[count_pos], &vis.count, sizeof(vis.count));
+  return vis.leaves;
+}
+
+struct patch_visitor {
+  source & in;
+  patch_index_type index;
+  patch_index_type remaining;
+  patch_index_type next;
+  bool ok;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    if (ok && remaining && index == next) {
+      ok = this->apply(t, traits::is_visitable<T>{});
+      if (ok && --remaining) {
+        // Entries must be in strictly increasing order
+        ok = in.get(&next, sizeof(next)) && next > index;
+      }
+    }
+    ++index;
+  }
+
+  template <typename T>
+  bool apply(T & t, std::true_type) {
+    return detail::read_patch(in, t);
+  }
+
+  template <typename T>
+  bool apply(T & t, std::false_type) {
+    return binary::deserialize(in, t);
+  }
+};
+
+template <typename S>
+bool read_patch(source & in, S & s) {
+  patch_visitor vis{in, 0, 0, 0, true};
+  if (!in.get(&vis.remaining, sizeof(vis.remaining))) { return false; }
+  if (vis.remaining && !in.get(&vis.next, sizeof(vis.next))) { return false; }
+
+  visit_struct::for_each(s, vis);
+  // Leftover entries refer to members which don't exist
+  return vis.ok && !vis.remaining;
+}
+
+} // end namespace detail
+
+// Append a patch which turns `from` into `to`.
+// Returns the number of leaf members which differ.
+template <typename S>
+std::size_t diff(const S & from, const S & to, std::string & out) {
+  static_assert(traits::is_visitable<S>::value, "diff requires a visitable structure");
+  return detail::write_diff(from, to, out);
+}
+
+// Apply a patch produced by `diff`, advancing the source.
+// Returns false if the patch is malformed, in which case `s` may be partially patched.
+template <typename S>
+bool patch(source & in, S & s) {
+  static_assert(traits::is_visitable<S>::value, "patch requires a visitable structure");
+  return detail::read_patch(in, s);
+}
+
+// Apply a patch which must occupy the whole buffer
+template <typename S>
+bool patch(const std::string & buffer, S & s) {
+  source in{buffer.data(), buffer.size()};
+  return binary::patch(in, s) && !in.remaining();
+}
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_DIFF_HPP_INCLUDED
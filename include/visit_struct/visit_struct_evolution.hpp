@@ -0,0 +1,538 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_EVOLUTION_HPP_INCLUDED
+#define VISIT_STRUCT_EVOLUTION_HPP_INCLUDED
+
+/***
+ * Schema evolution for the binary serializer.
+ *
+ * A writer starts a stream with `binary::write_schema<S>(out)`, a table of the
+ * names and wire shapes of the registered members of S, and then writes
+ * records with the ordinary `binary::serialize`.
+ *
+ * A reader for a possibly different version of S reads that table with
+ * `schema_reader<S>::read_header`, which matches stored members to current
+ * members by name, once per stream. Records are then read by following that
+ * plan:
+ *
+ *   - stored members which still exist are read into their current slot,
+ *     whatever their position
+ *   - stored members which were removed are skipped, by a small program
+ *     compiled from their shape when the header is read
+ *   - current members which were not stored are set from a default instance
+ *
+ * Members which were renamed can be matched with `rename(old, new)` before the
+ * header is read. A member whose shape changed is an error, as are changes
+ * inside nested visitable members, which are described by shape only.
+ *
+ * Encoding of the table:
+ *
+ *   count (std::uint16_t), followed by `count` entries
+ *   entry: name length (std::uint16_t), name, shape length (std::uint16_t), shape
+ *
+ * Encoding of a shape:
+ *
+ *   'i' | 'u' | 'f', size (1 byte)     signed, unsigned or floating point scalar
+ *   'c', size (1 byte)                 plain char, whatever its signedness
+ *   'a', count (std::uint64_t), shape   fixed-size array
+ *   'v', shape                          string or vector, count prefixed
+ *   's', count (std::uint16_t), shapes  visitable structure
+ *
+ * Support for types with custom codecs can be added by specializing
+ * `visit_struct::binary::wire_shape`.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace visit_struct {
+
+namespace binary {
+
+// Primary template, specialize to describe the encoding of more types.
+// A specialization provides:
+//
+//   static void append(std::string & out);
+//
+template <typename T, typename ENABLE = void>
+struct wire_shape;
+
+namespace detail {
+
+typedef std::uint16_t schema_count_type;
+
+template <typename T>
+void append_raw(std::string & out, const T & t) {
+  out.append(reinterpret_cast<const char *>(&t), sizeof(t));
+}
+
+template <typename T>
+struct shape_for {
+  using type = wire_shape<traits::clean_t<T>>;
+};
+
+template <typename T, bool = std::is_enum<T>::value>
+struct scalar_code {
+  static VISIT_STRUCT_CONSTEXPR char value() {
+    return std::is_floating_point<T>::value ? 'f' : std::is_signed<T>::value ? 'i' : 'u';
+  }
+};
+
+template <typename T>
+struct scalar_code<T, true> : scalar_code<typename std::underlying_type<T>::type> {};
+
+// Plain char is signed on some platforms and unsigned on others
+template <>
+struct scalar_code<char, false> {
+  static VISIT_STRUCT_CONSTEXPR char value() { return 'c'; }
+};
+
+struct shape_visitor {
+  std::string & out;
+
+  template <typename T>
+  void operator()(const char *, type_c<T>) const {
+    shape_for<T>::type::append(out);
+  }
+};
+
+} // end namespace detail
+
+// Arithmetic and enum types
+template <typename T>
+struct wire_shape<T, typename std::enable_if<detail::is_bitwise<T>::value>::type> {
+  static void append(std::string & out) {
+    out.push_back(detail::scalar_code<T>::value());
+    out.push_back(static_cast<char>(sizeof(T)));
+  }
+};
+
+// Visitable structures
+template <typename T>
+struct wire_shape<T, typename std::enable_if<traits::is_visitable<T>::value>::type> {
+  static void append(std::string & out) {
+    out.push_back('s');
+    detail::append_raw(out, static_cast<detail::schema_count_type>(visit_struct::field_count<T>()));
+    visit_struct::visit_types<T>(detail::shape_visitor{out});
+  }
+};
+
+// Fixed-size arrays
+template <typename T, std::size_t N>
+struct wire_shape<T[N]> {
+  static void append(std::string & out) {
+    out.push_back('a');
+    detail::append_raw(out, static_cast<std::uint64_t>(N));
+    detail::shape_for<T>::type::append(out);
+  }
+};
+
+template <typename T, std::size_t N>
+struct wire_shape<std::array<T, N>> : wire_shape<T[N]> {};
+
+// Strings and vectors
+template <typename C, typename Tr, typename A>
+struct wire_shape<std::basic_string<C, Tr, A>> {
+  static void append(std::string & out) {
+    out.push_back('v');
+    detail::shape_for<C>::type::append(out);
+  }
+};
+
+template <typename T, typename A>
+struct wire_shape<std::vector<T, A>, typename std::enable_if<!std::is_same<T, bool>::value>::type> {
+  static void append(std::string & out) {
+    out.push_back('v');
+    detail::shape_for<T>::type::append(out);
+  }
+};
+
+namespace detail {
+
+static VISIT_STRUCT_CONSTEXPR const int max_shape_depth = 32;
+
+// Validate the shape at [p, end), advancing p past it.
+// If the encoding has a fixed size, `fixed` is set and `size` receives it.
+inline bool parse_shape(const char *& p, const char * end, std::size_t & size, bool & fixed, int depth = 0) {
+  if (p == end || depth > max_shape_depth) { return false; }
+  size = 0;
+  switch (*p++) {
+    case 'i':
+    case 'u':
+    case 'f':
+    case 'c': {
+      if (p == end) { return false; }
+      size = static_cast<unsigned char>(*p++);
+      fixed = true;
+      return size != 0;
+    }
+    case 'a': {
+      std::uint64_t n;
+      if (static_cast<std::size_t>(end - p) < sizeof(n)) { return false; }
+      std::memcpy(&n, p, sizeof(n));
+      p += sizeof(n);
+      std::size_t elem;
+      if (!parse_shape(p, end, elem, fixed, depth + 1)) { return false; }
+      // An empty array is always fixed, so that every variable encoding consumes input
+      if (!n) { fixed = true; return true; }
+      if (!fixed) { return true; }
+      if (elem && n > std::size_t(-1) / elem) { return false; }
+      size = static_cast<std::size_t>(n) * elem;
+      return true;
+    }
+    case 'v': {
+      std::size_t elem;
+      if (!parse_shape(p, end, elem, fixed, depth + 1)) { return false; }
+      fixed = false;
+      return true;
+    }
+    case 's': {
+      schema_count_type n;
+      if (static_cast<std::size_t>(end - p) < sizeof(n)) { return false; }
+      std::memcpy(&n, p, sizeof(n));
+      p += sizeof(n);
+      fixed = true;
+      for (schema_count_type i = 0; i < n; ++i) {
+        std::size_t member;
+        bool member_fixed;
+        if (!parse_shape(p, end, member, member_fixed, depth + 1)) { return false; }
+        if (member_fixed && fixed) {
+          if (member > std::size_t(-1) - size) { return false; }
+          size += member;
+        } else {
+          fixed = false;
+        }
+      }
+      if (!fixed) { size = 0; }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Instruction of a skip program, compiled from a shape by the header reader.
+// Runs of fixed-size members become a single `bytes` instruction. `array` and
+// `vector` are followed by `length` instructions, which skip one element.
+struct skip_op {
+  enum kind_type : unsigned char { bytes, array, vector } kind;
+  std::uint64_t count;  // bytes: number of bytes, array: number of elements
+  std::size_t length;
+};
+
+// Append the instructions skipping one value of the shape at p, advancing p
+// past it. `last` is the index of the previous instruction at the same level,
+// if any, so that consecutive byte runs merge.
+inline bool compile_skip(const char *& p, const char * end, std::vector<skip_op> & ops, std::size_t & last, int depth = 0) {
+  const char * shape = p;
+  std::size_t size;
+  bool fixed;
+  if (!parse_shape(p, end, size, fixed, depth)) { return false; }
+
+  if (fixed) {
+    if (!size) { return true; }
+    if (last != std::size_t(-1) && last + 1 == ops.size() && ops[last].kind == skip_op::bytes &&
+        size <= std::size_t(-1) - ops[last].count) {
+      ops[last].count += size;
+    } else {
+      last = ops.size();
+      ops.push_back(skip_op{skip_op::bytes, size, 0});
+    }
+    return true;
+  }
+
+  switch (*shape++) {
+    case 'a':
+    case 'v': {
+      std::uint64_t n = 0;
+      const bool is_array = shape[-1] == 'a';
+      if (is_array) {
+        std::memcpy(&n, shape, sizeof(n));
+        shape += sizeof(n);
+      }
+      const std::size_t head = ops.size();
+      ops.push_back(skip_op{is_array ? skip_op::array : skip_op::vector, n, 0});
+      std::size_t inner = std::size_t(-1);
+      if (!compile_skip(shape, end, ops, inner, depth + 1)) { return false; }
+      ops[head].length = ops.size() - head - 1;
+      last = head;
+      return true;
+    }
+    case 's': {
+      schema_count_type n;
+      std::memcpy(&n, shape, sizeof(n));
+      shape += sizeof(n);
+      for (schema_count_type i = 0; i < n; ++i) {
+        if (!compile_skip(shape, end, ops, last, depth + 1)) { return false; }
+      }
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+// Run the instructions [first, last)
+inline bool run_skip(source & in, const skip_op * first, const skip_op * last) {
+  while (first != last) {
+    const skip_op & op = *first;
+    const skip_op * body = first + 1;
+    const skip_op * body_end = body + op.length;
+    first = body_end;
+
+    if (op.kind == skip_op::bytes) {
+      if (op.count > in.remaining() || !in.skip(static_cast<std::size_t>(op.count))) { return false; }
+      continue;
+    }
+
+    std::uint64_t n = op.count;
+    if (op.kind == skip_op::vector) {
+      std::size_t size;
+      if (!read_size(in, size)) { return false; }
+      n = size;
+    }
+    if (body == body_end) { continue; }
+
+    // Elements of fixed size
+    if (op.length == 1 && body->kind == skip_op::bytes) {
+      if (n > in.remaining() / body->count) { return false; }
+      if (!in.skip(static_cast<std::size_t>(n * body->count))) { return false; }
+      continue;
+    }
+    for (std::uint64_t i = 0; i < n; ++i) {
+      if (!run_skip(in, body, body_end)) { return false; }
+    }
+  }
+  return true;
+}
+
+// Names and shapes of the current members
+struct schema_entry {
+  std::string name;
+  std::string shape;
+};
+
+struct schema_visitor {
+  std::vector<schema_entry> & entries;
+
+  template <typename T>
+  void operator()(const char * name, type_c<T>) const {
+    entries.push_back(schema_entry{name, std::string{}});
+    shape_for<T>::type::append(entries.back().shape);
+  }
+};
+
+template <typename S>
+std::vector<schema_entry> current_schema() {
+  std::vector<schema_entry> entries;
+  visit_struct::visit_types<S>(schema_visitor{entries});
+  return entries;
+}
+
+inline bool read_string(source & in, std::string & s) {
+  schema_count_type n;
+  if (!in.get(&n, sizeof(n)) || n > in.remaining()) { return false; }
+  s.assign(in.position(), n);
+  return in.skip(n);
+}
+
+template <typename T>
+void assign_value(T & dest, const T & src) {
+  dest = src;
+}
+
+template <typename T, std::size_t N>
+void assign_value(T (&dest)[N], const T (&src)[N]) {
+  for (std::size_t i = 0; i < N; ++i) {
+    detail::assign_value(dest[i], src[i]);
+  }
+}
+
+// Per member functions, indexed by member position
+template <typename S, typename Seq = visit_struct::detail::field_indices<S>>
+struct member_functions;
+
+template <typename S, int... Is>
+struct member_functions<S, visit_struct::detail::integer_sequence<int, Is...>> {
+  typedef bool (*read_fn)(source &, S &);
+  typedef void (*copy_fn)(S &, const S &);
+
+  template <int idx>
+  static bool read_member(source & in, S & s) {
+    return binary::deserialize(in, visit_struct::get<idx>(s));
+  }
+
+  template <int idx>
+  static void copy_member(S & s, const S & from) {
+    detail::assign_value(visit_struct::get<idx>(s), visit_struct::get<idx>(from));
+  }
+
+  static read_fn reader(std::size_t idx) {
+    static const read_fn table[] = { &read_member<Is>... };
+    return table[idx];
+  }
+
+  static copy_fn copier(std::size_t idx) {
+    static const copy_fn table[] = { &copy_member<Is>... };
+    return table[idx];
+  }
+};
+
+} // end namespace detail
+
+// Append the member table of S, to be read by `schema_reader`
+template <typename S>
+void write_schema(std::string & out) {
+  static_assert(traits::is_visitable<S>::value, "write_schema requires a visitable structure");
+  const std::vector<detail::schema_entry> entries = detail::current_schema<S>();
+  detail::append_raw(out, static_cast<detail::schema_count_type>(entries.size()));
+  for (const detail::schema_entry & e : entries) {
+    detail::append_raw(out, static_cast<detail::schema_count_type>(e.name.size()));
+    out += e.name;
+    detail::append_raw(out, static_cast<detail::schema_count_type>(e.shape.size()));
+    out += e.shape;
+  }
+}
+
+// Reads records written with a possibly different member list of S
+template <typename S>
+class schema_reader {
+  static_assert(traits::is_visitable<S>::value, "schema_reader requires a visitable structure");
+
+  typedef detail::member_functions<S> functions;
+
+  struct step {
+    typename functions::read_fn read;  // current member to read into, or null to skip
+    std::size_t skip_begin;            // skip program of a skipped member, in skips_
+    std::size_t skip_end;
+  };
+
+  S defaults_;
+  std::vector<std::pair<std::string, std::string>> renames_;
+  std::vector<step> steps_;
+  std::vector<detail::skip_op> skips_;
+  std::vector<typename functions::copy_fn> missing_;
+  std::size_t skipped_;
+  bool identical_;
+  bool valid_;
+
+public:
+  // Members absent from the stream are copied from `defaults`
+  explicit schema_reader(S defaults = S{})
+    : defaults_(std::move(defaults))
+    , skipped_(0)
+    , identical_(false)
+    , valid_(false)
+  {}
+
+  // Match the stored member `stored_name` to the current member `current_name`
+  void rename(std::string stored_name, std::string current_name) {
+    renames_.emplace_back(std::move(stored_name), std::move(current_name));
+  }
+
+  // Read the member table and build the plan for the records which follow.
+  // Returns false if the table is malformed or incompatible.
+  bool read_header(source & in) {
+    valid_ = false;
+    identical_ = true;
+    skipped_ = 0;
+    steps_.clear();
+    skips_.clear();
+    missing_.clear();
+
+    const std::vector<detail::schema_entry> current = detail::current_schema<S>();
+    std::vector<bool> used(current.size(), false);
+
+    detail::schema_count_type count;
+    if (!in.get(&count, sizeof(count))) { return false; }
+    if (count != current.size()) { identical_ = false; }
+
+    for (detail::schema_count_type i = 0; i < count; ++i) {
+      std::string name, shape;
+      if (!detail::read_string(in, name) || !detail::read_string(in, shape)) { return false; }
+
+      const char * p = shape.data();
+      std::size_t size;
+      bool fixed;
+      if (!detail::parse_shape(p, p + shape.size(), size, fixed) || p != shape.data() + shape.size()) {
+        return false;
+      }
+
+      for (const auto & r : renames_) {
+        if (r.first == name) { name = r.second; break; }
+      }
+
+      std::size_t idx = 0;
+      while (idx < current.size() && current[idx].name != name) { ++idx; }
+
+      if (idx == current.size()) {
+        const std::size_t begin = skips_.size();
+        std::size_t last = std::size_t(-1);
+        p = shape.data();
+        if (!detail::compile_skip(p, p + shape.size(), skips_, last)) { return false; }
+        steps_.push_back(step{nullptr, begin, skips_.size()});
+        ++skipped_;
+        identical_ = false;
+        continue;
+      }
+
+      if (used[idx] || current[idx].shape != shape) { return false; }
+      used[idx] = true;
+      steps_.push_back(step{functions::reader(idx), 0, 0});
+      if (idx != i) { identical_ = false; }
+    }
+
+    for (std::size_t idx = 0; idx < current.size(); ++idx) {
+      if (!used[idx]) { missing_.push_back(functions::copier(idx)); }
+    }
+
+    valid_ = true;
+    return true;
+  }
+
+  // Read one record following the plan, advancing the source.
+  // Returns false if no valid header was read, or if the input is truncated or malformed.
+  bool read(source & in, S & s) const {
+    if (!valid_) { return false; }
+    if (identical_) { return binary::deserialize(in, s); }
+
+    for (const step & st : steps_) {
+      if (st.read) {
+        if (!st.read(in, s)) { return false; }
+      } else if (!detail::run_skip(in, skips_.data() + st.skip_begin, skips_.data() + st.skip_end)) {
+        return false;
+      }
+    }
+    for (const auto & copy : missing_) {
+      copy(s, defaults_);
+    }
+    return true;
+  }
+
+  bool valid() const { return valid_; }
+
+  // True if the stored member list is the same as the current one
+  bool identical() const { return valid_ && identical_; }
+
+  // Number of stored members which are skipped, and of current members which are defaulted
+  std::size_t skipped_count() const { return skipped_; }
+  std::size_t missing_count() const { return missing_.size(); }
+};
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_EVOLUTION_HPP_INCLUDED
@@ -0,0 +1,487 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_FLAT_MAP_HPP_INCLUDED
+#define VISIT_STRUCT_FLAT_MAP_HPP_INCLUDED
+
+/***
+ * Hashing and equality generated from the registration, and an open
+ * addressing hash map for composite keys.
+ *
+ * `struct_hash<S>` combines `std::hash` of each registered member and
+ * `struct_equal<S>` compares the registered members with `==`, both recursing
+ * into visitable members. Both work with any hash container:
+ *
+ *   std::unordered_map<instrument, double, visit_struct::struct_hash<instrument>,
+ *                      visit_struct::struct_equal<instrument>> m;
+ *
+ * `flat_map<K, V>` is a "Swiss table": keys and values are stored inline in
+ * one array of slots, next to an array of one control byte per slot. A
+ * control byte is empty, deleted, or holds 7 bits of the hash of the key in
+ * its slot. Lookups probe groups of 16 control bytes at once, comparing keys
+ * only in slots whose byte matches. With SSE2 a group is matched with a few
+ * instructions; otherwise (or with VISIT_STRUCT_NO_SSE2 defined) a portable
+ * loop is used.
+ *
+ * Iterators and references are invalidated by any insertion which grows the
+ * table. Elements are `std::pair<K, V>`; keys must not be modified through
+ * iterators.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#if !defined(VISIT_STRUCT_NO_SSE2) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define VISIT_STRUCT_HAS_SSE2
+#  include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif
+
+namespace visit_struct {
+
+template <typename S>
+struct struct_hash;
+
+template <typename S>
+struct struct_equal;
+
+namespace detail {
+
+template <typename T>
+std::size_t hash_value(const T & t, std::true_type /* visitable */) {
+  return struct_hash<T>{}(t);
+}
+
+template <typename T>
+std::size_t hash_value(const T & t, std::false_type) {
+  return std::hash<T>{}(t);
+}
+
+template <typename T>
+bool equal_value(const T & a, const T & b, std::true_type /* visitable */) {
+  return struct_equal<T>{}(a, b);
+}
+
+template <typename T>
+bool equal_value(const T & a, const T & b, std::false_type) {
+  return a == b;
+}
+
+struct hash_combiner {
+  std::size_t seed;
+
+  template <typename T>
+  void operator()(const char *, const T & t) {
+    const std::size_t h = detail::hash_value(t, std::integral_constant<bool, traits::is_visitable<T>::value>{});
+    seed ^= h + std::size_t(0x9e3779b97f4a7c15ull) + (seed << 6) + (seed >> 2);
+  }
+};
+
+struct equal_comparer {
+  bool result;
+
+  template <typename T>
+  void operator()(const char *, const T & a, const T & b) {
+    result = result && detail::equal_value(a, b, std::integral_constant<bool, traits::is_visitable<T>::value>{});
+  }
+};
+
+} // end namespace detail
+
+template <typename S>
+struct struct_hash {
+  std::size_t operator()(const S & s) const {
+    detail::hash_combiner h{0};
+    visit_struct::for_each(s, h);
+    return h.seed;
+  }
+};
+
+template <typename S>
+struct struct_equal {
+  bool operator()(const S & a, const S & b) const {
+    detail::equal_comparer c{true};
+    visit_struct::for_each(a, b, c);
+    return c.result;
+  }
+};
+
+namespace detail {
+
+typedef signed char ctrl_type;
+
+static VISIT_STRUCT_CONSTEXPR const ctrl_type ctrl_empty = -128;
+static VISIT_STRUCT_CONSTEXPR const ctrl_type ctrl_deleted = -2;
+
+inline unsigned lowest_bit(unsigned mask) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<unsigned>(__builtin_ctz(mask));
+#elif defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward(&index, mask);
+  return static_cast<unsigned>(index);
+#else
+  unsigned index = 0;
+  while (!(mask & 1u)) { mask >>= 1; ++index; }
+  return index;
+#endif
+}
+
+// 16 control bytes, matched to bit masks with bit i for byte i
+struct probe_group {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t width = 16;
+
+#ifdef VISIT_STRUCT_HAS_SSE2
+  __m128i ctrl;
+
+  explicit probe_group(const ctrl_type * p) : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i *>(p))) {}
+
+  unsigned match(ctrl_type h2) const {
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl)));
+  }
+
+  unsigned match_empty() const {
+    return this->match(ctrl_empty);
+  }
+
+  // Empty and deleted are the only negative values below -1
+  unsigned match_free() const {
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(ctrl, _mm_set1_epi8(-1))));
+  }
+#else
+  ctrl_type ctrl[width];
+
+  explicit probe_group(const ctrl_type * p) { std::memcpy(ctrl, p, width); }
+
+  unsigned match(ctrl_type h2) const {
+    unsigned result = 0;
+    for (std::size_t i = 0; i < width; ++i) { result |= unsigned(ctrl[i] == h2) << i; }
+    return result;
+  }
+
+  unsigned match_empty() const {
+    return this->match(ctrl_empty);
+  }
+
+  unsigned match_free() const {
+    unsigned result = 0;
+    for (std::size_t i = 0; i < width; ++i) { result |= unsigned(ctrl[i] < -1) << i; }
+    return result;
+  }
+#endif
+};
+
+// Spread the bits of user hashes, which may be the identity for integers
+inline std::uint64_t mix_hash(std::uint64_t h) {
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ull;
+  h ^= h >> 33;
+  return h;
+}
+
+} // end namespace detail
+
+template <typename K, typename V, typename Hash = struct_hash<K>, typename Equal = struct_equal<K>>
+class flat_map {
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K, V> value_type;
+  typedef std::size_t size_type;
+
+private:
+  typedef detail::ctrl_type ctrl_type;
+  typedef detail::probe_group group;
+  typedef typename std::aligned_storage<sizeof(value_type), alignof(value_type)>::type slot_type;
+
+  std::unique_ptr<ctrl_type[]> ctrl_;
+  std::unique_ptr<slot_type[]> slots_;
+  std::size_t groups_;      // number of groups, a power of two, or 0
+  std::size_t size_;
+  std::size_t growth_left_; // insertions into empty slots before a rehash
+  Hash hash_;
+  Equal equal_;
+
+  value_type * slot(std::size_t i) const {
+    return reinterpret_cast<value_type *>(&slots_[i]);
+  }
+
+  std::uint64_t hash_of(const K & key) const {
+    return detail::mix_hash(static_cast<std::uint64_t>(hash_(key)));
+  }
+
+  static ctrl_type h2(std::uint64_t h) { return static_cast<ctrl_type>(h & 0x7f); }
+
+  // Groups are probed quadratically (by triangular numbers), which visits every group
+  std::size_t first_group(std::uint64_t h) const { return static_cast<std::size_t>(h >> 7) & (groups_ - 1); }
+
+  std::size_t find_index(const K & key, std::uint64_t h) const {
+    if (!groups_) { return npos; }
+    std::size_t g = this->first_group(h);
+    for (std::size_t step = 1;; ++step) {
+      const group grp(ctrl_.get() + g * group::width);
+      for (unsigned m = grp.match(h2(h)); m; m &= m - 1) {
+        const std::size_t i = g * group::width + detail::lowest_bit(m);
+        if (equal_(this->slot(i)->first, key)) { return i; }
+      }
+      if (grp.match_empty()) { return npos; }
+      g = (g + step) & (groups_ - 1);
+    }
+  }
+
+  std::size_t find_free(std::uint64_t h) const {
+    std::size_t g = this->first_group(h);
+    for (std::size_t step = 1;; ++step) {
+      const unsigned m = group(ctrl_.get() + g * group::width).match_free();
+      if (m) { return g * group::width + detail::lowest_bit(m); }
+      g = (g + step) & (groups_ - 1);
+    }
+  }
+
+  static std::size_t max_load(std::size_t capacity) { return capacity - capacity / 8; }
+
+  void rehash_groups(std::size_t groups) {
+    flat_map next;
+    next.allocate(groups);
+    next.hash_ = hash_;
+    next.equal_ = equal_;
+    for (std::size_t i = 0; i < this->capacity(); ++i) {
+      if (ctrl_[i] >= 0) {
+        value_type * v = this->slot(i);
+        next.insert_new(std::move(*v), next.hash_of(v->first));
+      }
+    }
+    this->swap(next);
+  }
+
+  void allocate(std::size_t groups) {
+    const std::size_t capacity = groups * group::width;
+    ctrl_.reset(new ctrl_type[capacity]);
+    std::memset(ctrl_.get(), static_cast<unsigned char>(detail::ctrl_empty), capacity);
+    slots_.reset(new slot_type[capacity]);
+    groups_ = groups;
+    size_ = 0;
+    growth_left_ = max_load(capacity);
+  }
+
+  // Make room for one more element: grow, or only clean up deleted slots if
+  // the table is mostly tombstones
+  void prepare_insert() {
+    if (growth_left_) { return; }
+    if (!groups_) {
+      this->rehash_groups(1);
+    } else if (size_ * 2 < max_load(this->capacity())) {
+      this->rehash_groups(groups_);
+    } else {
+      this->rehash_groups(groups_ * 2);
+    }
+  }
+
+  // Insert a key known to be absent, with room available
+  template <typename T>
+  std::size_t insert_new(T && value, std::uint64_t h) {
+    const std::size_t i = this->find_free(h);
+    if (ctrl_[i] == detail::ctrl_empty) { --growth_left_; }
+    new (this->slot(i)) value_type(std::forward<T>(value));
+    ctrl_[i] = h2(h);
+    ++size_;
+    return i;
+  }
+
+  void destroy_all() {
+    for (std::size_t i = 0; i < this->capacity(); ++i) {
+      if (ctrl_[i] >= 0) { this->slot(i)->~value_type(); }
+    }
+  }
+
+  template <typename Map, typename Value>
+  class basic_iterator {
+    friend class flat_map;
+    Map * map_;
+    std::size_t index_;
+
+    void skip() {
+      while (index_ < map_->capacity() && map_->ctrl_[index_] < 0) { ++index_; }
+    }
+
+    basic_iterator(Map * map, std::size_t index) : map_(map), index_(index) { this->skip(); }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef typename std::remove_const<Value>::type value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef Value * pointer;
+    typedef Value & reference;
+
+    basic_iterator() : map_(nullptr), index_(0) {}
+
+    // iterator converts to const_iterator
+    template <typename M, typename W, typename = typename std::enable_if<std::is_convertible<W *, Value *>::value>::type>
+    basic_iterator(const basic_iterator<M, W> & other) : map_(other.map_), index_(other.index_) {}
+
+    reference operator*() const { return *map_->slot(index_); }
+    pointer operator->() const { return map_->slot(index_); }
+
+    basic_iterator & operator++() {
+      ++index_;
+      this->skip();
+      return *this;
+    }
+
+    basic_iterator operator++(int) {
+      basic_iterator result = *this;
+      ++*this;
+      return result;
+    }
+
+    friend bool operator == (const basic_iterator & a, const basic_iterator & b) { return a.index_ == b.index_; }
+    friend bool operator != (const basic_iterator & a, const basic_iterator & b) { return a.index_ != b.index_; }
+
+    template <typename M, typename W>
+    friend class basic_iterator;
+  };
+
+public:
+  typedef basic_iterator<flat_map, value_type> iterator;
+  typedef basic_iterator<const flat_map, const value_type> const_iterator;
+
+  static VISIT_STRUCT_CONSTEXPR const std::size_t npos = static_cast<std::size_t>(-1);
+
+  explicit flat_map(const Hash & hash = Hash{}, const Equal & equal = Equal{})
+    : groups_(0)
+    , size_(0)
+    , growth_left_(0)
+    , hash_(hash)
+    , equal_(equal)
+  {}
+
+  flat_map(const flat_map & other) : flat_map(other.hash_, other.equal_) {
+    this->reserve(other.size());
+    for (const value_type & v : other) { this->insert_new(v, this->hash_of(v.first)); }
+  }
+
+  flat_map(flat_map && other) noexcept : flat_map() { this->swap(other); }
+
+  flat_map & operator = (flat_map other) {
+    this->swap(other);
+    return *this;
+  }
+
+  ~flat_map() { this->destroy_all(); }
+
+  void swap(flat_map & other) noexcept {
+    using std::swap;
+    swap(ctrl_, other.ctrl_);
+    swap(slots_, other.slots_);
+    swap(groups_, other.groups_);
+    swap(size_, other.size_);
+    swap(growth_left_, other.growth_left_);
+    swap(hash_, other.hash_);
+    swap(equal_, other.equal_);
+  }
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return !size_; }
+  std::size_t capacity() const { return groups_ * group::width; }
+
+  void clear() {
+    this->destroy_all();
+    if (groups_) { this->allocate(groups_); }
+  }
+
+  // Make room for `n` elements without rehashing
+  void reserve(std::size_t n) {
+    std::size_t groups = 1;
+    while (max_load(groups * group::width) < n) { groups *= 2; }
+    if (groups > groups_) { this->rehash_groups(groups); }
+  }
+
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, this->capacity()); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, this->capacity()); }
+
+  iterator find(const K & key) {
+    const std::size_t i = this->find_index(key, this->hash_of(key));
+    return i == npos ? this->end() : iterator(this, i);
+  }
+
+  const_iterator find(const K & key) const {
+    const std::size_t i = this->find_index(key, this->hash_of(key));
+    return i == npos ? this->end() : const_iterator(this, i);
+  }
+
+  std::size_t count(const K & key) const {
+    return this->find_index(key, this->hash_of(key)) == npos ? 0 : 1;
+  }
+
+  // Insert (key, V(args...)) unless the key is present
+  template <typename... Args>
+  std::pair<iterator, bool> try_emplace(const K & key, Args &&... args) {
+    const std::uint64_t h = this->hash_of(key);
+    std::size_t i = this->find_index(key, h);
+    if (i != npos) { return std::make_pair(iterator(this, i), false); }
+    this->prepare_insert();
+    i = this->insert_new(value_type(std::piecewise_construct, std::forward_as_tuple(key),
+                                    std::forward_as_tuple(std::forward<Args>(args)...)), h);
+    return std::make_pair(iterator(this, i), true);
+  }
+
+  std::pair<iterator, bool> insert(const value_type & value) {
+    return this->try_emplace(value.first, value.second);
+  }
+
+  V & operator[](const K & key) {
+    return this->try_emplace(key).first->second;
+  }
+
+  std::size_t erase(const K & key) {
+    const std::size_t i = this->find_index(key, this->hash_of(key));
+    if (i == npos) { return 0; }
+    this->erase_index(i);
+    return 1;
+  }
+
+  iterator erase(const_iterator it) {
+    this->erase_index(it.index_);
+    return iterator(this, it.index_ + 1);
+  }
+
+private:
+  // A slot can go back to empty only if its group has an empty slot, since
+  // then no probe sequence ever continued past this group
+  void erase_index(std::size_t i) {
+    this->slot(i)->~value_type();
+    --size_;
+    const group grp(ctrl_.get() + (i / group::width) * group::width);
+    if (grp.match_empty()) {
+      ctrl_[i] = detail::ctrl_empty;
+      ++growth_left_;
+    } else {
+      ctrl_[i] = detail::ctrl_deleted;
+    }
+  }
+};
+
+template <typename K, typename V, typename H, typename E>
+VISIT_STRUCT_CONSTEXPR const std::size_t flat_map<K, V, H, E>::npos;
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_FLAT_MAP_HPP_INCLUDED
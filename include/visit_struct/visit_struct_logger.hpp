@@ -0,0 +1,331 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_LOGGER_HPP_INCLUDED
+#define VISIT_STRUCT_LOGGER_HPP_INCLUDED
+
+/***
+ * `visit_struct::binary_logger` logs visitable records with deferred
+ * formatting.
+ *
+ * `log(record)` only copies the raw bytes of the record, after a pointer to
+ * the format plan of its type, into a buffer owned by the calling thread. No
+ * text is produced, no lock is taken and nothing is allocated, except on the
+ * first call from each thread. A background thread later drains the buffers
+ * and formats each record with `get_name` and `for_each`:
+ *
+ *   point { x: 1, y: 2 }
+ *
+ * The format plan of a type is a static table generated from its
+ * registration, the type id in the buffer is its address.
+ *
+ * Records must be trivially copyable, as their bytes are copied as they are.
+ * Members which are visitable are formatted recursively, arrays element by
+ * element, char arrays as text up to the first null, others with
+ * `operator <<`. Records from one thread are formatted in the order they were
+ * logged, there is no order between threads. When a buffer is full, records
+ * are dropped and counted rather than blocking the caller.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace visit_struct {
+
+struct logger_options {
+  // Size of the buffer of each logging thread, rounded up to a power of two
+  std::size_t buffer_size = 64 * 1024;
+  // Time between two passes of the background thread
+  std::chrono::milliseconds interval = std::chrono::milliseconds(1);
+};
+
+namespace detail {
+
+// Format plan of a record type
+struct log_plan {
+  std::size_t size;
+  void (*format)(const unsigned char *, std::ostream &);
+};
+
+template <typename T>
+void log_value(std::ostream & out, const T & t);
+
+template <typename T, std::size_t N>
+void log_value(std::ostream & out, const T (&t)[N]);
+
+template <std::size_t N>
+void log_value(std::ostream & out, const char (&s)[N]);
+
+struct log_member_printer {
+  std::ostream & out;
+  bool first;
+
+  template <typename T>
+  void operator()(const char * name, const T & value) {
+    out << (first ? " " : ", ") << name << ": ";
+    first = false;
+    detail::log_value(out, value);
+  }
+};
+
+// Characters and small integers as numbers, enums as their underlying value
+inline void log_scalar(std::ostream & out, const bool & b, std::false_type) { out << (b ? "true" : "false"); }
+inline void log_scalar(std::ostream & out, const char & c, std::false_type) { out << +c; }
+inline void log_scalar(std::ostream & out, const signed char & c, std::false_type) { out << +c; }
+inline void log_scalar(std::ostream & out, const unsigned char & c, std::false_type) { out << +c; }
+
+template <typename T>
+void log_scalar(std::ostream & out, const T & t, std::false_type /* enum */) {
+  out << t;
+}
+
+template <typename T>
+void log_scalar(std::ostream & out, const T & t, std::true_type) {
+  detail::log_value(out, static_cast<typename std::underlying_type<T>::type>(t));
+}
+
+template <typename T>
+void log_value(std::ostream & out, const T & t, std::true_type /* visitable */) {
+  out << visit_struct::get_name<T>() << " {";
+  log_member_printer p{out, true};
+  visit_struct::for_each(t, p);
+  out << " }";
+}
+
+template <typename T>
+void log_value(std::ostream & out, const T & t, std::false_type) {
+  detail::log_scalar(out, t, std::integral_constant<bool, std::is_enum<T>::value>{});
+}
+
+template <typename T>
+void log_value(std::ostream & out, const T & t) {
+  detail::log_value(out, t, std::integral_constant<bool, traits::is_visitable<T>::value>{});
+}
+
+template <typename T, std::size_t N>
+void log_value(std::ostream & out, const T (&t)[N]) {
+  out << '[';
+  for (std::size_t i = 0; i < N; ++i) {
+    if (i) { out << ", "; }
+    detail::log_value(out, t[i]);
+  }
+  out << ']';
+}
+
+// Not necessarily null terminated
+template <std::size_t N>
+void log_value(std::ostream & out, const char (&s)[N]) {
+  out << '"';
+  out.write(s, static_cast<std::streamsize>(strnlen(s, N)));
+  out << '"';
+}
+
+template <typename S>
+struct log_plan_of {
+  static void format(const unsigned char * bytes, std::ostream & out) {
+    S s;
+    std::memcpy(&s, bytes, sizeof(S));
+    detail::log_value(out, s);
+    out << '\n';
+  }
+
+  static const log_plan plan;
+};
+
+template <typename S>
+const log_plan log_plan_of<S>::plan = { sizeof(S), &log_plan_of<S>::format };
+
+// Byte ring from one logging thread to the formatting thread. Entries are a
+// plan pointer followed by the record, padded to a multiple of 8 bytes. A null
+// plan pointer marks the unused end of the ring before a wrap.
+class log_buffer {
+  typedef const log_plan * entry_header;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t align = 8;
+
+  std::unique_ptr<std::uint64_t[]> data_;
+  std::size_t capacity_;
+  std::atomic<std::size_t> head_;
+  std::atomic<std::size_t> tail_;
+
+  unsigned char * at(std::size_t pos) const {
+    return reinterpret_cast<unsigned char *>(data_.get()) + (pos & (capacity_ - 1));
+  }
+
+public:
+  explicit log_buffer(std::size_t capacity)
+    : data_(new std::uint64_t[capacity / align])
+    , capacity_(capacity)
+    , head_(0)
+    , tail_(0)
+  {}
+
+  static std::size_t entry_size(std::size_t record_size) {
+    return (sizeof(entry_header) + record_size + align - 1) / align * align;
+  }
+
+  // Producer side
+  bool write(const log_plan * plan, const void * record) {
+    const std::size_t size = entry_size(plan->size);
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    const std::size_t used = pos - head_.load(std::memory_order_acquire);
+    const std::size_t offset = pos & (capacity_ - 1);
+    const std::size_t pad = offset + size > capacity_ ? capacity_ - offset : 0;
+    if (used + pad + size > capacity_) { return false; }
+
+    if (pad) {
+      const entry_header marker = nullptr;
+      std::memcpy(this->at(pos), &marker, sizeof(marker));
+      pos += pad;
+    }
+    std::memcpy(this->at(pos), &plan, sizeof(plan));
+    std::memcpy(this->at(pos) + sizeof(entry_header), record, plan->size);
+    tail_.store(pos + size, std::memory_order_release);
+    return true;
+  }
+
+  // Consumer side
+  void drain(std::ostream & out) {
+    std::size_t pos = head_.load(std::memory_order_relaxed);
+    const std::size_t end = tail_.load(std::memory_order_acquire);
+    while (pos != end) {
+      entry_header plan;
+      std::memcpy(&plan, this->at(pos), sizeof(plan));
+      if (!plan) {
+        pos += capacity_ - (pos & (capacity_ - 1));
+        continue;
+      }
+      plan->format(this->at(pos) + sizeof(entry_header), out);
+      pos += entry_size(plan->size);
+    }
+    head_.store(pos, std::memory_order_release);
+  }
+};
+
+inline std::uint64_t next_logger_id() {
+  static std::atomic<std::uint64_t> next{0};
+  return next.fetch_add(1, std::memory_order_relaxed);
+}
+
+} // end namespace detail
+
+class binary_logger {
+  struct cache_entry {
+    std::uint64_t logger;
+    detail::log_buffer * buffer;
+  };
+
+  const std::uint64_t id_;
+  std::ostream & out_;
+  std::size_t buffer_size_;
+  std::chrono::milliseconds interval_;
+  std::atomic<std::uint64_t> dropped_;
+
+  // Also serializes draining, so that there is a single consumer of each buffer
+  std::mutex buffers_mutex_;
+  std::vector<std::unique_ptr<detail::log_buffer>> buffers_;
+
+  std::mutex stop_mutex_;
+  std::condition_variable stop_cv_;
+  bool stop_;
+  std::thread thread_;
+
+  static std::size_t round_size(std::size_t n) {
+    std::size_t c = 64;
+    while (c < n) { c *= 2; }
+    return c;
+  }
+
+  // Buffer of the calling thread, found through a thread local cache keyed by logger id
+  detail::log_buffer & local() {
+    static thread_local std::vector<cache_entry> cache;
+    for (const cache_entry & e : cache) {
+      if (e.logger == id_) { return *e.buffer; }
+    }
+    std::unique_ptr<detail::log_buffer> b{new detail::log_buffer(buffer_size_)};
+    detail::log_buffer * result = b.get();
+    {
+      std::lock_guard<std::mutex> lock(buffers_mutex_);
+      buffers_.push_back(std::move(b));
+    }
+    cache.push_back(cache_entry{id_, result});
+    return *result;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(stop_mutex_);
+    while (!stop_) {
+      stop_cv_.wait_for(lock, interval_);
+      lock.unlock();
+      this->flush();
+      lock.lock();
+    }
+  }
+
+public:
+  explicit binary_logger(std::ostream & out, const logger_options & options = logger_options{})
+    : id_(detail::next_logger_id())
+    , out_(out)
+    , buffer_size_(round_size(options.buffer_size))
+    , interval_(options.interval)
+    , dropped_(0)
+    , stop_(false)
+  {
+    thread_ = std::thread(&binary_logger::run, this);
+  }
+
+  // Stops the background thread and formats the remaining records. No thread
+  // may log concurrently.
+  ~binary_logger() {
+    {
+      std::lock_guard<std::mutex> lock(stop_mutex_);
+      stop_ = true;
+    }
+    stop_cv_.notify_one();
+    thread_.join();
+    this->flush();
+  }
+
+  binary_logger(const binary_logger &) = delete;
+  binary_logger & operator = (const binary_logger &) = delete;
+
+  // Copy a record into the buffer of the calling thread. Returns false, and
+  // counts the record as dropped, if the buffer is full.
+  template <typename S>
+  bool log(const S & s) {
+    static_assert(traits::is_visitable<S>::value, "binary_logger requires a visitable structure");
+    static_assert(std::is_trivially_copyable<S>::value, "binary_logger requires trivially copyable records");
+    if (detail::log_buffer::entry_size(sizeof(S)) <= buffer_size_ &&
+        this->local().write(&detail::log_plan_of<S>::plan, &s)) {
+      return true;
+    }
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Format every record logged so far, on the calling thread
+  void flush() {
+    std::lock_guard<std::mutex> lock(buffers_mutex_);
+    for (const std::unique_ptr<detail::log_buffer> & b : buffers_) { b->drain(out_); }
+    out_.flush();
+  }
+
+  std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+};
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_LOGGER_HPP_INCLUDED
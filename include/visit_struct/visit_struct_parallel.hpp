@@ -0,0 +1,553 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_PARALLEL_HPP_INCLUDED
+#define VISIT_STRUCT_PARALLEL_HPP_INCLUDED
+
+/***
+ * Parallel visitation of large ranges of visitable structures.
+ *
+ * `parallel_for_each_field(range, v)` calls `v(name, member)` for every
+ * registered member of every element of a random access range, like calling
+ * `for_each(element, v)` on each element, but spread over a thread pool.
+ *
+ * The work is cut into tasks in one of two ways:
+ *
+ *  - `parallel_schedule::records`: each task visits all members of a chunk of
+ *    consecutive elements.
+ *  - `parallel_schedule::fields`: each task visits a single member (through
+ *    its accessor, see `visit_accessors`) over a chunk of elements, so a loop
+ *    touches one member at a time and is easier for the compiler to vectorize.
+ *
+ * `thread_pool` is a small work-stealing pool: the tasks of a call are dealt
+ * out as contiguous blocks to per-thread queues, each thread takes tasks from
+ * its own queue and steals from the others once it runs dry. The calling
+ * thread works too, and `run` returns when every task has finished. The first
+ * exception thrown by a task is rethrown from `run`.
+ *
+ * The visitor is shared by all threads and must be safe to call concurrently.
+ * It is never called twice for the same member of the same element. A pool
+ * runs one call at a time; tasks must not start a call on their own pool.
+ *
+ * `parallel_reduce_fields(range)` computes the count, and the sum, minimum
+ * and maximum of each arithmetic member, and optionally a histogram of each,
+ * in a single pass. Each task gathers one member at a time from a block of
+ * elements into a contiguous buffer, and reduces it with plain loops which
+ * the compiler can vectorize. Sums have the type of the member.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace visit_struct {
+
+enum class parallel_schedule { records, fields };
+
+struct parallel_options {
+  parallel_schedule schedule = parallel_schedule::records;
+  // Number of elements per task, or 0 to choose from the size of the range and of the pool
+  std::size_t grain = 0;
+};
+
+class thread_pool {
+  struct job {
+    void (*call)(void *, std::size_t);
+    void * context;
+  };
+
+  struct queue {
+    std::mutex mutex;
+    std::deque<std::size_t> tasks;
+  };
+
+  std::vector<std::thread> threads_;
+  std::unique_ptr<queue[]> queues_;  // one per worker, and a last one for the calling thread
+
+  std::mutex run_mutex_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  job job_;
+  std::uint64_t generation_;
+  unsigned busy_;
+  bool stop_;
+  std::exception_ptr error_;
+
+  bool pop(unsigned slot, std::size_t & task) {
+    queue & q = queues_[slot];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if (q.tasks.empty()) { return false; }
+    task = q.tasks.back();
+    q.tasks.pop_back();
+    return true;
+  }
+
+  bool steal(unsigned slot, std::size_t & task) {
+    const unsigned n = this->slots();
+    for (unsigned k = 1; k < n; ++k) {
+      queue & q = queues_[(slot + k) % n];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      if (!q.tasks.empty()) {
+        task = q.tasks.front();
+        q.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Run tasks until every queue is empty. Tasks are only added before a job
+  // starts, so an empty sweep means there is nothing left to take.
+  void work(unsigned slot, const job & j) {
+    std::size_t task;
+    while (this->pop(slot, task) || this->steal(slot, task)) {
+      try {
+        j.call(j.context, task);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) { error_ = std::current_exception(); }
+      }
+    }
+  }
+
+  void worker(unsigned slot) {
+    std::uint64_t seen = 0;
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+      wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+      if (stop_) { return; }
+      seen = generation_;
+      const job j = job_;
+      lock.unlock();
+      this->work(slot, j);
+      lock.lock();
+      if (--busy_ == 0) { done_.notify_all(); }
+    }
+  }
+
+  template <typename F>
+  static void call(void * context, std::size_t task) {
+    (*static_cast<F *>(context))(task);
+  }
+
+public:
+  static unsigned default_thread_count() {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n > 1 ? n - 1 : 0;
+  }
+
+  // Number of worker threads, in addition to the thread which calls `run`
+  explicit thread_pool(unsigned threads = default_thread_count())
+    : queues_(new queue[threads + 1])
+    , job_{nullptr, nullptr}
+    , generation_(0)
+    , busy_(0)
+    , stop_(false)
+  {
+    threads_.reserve(threads);
+    for (unsigned i = 0; i < threads; ++i) {
+      threads_.emplace_back(&thread_pool::worker, this, i);
+    }
+  }
+
+  ~thread_pool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread & t : threads_) { t.join(); }
+  }
+
+  thread_pool(const thread_pool &) = delete;
+  thread_pool & operator = (const thread_pool &) = delete;
+
+  // Number of threads which run tasks, including the calling thread
+  unsigned slots() const { return static_cast<unsigned>(threads_.size()) + 1; }
+
+  // Call f(i) for each i in [0, count), and wait for all of them
+  template <typename F>
+  void run(std::size_t count, F && f) {
+    typedef typename std::remove_reference<F>::type fn_type;
+    if (!count) { return; }
+
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    const unsigned n = this->slots();
+    for (unsigned s = 0; s < n; ++s) {
+      queue & q = queues_[s];
+      std::lock_guard<std::mutex> lock(q.mutex);
+      for (std::size_t i = count * s / n, end = count * (s + 1) / n; i < end; ++i) {
+        q.tasks.push_back(i);
+      }
+    }
+
+    const job j{&thread_pool::call<fn_type>, const_cast<void *>(static_cast<const void *>(&f))};
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      job_ = j;
+      busy_ = static_cast<unsigned>(threads_.size());
+      error_ = nullptr;
+      ++generation_;
+    }
+    wake_.notify_all();
+
+    this->work(n - 1, j);
+
+    std::exception_ptr error;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      done_.wait(lock, [this] { return busy_ == 0; });
+      std::swap(error, error_);
+    }
+    if (error) { std::rethrow_exception(error); }
+  }
+};
+
+// Pool shared by calls which don't name one, created on first use
+inline thread_pool & default_thread_pool() {
+  static thread_pool pool;
+  return pool;
+}
+
+namespace detail {
+
+// Enough tasks per thread for stealing to even out the load
+inline std::size_t choose_grain(std::size_t size, std::size_t grain, const thread_pool & pool) {
+  if (grain) { return grain; }
+  const std::size_t tasks = std::size_t(pool.slots()) * 8;
+  return std::max<std::size_t>((size + tasks - 1) / tasks, 256);
+}
+
+template <typename It, typename V>
+struct record_task {
+  It first;
+  std::size_t size;
+  std::size_t grain;
+  V & visitor;
+
+  void operator()(std::size_t task) const {
+    const std::size_t begin = task * grain;
+    const std::size_t end = std::min(size, begin + grain);
+    for (It it = first + begin, last = first + end; it != last; ++it) {
+      visit_struct::for_each(*it, visitor);
+    }
+  }
+};
+
+// Member loop for one accessor, over a chunk of elements
+template <typename It, typename V>
+struct column_pass {
+  const char * name;
+  void (*loop)(const char *, It, It, V &);
+};
+
+template <typename It, typename V>
+struct column_collector {
+  column_pass<It, V> * passes;
+  std::size_t index;
+
+  template <typename A>
+  static void loop(const char * name, It first, It last, V & v) {
+    const A accessor{};
+    for (; first != last; ++first) {
+      v(name, accessor(*first));
+    }
+  }
+
+  template <typename A>
+  void operator()(const char * name, A) {
+    passes[index++] = column_pass<It, V>{name, &column_collector::loop<A>};
+  }
+};
+
+template <typename It, typename V>
+struct field_task {
+  It first;
+  std::size_t size;
+  std::size_t grain;
+  std::size_t chunks;
+  const column_pass<It, V> * passes;
+  V & visitor;
+
+  void operator()(std::size_t task) const {
+    const column_pass<It, V> & pass = passes[task / chunks];
+    const std::size_t begin = (task % chunks) * grain;
+    const std::size_t end = std::min(size, begin + grain);
+    pass.loop(pass.name, first + begin, first + end, visitor);
+  }
+};
+
+} // end namespace detail
+
+template <typename Range, typename V>
+void parallel_for_each_field(thread_pool & pool, Range && range, V && v,
+                             const parallel_options & options = parallel_options{}) {
+  typedef decltype(std::begin(range)) iterator;
+  typedef typename std::remove_reference<V>::type visitor_type;
+  typedef traits::clean_t<decltype(*std::begin(range))> value_type;
+  static_assert(traits::is_visitable<value_type>::value, "parallel_for_each_field requires a range of visitable structures");
+  static_assert(std::is_base_of<std::random_access_iterator_tag,
+                                typename std::iterator_traits<iterator>::iterator_category>::value,
+                "parallel_for_each_field requires a random access range");
+
+  const iterator first = std::begin(range);
+  const std::size_t size = static_cast<std::size_t>(std::distance(first, std::end(range)));
+  if (!size) { return; }
+  const std::size_t grain = detail::choose_grain(size, options.grain, pool);
+  const std::size_t chunks = (size + grain - 1) / grain;
+
+  if (options.schedule == parallel_schedule::records) {
+    pool.run(chunks, detail::record_task<iterator, visitor_type>{first, size, grain, v});
+  } else {
+    const std::size_t fields = visit_struct::field_count<value_type>();
+    detail::column_pass<iterator, visitor_type> passes[fields ? fields : 1];
+    visit_struct::visit_accessors<value_type>(detail::column_collector<iterator, visitor_type>{passes, 0});
+    pool.run(chunks * fields,
+             detail::field_task<iterator, visitor_type>{first, size, grain, chunks, passes, v});
+  }
+}
+
+template <typename Range, typename V>
+void parallel_for_each_field(Range && range, V && v, const parallel_options & options = parallel_options{}) {
+  visit_struct::parallel_for_each_field(default_thread_pool(), std::forward<Range>(range), std::forward<V>(v), options);
+}
+
+/***
+ * Per-member statistics
+ */
+
+// Aggregates of the arithmetic members (other than bool) of a range of `S`.
+// Other members of `sum`, `min` and `max` are value initialized.
+template <typename S>
+struct field_summary {
+  std::size_t count;
+  S sum;
+  S min;
+  S max;
+  // Histograms, if requested: `bins` counts for each registered member, in registration order
+  std::size_t bins;
+  std::vector<std::uint64_t> counts;
+
+  field_summary() : count(0), sum(), min(), max(), bins(0) {}
+
+  const std::uint64_t * histogram(std::size_t idx) const { return counts.data() + idx * bins; }
+};
+
+namespace detail {
+
+template <typename T>
+struct is_reducible : std::integral_constant<bool, std::is_arithmetic<T>::value && !std::is_same<T, bool>::value> {};
+
+template <typename Range>
+struct range_value {
+  typedef traits::clean_t<decltype(*std::begin(std::declval<Range &>()))> type;
+};
+
+// Sum, min and max of a contiguous block, with independent accumulators so
+// that the loop vectorizes, also for floating point sums
+template <typename T>
+void reduce_values(const T * v, std::size_t n, T & sum, T & lo, T & hi) {
+  T s[4] = { T(), T(), T(), T() };
+  T l[4] = { lo, lo, lo, lo };
+  T h[4] = { hi, hi, hi, hi };
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (std::size_t k = 0; k < 4; ++k) {
+      const T x = v[i + k];
+      s[k] += x;
+      l[k] = x < l[k] ? x : l[k];
+      h[k] = h[k] < x ? x : h[k];
+    }
+  }
+  for (; i < n; ++i) {
+    const T x = v[i];
+    s[0] += x;
+    l[0] = x < l[0] ? x : l[0];
+    h[0] = h[0] < x ? x : h[0];
+  }
+  sum += (s[0] + s[1]) + (s[2] + s[3]);
+  lo = std::min(std::min(l[0], l[1]), std::min(l[2], l[3]));
+  hi = std::max(std::max(h[0], h[1]), std::max(h[2], h[3]));
+}
+
+// Equal width bins over [lower, upper], values outside go to the first or last bin
+template <typename T>
+void histogram_values(const T * v, std::size_t n, T lower, T upper, std::size_t bins, std::uint64_t * counts) {
+  const double scale = double(bins) / (double(upper) - double(lower));
+  const double last = double(bins - 1);
+  for (std::size_t i = 0; i < n; ++i) {
+    const double x = (double(v[i]) - double(lower)) * scale;
+    counts[!(x > 0) ? 0 : x >= last ? bins - 1 : std::size_t(x)]++;
+  }
+}
+
+template <typename S, typename It>
+struct reduce_task {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t block = 256;
+
+  It first;
+  std::size_t size;
+  std::size_t grain;
+  const S * lower;
+  const S * upper;
+  std::size_t bins;
+  field_summary<S> * partials;
+
+  void operator()(std::size_t task) const {
+    const std::size_t begin = task * grain;
+    const std::size_t end = std::min(size, begin + grain);
+    field_summary<S> & p = partials[task];
+    p.count = end - begin;
+    this->members(p, first + begin, end - begin, field_indices<S>{});
+  }
+
+  template <int... Is>
+  void members(field_summary<S> & p, It it, std::size_t n, integer_sequence<int, Is...>) const {
+    (void) swallow{ 0, (this->member<Is>(p, it, n, is_reducible<type_at<Is, S>>{}), 0)... };
+  }
+
+  template <int I>
+  void member(field_summary<S> &, It, std::size_t, std::false_type) const {}
+
+  // Column pass over one member, gathered a block at a time into contiguous storage
+  template <int I>
+  void member(field_summary<S> & p, It it, std::size_t n, std::true_type) const {
+    typedef type_at<I, S> T;
+    T & sum = visit_struct::get<I>(p.sum);
+    T & lo = visit_struct::get<I>(p.min);
+    T & hi = visit_struct::get<I>(p.max);
+    sum = T();
+    lo = std::numeric_limits<T>::max();
+    hi = std::numeric_limits<T>::lowest();
+
+    T buffer[block];
+    for (std::size_t done = 0; done < n;) {
+      const std::size_t m = std::min(block, n - done);
+      for (std::size_t j = 0; j < m; ++j) {
+        buffer[j] = visit_struct::get<I>(it[done + j]);
+      }
+      reduce_values(buffer, m, sum, lo, hi);
+      if (bins) {
+        histogram_values(buffer, m, visit_struct::get<I>(*lower), visit_struct::get<I>(*upper), bins, p.counts.data() + I * bins);
+      }
+      done += m;
+    }
+  }
+};
+
+template <typename S, typename It>
+VISIT_STRUCT_CONSTEXPR const std::size_t reduce_task<S, It>::block;
+
+// Two-instance visitors which merge partial results
+struct sum_merger {
+  template <typename T>
+  typename std::enable_if<is_reducible<T>::value>::type operator()(const char *, T & acc, const T & x) const { acc += x; }
+  template <typename T>
+  typename std::enable_if<!is_reducible<T>::value>::type operator()(const char *, T &, const T &) const {}
+};
+
+struct min_merger {
+  template <typename T>
+  typename std::enable_if<is_reducible<T>::value>::type operator()(const char *, T & acc, const T & x) const { acc = x < acc ? x : acc; }
+  template <typename T>
+  typename std::enable_if<!is_reducible<T>::value>::type operator()(const char *, T &, const T &) const {}
+};
+
+struct max_merger {
+  template <typename T>
+  typename std::enable_if<is_reducible<T>::value>::type operator()(const char *, T & acc, const T & x) const { acc = acc < x ? x : acc; }
+  template <typename T>
+  typename std::enable_if<!is_reducible<T>::value>::type operator()(const char *, T &, const T &) const {}
+};
+
+template <typename Range, typename S>
+field_summary<S> reduce_fields(thread_pool & pool, const Range & range, const S * lower, const S * upper, std::size_t bins) {
+  typedef decltype(std::begin(range)) iterator;
+  static_assert(traits::is_visitable<S>::value, "parallel_reduce_fields requires a range of visitable structures");
+  static_assert(std::is_base_of<std::random_access_iterator_tag,
+                                typename std::iterator_traits<iterator>::iterator_category>::value,
+                "parallel_reduce_fields requires a random access range");
+
+  const std::size_t histogram_size = visit_struct::field_count<S>() * bins;
+  const iterator first = std::begin(range);
+  const std::size_t size = static_cast<std::size_t>(std::distance(first, std::end(range)));
+
+  field_summary<S> result;
+  result.bins = bins;
+  if (!size) {
+    result.counts.assign(histogram_size, 0);
+    return result;
+  }
+
+  const std::size_t grain = detail::choose_grain(size, 0, pool);
+  const std::size_t chunks = (size + grain - 1) / grain;
+  std::vector<field_summary<S>> partials(chunks);
+  for (field_summary<S> & p : partials) { p.counts.assign(histogram_size, 0); }
+  pool.run(chunks, reduce_task<S, iterator>{first, size, grain, lower, upper, bins, partials.data()});
+
+  result = std::move(partials[0]);
+  result.bins = bins;
+  for (std::size_t c = 1; c < chunks; ++c) {
+    const field_summary<S> & p = partials[c];
+    result.count += p.count;
+    visit_struct::for_each(result.sum, p.sum, sum_merger{});
+    visit_struct::for_each(result.min, p.min, min_merger{});
+    visit_struct::for_each(result.max, p.max, max_merger{});
+    for (std::size_t i = 0; i < histogram_size; ++i) { result.counts[i] += p.counts[i]; }
+  }
+  return result;
+}
+
+} // end namespace detail
+
+// Sum, min and max of each arithmetic member, in one pass over the range
+template <typename Range>
+field_summary<typename detail::range_value<Range>::type> parallel_reduce_fields(thread_pool & pool, const Range & range) {
+  typedef typename detail::range_value<Range>::type S;
+  return detail::reduce_fields<Range, S>(pool, range, nullptr, nullptr, 0);
+}
+
+// As above, and a histogram of each arithmetic member with `bins` equal bins
+// from the member of `lower` to the member of `upper`
+template <typename Range>
+field_summary<typename detail::range_value<Range>::type>
+parallel_reduce_fields(thread_pool & pool, const Range & range,
+                       const typename detail::range_value<Range>::type & lower,
+                       const typename detail::range_value<Range>::type & upper,
+                       std::size_t bins) {
+  return detail::reduce_fields(pool, range, &lower, &upper, bins);
+}
+
+template <typename Range>
+field_summary<typename detail::range_value<Range>::type> parallel_reduce_fields(const Range & range) {
+  return visit_struct::parallel_reduce_fields(default_thread_pool(), range);
+}
+
+template <typename Range>
+field_summary<typename detail::range_value<Range>::type>
+parallel_reduce_fields(const Range & range,
+                       const typename detail::range_value<Range>::type & lower,
+                       const typename detail::range_value<Range>::type & upper,
+                       std::size_t bins) {
+  return visit_struct::parallel_reduce_fields(default_thread_pool(), range, lower, upper, bins);
+}
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_PARALLEL_HPP_INCLUDED
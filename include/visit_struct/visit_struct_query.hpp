@@ -0,0 +1,222 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_QUERY_HPP_INCLUDED
+#define VISIT_STRUCT_QUERY_HPP_INCLUDED
+
+/***
+ * Column-wise filters and projections over `soa_vector<S>`.
+ *
+ * `query::select(v, predicates...)` returns the indices of the elements which
+ * satisfy every predicate, as a selection vector. Predicates name a member by
+ * index, or by name through the constexpr `member_index`:
+ *
+ *   using namespace visit_struct;
+ *   query::selection s = query::select(trades,
+ *     query::greater<member_index<trade>("price")>(100.0),
+ *     query::between<0>(10, 20));
+ *
+ *   std::vector<double> prices = query::gather<1>(trades, s);
+ *   soa_vector<trade> hits = query::take(trades, s);
+ *
+ * Rows are processed in blocks. Each predicate runs over its own column and
+ * ANDs its result into a byte mask for the block, with a loop free of
+ * branches which the compiler can vectorize. The mask is then compacted into
+ * indices, also without branches.
+ *
+ * `query::where<idx>(f)` accepts any function of the member, at the cost of
+ * a call per element.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_soa.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+namespace visit_struct {
+
+namespace query {
+
+// Indices of selected elements, in increasing order
+typedef std::vector<std::size_t> selection;
+
+namespace detail {
+
+using visit_struct::detail::swallow;
+using visit_struct::detail::integer_sequence;
+using visit_struct::detail::field_indices;
+
+static VISIT_STRUCT_CONSTEXPR const std::size_t block_size = 1024;
+
+struct op_equal {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T &) { return x == a; }
+};
+
+struct op_not_equal {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T &) { return x != a; }
+};
+
+struct op_less {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T &) { return x < a; }
+};
+
+struct op_less_equal {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T &) { return !(a < x); }
+};
+
+struct op_greater {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T &) { return a < x; }
+};
+
+struct op_greater_equal {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T &) { return !(x < a); }
+};
+
+// Closed interval [a, b]. Bitwise and, so both comparisons run without a branch.
+struct op_between {
+  template <typename C, typename T>
+  static bool test(const C & x, const T & a, const T & b) { return !(x < a) & !(b < x); }
+};
+
+template <typename Op, int idx, typename T>
+struct compare_predicate {
+  T a;
+  T b;
+
+  template <typename S>
+  void apply(const soa_vector<S> & v, std::size_t begin, std::size_t n, unsigned char * mask) const {
+    const type_at<idx, S> * column = v.template column<idx>().data() + begin;
+    const T lo = a;
+    const T hi = b;
+    for (std::size_t i = 0; i < n; ++i) {
+      mask[i] &= static_cast<unsigned char>(Op::test(column[i], lo, hi));
+    }
+  }
+};
+
+template <int idx, typename F>
+struct function_predicate {
+  F f;
+
+  template <typename S>
+  void apply(const soa_vector<S> & v, std::size_t begin, std::size_t n, unsigned char * mask) const {
+    const type_at<idx, S> * column = v.template column<idx>().data() + begin;
+    for (std::size_t i = 0; i < n; ++i) {
+      mask[i] &= static_cast<unsigned char>(f(column[i]) ? 1 : 0);
+    }
+  }
+};
+
+template <typename S, typename Seq = field_indices<S>>
+struct take_columns;
+
+template <typename S, int... Is>
+struct take_columns<S, integer_sequence<int, Is...>> {
+  template <typename T>
+  static void gather(std::vector<T> & out, const std::vector<T> & in, const selection & s) {
+    out.reserve(s.size());
+    for (std::size_t i : s) { out.push_back(in[i]); }
+  }
+
+  static void apply(soa_vector<S> & out, const soa_vector<S> & in, const selection & s) {
+    (void) swallow{ 0, (gather(out.template column<Is>(), in.template column<Is>(), s), 0)... };
+  }
+};
+
+} // end namespace detail
+
+// Predicates on member `idx`
+template <int idx, typename T>
+detail::compare_predicate<detail::op_equal, idx, T> equal_to(const T & value) { return {value, value}; }
+
+template <int idx, typename T>
+detail::compare_predicate<detail::op_not_equal, idx, T> not_equal_to(const T & value) { return {value, value}; }
+
+template <int idx, typename T>
+detail::compare_predicate<detail::op_less, idx, T> less(const T & value) { return {value, value}; }
+
+template <int idx, typename T>
+detail::compare_predicate<detail::op_less_equal, idx, T> less_equal(const T & value) { return {value, value}; }
+
+template <int idx, typename T>
+detail::compare_predicate<detail::op_greater, idx, T> greater(const T & value) { return {value, value}; }
+
+template <int idx, typename T>
+detail::compare_predicate<detail::op_greater_equal, idx, T> greater_equal(const T & value) { return {value, value}; }
+
+template <int idx, typename T>
+detail::compare_predicate<detail::op_between, idx, T> between(const T & lower, const T & upper) { return {lower, upper}; }
+
+template <int idx, typename F>
+detail::function_predicate<idx, F> where(F f) { return {f}; }
+
+// Elements which satisfy every predicate
+template <typename S, typename... Ps>
+selection select(const soa_vector<S> & v, const Ps &... predicates) {
+  const std::size_t size = v.size();
+  selection result(size);
+  std::size_t count = 0;
+  unsigned char mask[detail::block_size];
+
+  for (std::size_t begin = 0; begin < size; begin += detail::block_size) {
+    const std::size_t n = std::min(detail::block_size, size - begin);
+    std::memset(mask, 1, n);
+    (void) detail::swallow{ 0, (predicates.apply(v, begin, n, mask), 0)... };
+    // Always store, only advance when selected
+    for (std::size_t i = 0; i < n; ++i) {
+      result[count] = begin + i;
+      count += mask[i];
+    }
+  }
+  result.resize(count);
+  return result;
+}
+
+// Number of elements which satisfy every predicate
+template <typename S, typename... Ps>
+std::size_t count(const soa_vector<S> & v, const Ps &... predicates) {
+  const std::size_t size = v.size();
+  std::size_t result = 0;
+  unsigned char mask[detail::block_size];
+
+  for (std::size_t begin = 0; begin < size; begin += detail::block_size) {
+    const std::size_t n = std::min(detail::block_size, size - begin);
+    std::memset(mask, 1, n);
+    (void) detail::swallow{ 0, (predicates.apply(v, begin, n, mask), 0)... };
+    for (std::size_t i = 0; i < n; ++i) { result += mask[i]; }
+  }
+  return result;
+}
+
+// Values of member `idx` of the selected elements
+template <int idx, typename S>
+std::vector<type_at<idx, S>> gather(const soa_vector<S> & v, const selection & s) {
+  std::vector<type_at<idx, S>> result;
+  detail::take_columns<S>::gather(result, v.template column<idx>(), s);
+  return result;
+}
+
+// The selected elements, all columns
+template <typename S>
+soa_vector<S> take(const soa_vector<S> & v, const selection & s) {
+  soa_vector<S> result;
+  detail::take_columns<S>::apply(result, v, s);
+  return result;
+}
+
+} // end namespace query
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_QUERY_HPP_INCLUDED
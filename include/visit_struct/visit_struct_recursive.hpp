@@ -0,0 +1,267 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_RECURSIVE_HPP_INCLUDED
+#define VISIT_STRUCT_RECURSIVE_HPP_INCLUDED
+
+/***
+ * Recursive visitation through nested visitable structures.
+ *
+ * `for_each_recursive(s, v)` descends into every registered member which is
+ * itself visitable, and calls `v(path, member)` for the remaining "leaf"
+ * members. The path is the dotted sequence of member names leading to the
+ * leaf, e.g. "order.price". Each path is a string with static storage built
+ * at compile time from the registered names, so there is no per-call string
+ * building or allocation.
+ *
+ * The same leaves can be indexed at compile time: `flat_field_count<S>()` is
+ * the number of leaves, and `get_flat<idx>(s)`, `flat_type_at<idx, S>` and
+ * `get_flat_name<idx, S>()` are the flattened counterparts of `get`,
+ * `type_at` and `get_name`. Leaves are numbered in the order in which
+ * `for_each_recursive` visits them.
+ *
+ * Building paths at compile time requires `get_name` to return references to
+ * character arrays, which is the case for VISITABLE_STRUCT and the intrusive
+ * syntax.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace visit_struct {
+
+namespace detail {
+
+// One step of a path: member `idx` of struct `S`
+template <typename S, int idx>
+struct path_segment {};
+
+template <typename... Segments>
+struct path {};
+
+template <typename P, typename Segment>
+struct path_append;
+
+template <typename... Segments, typename Segment>
+struct path_append<path<Segments...>, Segment> {
+  typedef path<Segments..., Segment> type;
+};
+
+// Length of a member name, without the terminator
+template <typename S, int idx>
+struct name_length {
+  typedef typename std::remove_reference<decltype(visit_struct::get_name<idx, S>())>::type name_type;
+  static_assert(std::is_array<name_type>::value,
+                "compile-time member paths require get_name to return a character array");
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = std::extent<name_type>::value - 1;
+};
+
+template <typename P>
+struct path_chars;
+
+template <>
+struct path_chars<path<>> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t length = 0;
+  static VISIT_STRUCT_CONSTEXPR char at(std::size_t) { return '\0'; }
+};
+
+template <typename S, int idx, typename... Rest>
+struct path_chars<path<path_segment<S, idx>, Rest...>> {
+  typedef path_chars<path<Rest...>> rest;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t head = name_length<S, idx>::value;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t length = head + (sizeof...(Rest) ? 1 + rest::length : 0);
+
+  // i-th character of the dotted path
+  static VISIT_STRUCT_CONSTEXPR char at(std::size_t i) {
+    return i < head ? visit_struct::get_name<idx, S>()[i]
+                    : i == head ? (sizeof...(Rest) ? '.' : '\0')
+                                : rest::at(i - head - 1);
+  }
+};
+
+template <typename P, typename Seq = make_integer_sequence<std::size_t, path_chars<P>::length>>
+struct path_string;
+
+template <typename P, std::size_t... Is>
+struct path_string<P, integer_sequence<std::size_t, Is...>> {
+  static VISIT_STRUCT_CONSTEXPR const char value[sizeof...(Is) + 1] = { path_chars<P>::at(Is)..., '\0' };
+};
+
+template <typename P, std::size_t... Is>
+VISIT_STRUCT_CONSTEXPR const char path_string<P, integer_sequence<std::size_t, Is...>>::value[sizeof...(Is) + 1];
+
+// Recursive traversal, P is the path to the structure currently visited
+template <typename P>
+struct recursive_visitor {
+  template <typename S, typename V>
+  static void apply(S && s, V && v) {
+    apply_members(std::forward<S>(s), v, field_indices<S>{});
+  }
+
+  template <typename S, typename V, int... Is>
+  static void apply_members(S && s, V & v, integer_sequence<int, Is...>) {
+    (void) swallow{ 0, (visit_member<Is>(std::forward<S>(s), v), 0)... };
+  }
+
+  template <int idx, typename S, typename V>
+  static void visit_member(S && s, V & v) {
+    typedef traits::clean_t<S> struct_type;
+    typedef typename path_append<P, path_segment<struct_type, idx>>::type member_path;
+    dispatch<member_path>(visit_struct::get<idx>(std::forward<S>(s)), v,
+                          traits::is_visitable<type_at<idx, struct_type>>{});
+  }
+
+  template <typename MP, typename T, typename V>
+  static void dispatch(T && t, V & v, std::true_type) {
+    recursive_visitor<MP>::apply(std::forward<T>(t), v);
+  }
+
+  template <typename MP, typename T, typename V>
+  static void dispatch(T && t, V & v, std::false_type) {
+    v(path_string<MP>::value, std::forward<T>(t));
+  }
+};
+
+/***
+ * Flattened indexing: a list of the paths to all leaves of a structure
+ */
+
+template <typename... Paths>
+struct path_list {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t size = sizeof...(Paths);
+};
+
+template <typename... Lists>
+struct path_list_concat;
+
+template <>
+struct path_list_concat<> {
+  typedef path_list<> type;
+};
+
+template <typename... Ps>
+struct path_list_concat<path_list<Ps...>> {
+  typedef path_list<Ps...> type;
+};
+
+template <typename... Ps, typename... Qs, typename... Rest>
+struct path_list_concat<path_list<Ps...>, path_list<Qs...>, Rest...>
+  : path_list_concat<path_list<Ps..., Qs...>, Rest...> {};
+
+template <typename P, typename S, typename Seq = field_indices<S>>
+struct flatten;
+
+template <typename P, typename S, int idx, bool = traits::is_visitable<type_at<idx, S>>::value>
+struct flatten_member {
+  typedef typename flatten<typename path_append<P, path_segment<S, idx>>::type, type_at<idx, S>>::type type;
+};
+
+template <typename P, typename S, int idx>
+struct flatten_member<P, S, idx, false> {
+  typedef path_list<typename path_append<P, path_segment<S, idx>>::type> type;
+};
+
+template <typename P, typename S, int... Is>
+struct flatten<P, S, integer_sequence<int, Is...>> {
+  typedef typename path_list_concat<typename flatten_member<P, S, Is>::type...>::type type;
+};
+
+template <typename S>
+using flat_paths = typename flatten<path<>, traits::clean_t<S>>::type;
+
+template <typename List, std::size_t idx>
+struct path_list_at;
+
+template <typename P, typename... Ps>
+struct path_list_at<path_list<P, Ps...>, 0> {
+  typedef P type;
+};
+
+template <typename P, typename... Ps, std::size_t idx>
+struct path_list_at<path_list<P, Ps...>, idx> : path_list_at<path_list<Ps...>, idx - 1> {};
+
+template <typename S, std::size_t idx>
+using flat_path = typename path_list_at<flat_paths<S>, idx>::type;
+
+// Follow a path from an instance to the member it designates
+template <typename P>
+struct path_getter;
+
+template <>
+struct path_getter<path<>> {
+  template <typename T>
+  static VISIT_STRUCT_CONSTEXPR T && get(T && t) { return std::forward<T>(t); }
+};
+
+template <typename S, int idx, typename... Rest>
+struct path_getter<path<path_segment<S, idx>, Rest...>> {
+  template <typename T>
+  static VISIT_STRUCT_CONSTEXPR auto get(T && t) ->
+    decltype(path_getter<path<Rest...>>::get(visit_struct::get<idx>(std::forward<T>(t)))) {
+    return path_getter<path<Rest...>>::get(visit_struct::get<idx>(std::forward<T>(t)));
+  }
+};
+
+template <typename P>
+struct path_type;
+
+template <typename S, int idx>
+struct path_type<path<path_segment<S, idx>>> {
+  typedef type_at<idx, S> type;
+};
+
+template <typename S, int idx, typename... Rest>
+struct path_type<path<path_segment<S, idx>, Rest...>> : path_type<path<Rest...>> {};
+
+} // end namespace detail
+
+// Number of leaf members of a visitable structure, counted through nested visitable members
+template <typename S>
+VISIT_STRUCT_CONSTEXPR std::size_t flat_field_count() {
+  return detail::flat_paths<S>::size;
+}
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR std::size_t flat_field_count(S &&) { return flat_field_count<S>(); }
+
+// Get leaf member by flattened index
+template <std::size_t idx, typename S>
+VISIT_STRUCT_CONSTEXPR auto get_flat(S && s) ->
+  decltype(detail::path_getter<detail::flat_path<S, idx>>::get(std::forward<S>(s))) {
+  return detail::path_getter<detail::flat_path<S, idx>>::get(std::forward<S>(s));
+}
+
+// Get dotted path of leaf member, by flattened index
+template <std::size_t idx, typename S>
+VISIT_STRUCT_CONSTEXPR auto get_flat_name() -> decltype((detail::path_string<detail::flat_path<S, idx>>::value)) {
+  return detail::path_string<detail::flat_path<S, idx>>::value;
+}
+
+template <std::size_t idx, typename S>
+VISIT_STRUCT_CONSTEXPR auto get_flat_name(S &&) -> decltype(get_flat_name<idx, S>()) {
+  return get_flat_name<idx, S>();
+}
+
+// Get type of leaf member, by flattened index
+template <std::size_t idx, typename S>
+using flat_type_at = typename detail::path_type<detail::flat_path<S, idx>>::type;
+
+// Visit the leaf members of a visitable structure, descending into visitable members.
+// The visitor is called as v("outer.inner.leaf", leaf).
+template <typename S, typename V>
+auto for_each_recursive(S && s, V && v) ->
+  typename std::enable_if<
+             traits::is_visitable<traits::clean_t<S>>::value
+           >::type
+{
+  detail::recursive_visitor<detail::path<>>::apply(std::forward<S>(s), v);
+}
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_RECURSIVE_HPP_INCLUDED
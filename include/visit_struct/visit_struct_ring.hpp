@@ -0,0 +1,264 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_RING_HPP_INCLUDED
+#define VISIT_STRUCT_RING_HPP_INCLUDED
+
+/***
+ * `visit_struct::record_ring<S>` is a bounded, lock-free queue of visitable
+ * records from many producer threads to a single consumer thread.
+ *
+ * Records are not stored as `S`, but in a fixed layout: the registered members
+ * back to back, without padding, at offsets known at compile time. Producers
+ * write members directly into a claimed slot, and the consumer reads them
+ * straight out of the slot, one member at a time if it only needs a few:
+ *
+ *   ring.try_emplace([&](visit_struct::record_writer<order> & w) {
+ *     w.set<0>(id);
+ *     w.set<1>(price);
+ *   });
+ *
+ *   ring.try_consume([&](const visit_struct::record_view<order> & r) {
+ *     if (r.get<1>() > limit) { handle(r.decode()); }
+ *   });
+ *
+ * Members not set by a producer hold whatever the slot held before. Each slot
+ * carries a sequence number, as in Dmitry Vyukov's bounded MPMC queue:
+ * producers claim slots with a compare-exchange on the tail, and publish them
+ * with a release store of the sequence number, which the consumer acquires.
+ *
+ * Members must be trivially copyable. The function passed to `try_emplace`
+ * must not throw, as a claimed slot cannot be given back. If the function
+ * passed to `try_consume` throws, the record stays at the front of the ring.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_cache_line.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+
+namespace visit_struct {
+
+namespace detail {
+
+// Offset of member `idx` in the fixed layout of S
+template <typename S, int idx>
+struct packed_offset {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = packed_offset<S, idx - 1>::value + sizeof(type_at<idx - 1, S>);
+};
+
+template <typename S>
+struct packed_offset<S, 0> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t value = 0;
+};
+
+struct ring_member_check {
+  template <typename T>
+  void operator()(const char *, type_c<T>) const {
+    static_assert(std::is_trivially_copyable<T>::value, "record_ring requires trivially copyable members");
+  }
+};
+
+// Walk the members through their pointers, with the running offset in the fixed layout
+template <typename S>
+struct packed_store {
+  unsigned char * out;
+  const S & s;
+
+  template <typename T>
+  void operator()(const char *, T S::* member) {
+    std::memcpy(out, &(s.*member), sizeof(T));
+    out += sizeof(T);
+  }
+};
+
+template <typename S>
+struct packed_load {
+  const unsigned char * in;
+  S & s;
+
+  template <typename T>
+  void operator()(const char *, T S::* member) {
+    std::memcpy(&(s.*member), in, sizeof(T));
+    in += sizeof(T);
+  }
+};
+
+} // end namespace detail
+
+// Write access to a claimed slot
+template <typename S>
+class record_writer {
+  unsigned char * data_;
+
+public:
+  static VISIT_STRUCT_CONSTEXPR const std::size_t size = detail::packed_offset<S, visit_struct::field_count<S>()>::value;
+
+  explicit record_writer(unsigned char * data) : data_(data) {}
+
+  template <int idx>
+  void set(const type_at<idx, S> & value) {
+    std::memcpy(data_ + detail::packed_offset<S, idx>::value, &value, sizeof(value));
+  }
+
+  // Write every member
+  void assign(const S & s) {
+    visit_struct::visit_pointers<S>(detail::packed_store<S>{data_, s});
+  }
+
+  unsigned char * data() { return data_; }
+};
+
+// Read access to a published slot
+template <typename S>
+class record_view {
+  const unsigned char * data_;
+
+public:
+  static VISIT_STRUCT_CONSTEXPR const std::size_t size = record_writer<S>::size;
+
+  explicit record_view(const unsigned char * data) : data_(data) {}
+
+  template <int idx>
+  type_at<idx, S> get() const {
+    type_at<idx, S> value;
+    std::memcpy(&value, data_ + detail::packed_offset<S, idx>::value, sizeof(value));
+    return value;
+  }
+
+  // Read every member
+  void decode(S & s) const {
+    visit_struct::visit_pointers<S>(detail::packed_load<S>{data_, s});
+  }
+
+  S decode() const {
+    S s;
+    this->decode(s);
+    return s;
+  }
+
+  const unsigned char * data() const { return data_; }
+};
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR const std::size_t record_writer<S>::size;
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR const std::size_t record_view<S>::size;
+
+template <typename S>
+class record_ring {
+  static_assert(traits::is_visitable<S>::value, "record_ring requires a visitable structure");
+
+  struct slot_header {
+    std::atomic<std::size_t> sequence;
+  };
+
+  static VISIT_STRUCT_CONSTEXPR const std::size_t header_size =
+    (sizeof(slot_header) + alignof(slot_header) - 1) / alignof(slot_header) * alignof(slot_header);
+  static VISIT_STRUCT_CONSTEXPR const std::size_t stride =
+    (header_size + record_writer<S>::size + alignof(slot_header) - 1) / alignof(slot_header) * alignof(slot_header);
+
+  alignas(VISIT_STRUCT_CACHE_LINE_SIZE) std::atomic<std::size_t> tail_;
+  alignas(VISIT_STRUCT_CACHE_LINE_SIZE) std::size_t head_;
+  std::size_t mask_;
+  std::unique_ptr<unsigned char[]> storage_;
+  unsigned char * slots_;
+
+  static std::size_t round_capacity(std::size_t n) {
+    std::size_t c = 2;
+    while (c < n) { c *= 2; }
+    return c;
+  }
+
+  slot_header & header(std::size_t pos) const {
+    return *reinterpret_cast<slot_header *>(slots_ + (pos & mask_) * stride);
+  }
+
+  unsigned char * payload(std::size_t pos) const {
+    return slots_ + (pos & mask_) * stride + header_size;
+  }
+
+public:
+  // Capacity is rounded up to a power of two
+  explicit record_ring(std::size_t capacity)
+    : tail_(0)
+    , head_(0)
+    , mask_(round_capacity(capacity) - 1)
+    , storage_(new unsigned char[(mask_ + 1) * stride + alignof(slot_header)]())
+  {
+    visit_struct::visit_types<S>(detail::ring_member_check{});
+    void * p = storage_.get();
+    std::size_t space = (mask_ + 1) * stride + alignof(slot_header);
+    slots_ = static_cast<unsigned char *>(std::align(alignof(slot_header), (mask_ + 1) * stride, p, space));
+    for (std::size_t i = 0; i <= mask_; ++i) {
+      new (&this->header(i)) slot_header;
+      this->header(i).sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~record_ring() {
+    for (std::size_t i = 0; i <= mask_; ++i) { this->header(i).~slot_header(); }
+  }
+
+  record_ring(const record_ring &) = delete;
+  record_ring & operator = (const record_ring &) = delete;
+
+  std::size_t capacity() const { return mask_ + 1; }
+
+  // Producers: claim a slot, call fill(record_writer<S> &) on it and publish
+  // it. Returns false, without calling fill, if the ring is full.
+  template <typename F>
+  bool try_emplace(F && fill) {
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+      slot_header & h = this->header(pos);
+      const std::size_t seq = h.sequence.load(std::memory_order_acquire);
+      const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq - pos);
+      if (diff == 0) {
+        if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          record_writer<S> w{this->payload(pos)};
+          fill(w);
+          h.sequence.store(pos + 1, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_push(const S & s) {
+    return this->try_emplace([&s](record_writer<S> & w) { w.assign(s); });
+  }
+
+  // Consumer: call f(const record_view<S> &) on the oldest record and
+  // release its slot. Returns false if the ring is empty.
+  template <typename F>
+  bool try_consume(F && f) {
+    slot_header & h = this->header(head_);
+    if (h.sequence.load(std::memory_order_acquire) != head_ + 1) { return false; }
+    f(record_view<S>{this->payload(head_)});
+    h.sequence.store(head_ + this->capacity(), std::memory_order_release);
+    ++head_;
+    return true;
+  }
+
+  bool try_pop(S & s) {
+    return this->try_consume([&s](const record_view<S> & r) { r.decode(s); });
+  }
+};
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_RING_HPP_INCLUDED
@@ -0,0 +1,186 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_SCHEMA_HPP_INCLUDED
+#define VISIT_STRUCT_SCHEMA_HPP_INCLUDED
+
+/***
+ * `visit_struct::schema_hash<S>()` is a 64-bit fingerprint of the layout of a
+ * visitable structure, computed at compile time with C++11 constexpr.
+ *
+ * The hash is FNV-1a over the name of the structure, the number of members,
+ * and the name and type of each member in registration order. Member types
+ * contribute through `visit_struct::type_hash<T>`:
+ *
+ *   - bool, char and other arithmetic types hash their kind and size
+ *   - enums hash their underlying type
+ *   - C arrays and std::array hash their extent and element type
+ *   - std::basic_string and std::vector hash their element type
+ *   - visitable structures hash as their own schema_hash, recursively
+ *
+ * Other member types must specialize `type_hash`, otherwise the hash fails to
+ * compile. Since sizes are part of the hash, a schema can hash differently on
+ * platforms where e.g. `long` has a different width, which matches the fact
+ * that its binary encoding differs.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace visit_struct {
+
+typedef std::uint64_t schema_hash_type;
+
+namespace detail {
+
+static VISIT_STRUCT_CONSTEXPR const schema_hash_type fnv_offset_basis = 14695981039346656037ull;
+static VISIT_STRUCT_CONSTEXPR const schema_hash_type fnv_prime = 1099511628211ull;
+
+// FNV-1a over the characters of a string, not including the terminator
+inline VISIT_STRUCT_CONSTEXPR schema_hash_type fnv1a(const char * s, schema_hash_type h) {
+  return *s ? fnv1a(s + 1, (h ^ static_cast<unsigned char>(*s)) * fnv_prime) : h;
+}
+
+// FNV-1a over the bytes of a value, least significant first
+inline VISIT_STRUCT_CONSTEXPR schema_hash_type fnv1a(std::uint64_t v, schema_hash_type h, int bytes = 8) {
+  return bytes ? fnv1a(v >> 8, (h ^ (v & 0xff)) * fnv_prime, bytes - 1) : h;
+}
+
+// FNV-1a over a range of bytes, at run time
+inline schema_hash_type fnv1a_bytes(const char * data, std::size_t size, schema_hash_type h = fnv_offset_basis) {
+  for (std::size_t i = 0; i < size; ++i) {
+    h = (h ^ static_cast<unsigned char>(data[i])) * fnv_prime;
+  }
+  return h;
+}
+
+// Hash of a tag string followed by a number of values
+inline VISIT_STRUCT_CONSTEXPR schema_hash_type tagged_hash(const char * tag, std::uint64_t a) {
+  return fnv1a(a, fnv1a(tag, fnv_offset_basis));
+}
+
+inline VISIT_STRUCT_CONSTEXPR schema_hash_type tagged_hash(const char * tag, std::uint64_t a, std::uint64_t b) {
+  return fnv1a(b, tagged_hash(tag, a));
+}
+
+template <typename T>
+struct dependent_false : std::false_type {};
+
+} // end namespace detail
+
+/***
+ * Hash of a member type. Specialize this for types which are not covered
+ * below, with a function `static constexpr schema_hash_type value()`.
+ */
+
+template <typename T, typename ENABLE = void>
+struct type_hash {
+  static_assert(detail::dependent_false<T>::value,
+                "no schema hash for this member type, specialize visit_struct::type_hash");
+};
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR auto schema_hash() ->
+  typename std::enable_if<
+             traits::is_visitable<traits::clean_t<S>>::value,
+             schema_hash_type
+           >::type;
+
+template <>
+struct type_hash<bool> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("bool", sizeof(bool)); }
+};
+
+template <>
+struct type_hash<char> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("char", sizeof(char)); }
+};
+
+template <typename T>
+struct type_hash<T, typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value &&
+                                            !std::is_same<T, char>::value>::type> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("int", sizeof(T)); }
+};
+
+template <typename T>
+struct type_hash<T, typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value &&
+                                            !std::is_same<T, bool>::value &&
+                                            !std::is_same<T, char>::value>::type> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("uint", sizeof(T)); }
+};
+
+template <typename T>
+struct type_hash<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("float", sizeof(T)); }
+};
+
+template <typename T>
+struct type_hash<T, typename std::enable_if<std::is_enum<T>::value>::type> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() {
+    return detail::tagged_hash("enum", type_hash<typename std::underlying_type<T>::type>::value());
+  }
+};
+
+template <typename T, std::size_t N>
+struct type_hash<T[N]> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("array", N, type_hash<T>::value()); }
+};
+
+template <typename T, std::size_t N>
+struct type_hash<std::array<T, N>> : type_hash<T[N]> {};
+
+template <typename C, typename Tr, typename A>
+struct type_hash<std::basic_string<C, Tr, A>> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("string", type_hash<C>::value()); }
+};
+
+template <typename T, typename A>
+struct type_hash<std::vector<T, A>> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return detail::tagged_hash("vector", type_hash<T>::value()); }
+};
+
+template <typename T>
+struct type_hash<T, typename std::enable_if<traits::is_visitable<T>::value>::type> {
+  static VISIT_STRUCT_CONSTEXPR schema_hash_type value() { return visit_struct::schema_hash<T>(); }
+};
+
+namespace detail {
+
+struct schema_hash_step {
+  template <typename T>
+  VISIT_STRUCT_CONSTEXPR schema_hash_type operator()(schema_hash_type h, const char * name, type_c<T>) const {
+    return fnv1a(type_hash<T>::value(), fnv1a(name, h));
+  }
+};
+
+} // end namespace detail
+
+// Fingerprint of the name, member names and member types of a visitable structure
+template <typename S>
+VISIT_STRUCT_CONSTEXPR auto schema_hash() ->
+  typename std::enable_if<
+             traits::is_visitable<traits::clean_t<S>>::value,
+             schema_hash_type
+           >::type
+{
+  return visit_struct::fold_types<S>(
+    detail::schema_hash_step{},
+    detail::fnv1a(visit_struct::field_count<S>(), detail::fnv1a(visit_struct::get_name<S>(), detail::fnv_offset_basis)));
+}
+
+template <typename S>
+VISIT_STRUCT_CONSTEXPR auto schema_hash(S &&) -> decltype(schema_hash<S>()) {
+  return schema_hash<S>();
+}
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_SCHEMA_HPP_INCLUDED
@@ -0,0 +1,152 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_SEQLOCK_HPP_INCLUDED
+#define VISIT_STRUCT_SEQLOCK_HPP_INCLUDED
+
+/***
+ * `visit_struct::seqlock<S>` publishes a visitable structure from one writer
+ * to any number of readers, without locks.
+ *
+ * The writer bumps a sequence number to an odd value, stores the members, and
+ * bumps it to the next even value. A reader copies the members and retries if
+ * the sequence number was odd or changed meanwhile, so it never returns a torn
+ * snapshot and never blocks the writer.
+ *
+ * Each registered member is kept in its own array of atomic words, and all
+ * accesses to them are relaxed atomic operations ordered by fences on the
+ * sequence number. There are no data races in the sense of the C++ memory
+ * model, so race detectors such as TSan stay quiet.
+ *
+ * Members must be trivially copyable. Concurrent calls to `store` must be
+ * serialized by the caller.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_cache_line.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+
+namespace visit_struct {
+
+namespace detail {
+
+// Storage of one member as atomic words
+template <typename T>
+class seqlock_cell {
+  typedef std::uintptr_t word_type;
+  static VISIT_STRUCT_CONSTEXPR const std::size_t count = (sizeof(T) + sizeof(word_type) - 1) / sizeof(word_type);
+
+  std::atomic<word_type> words_[count];
+
+public:
+  seqlock_cell() {
+    for (std::size_t i = 0; i < count; ++i) { words_[i].store(0, std::memory_order_relaxed); }
+  }
+
+  void store(const T & t) {
+    word_type buffer[count] = {};
+    std::memcpy(buffer, &t, sizeof(T));
+    for (std::size_t i = 0; i < count; ++i) {
+      words_[i].store(buffer[i], std::memory_order_relaxed);
+    }
+  }
+
+  void load(T & t) const {
+    word_type buffer[count];
+    for (std::size_t i = 0; i < count; ++i) {
+      buffer[i] = words_[i].load(std::memory_order_relaxed);
+    }
+    std::memcpy(&t, buffer, sizeof(T));
+  }
+};
+
+template <typename S, typename Seq = field_indices<S>>
+struct seqlock_cells;
+
+template <typename S, int... Is>
+struct seqlock_cells<S, integer_sequence<int, Is...>> {
+  typedef std::tuple<seqlock_cell<type_at<Is, S>>...> type;
+
+  static void store(type & cells, const S & s) {
+    (void) swallow{ 0, (std::get<Is>(cells).store(visit_struct::get<Is>(s)), 0)... };
+  }
+
+  static void load(const type & cells, S & s) {
+    (void) swallow{ 0, (std::get<Is>(cells).load(visit_struct::get<Is>(s)), 0)... };
+  }
+};
+
+struct seqlock_member_check {
+  template <typename T>
+  void operator()(const char *, type_c<T>) const {
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock requires trivially copyable members");
+  }
+};
+
+} // end namespace detail
+
+template <typename S>
+class seqlock {
+  static_assert(traits::is_visitable<S>::value, "seqlock requires a visitable structure");
+
+  typedef detail::seqlock_cells<S> cells;
+
+  alignas(VISIT_STRUCT_CACHE_LINE_SIZE) std::atomic<std::uint64_t> sequence_;
+  typename cells::type cells_;
+
+public:
+  explicit seqlock(const S & s = S{}) : sequence_(0) {
+    visit_struct::visit_types<S>(detail::seqlock_member_check{});
+    cells::store(cells_, s);
+  }
+
+  seqlock(const seqlock &) = delete;
+  seqlock & operator = (const seqlock &) = delete;
+
+  // Publish a new value. Only one thread may store at a time.
+  void store(const S & s) {
+    const std::uint64_t seq = sequence_.load(std::memory_order_relaxed);
+    sequence_.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    cells::store(cells_, s);
+    sequence_.store(seq + 2, std::memory_order_release);
+  }
+
+  // Take one snapshot attempt. Returns false if a store was in progress, in
+  // which case `s` holds an unspecified mix of values.
+  bool try_load(S & s) const {
+    const std::uint64_t before = sequence_.load(std::memory_order_acquire);
+    if (before & 1) { return false; }
+    cells::load(cells_, s);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence_.load(std::memory_order_relaxed) == before;
+  }
+
+  // Take a consistent snapshot, retrying while stores are in progress
+  void load(S & s) const {
+    while (!this->try_load(s)) {}
+  }
+
+  S load() const {
+    S s;
+    this->load(s);
+    return s;
+  }
+
+  // Number of completed stores
+  std::uint64_t version() const {
+    return sequence_.load(std::memory_order_acquire) / 2;
+  }
+};
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_SEQLOCK_HPP_INCLUDED
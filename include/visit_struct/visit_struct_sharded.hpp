@@ -0,0 +1,306 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_SHARDED_HPP_INCLUDED
+#define VISIT_STRUCT_SHARDED_HPP_INCLUDED
+
+/***
+ * `visit_struct::sharded<S>` spreads a statistics structure over several
+ * cache line aligned copies ("shards"), so that many threads can update it
+ * without contending on the same cache lines.
+ *
+ * Each thread is assigned a shard the first time it updates any `sharded`
+ * object, round robin. `update(value)` combines `value` into the shard of the
+ * calling thread, and `load()` combines all shards into one result with the
+ * two-instance `for_each`.
+ *
+ * How each member is combined is chosen per member, and defaults to sum:
+ *
+ *   VISITABLE_STRUCT(latency_stats, count, total, worst, best);
+ *   VISITABLE_COMBINE(latency_stats, sum, sum, max, min);
+ *
+ * Members must be arithmetic. The members of a shard are relaxed atomics, so
+ * threads which share a shard (when there are more threads than shards) don't
+ * race. `load` reads the shards member by member while updates continue, so
+ * like `atomic_mirror`, it may combine values from different moments.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_cache_line.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+
+namespace visit_struct {
+
+enum class combine { sum, min, max };
+
+template <combine... Cs>
+struct combine_list {};
+
+// Primary template, specialize it (usually with VISITABLE_COMBINE) to derive
+// from a `combine_list` with one policy per registered member
+template <typename S>
+struct combine_policies;
+
+namespace detail {
+
+template <int>
+struct always_sum {
+  static VISIT_STRUCT_CONSTEXPR const combine value = combine::sum;
+};
+
+template <typename S, typename Seq = field_indices<S>>
+struct default_policies;
+
+template <typename S, int... Is>
+struct default_policies<S, integer_sequence<int, Is...>> {
+  typedef combine_list<always_sum<Is>::value...> type;
+};
+
+template <typename S>
+struct has_policies {
+  template <typename U>
+  static std::true_type test(decltype(sizeof(combine_policies<U>)) *);
+  template <typename U>
+  static std::false_type test(...);
+  static VISIT_STRUCT_CONSTEXPR const bool value = decltype(test<S>(nullptr))::value;
+};
+
+template <combine... Cs>
+combine_list<Cs...> policies_of(const combine_list<Cs...> &);
+
+template <typename S, bool = has_policies<S>::value>
+struct policies {
+  typedef decltype(detail::policies_of(combine_policies<S>{})) type;
+};
+
+template <typename S>
+struct policies<S, false> : default_policies<S> {};
+
+template <combine First, combine... Cs>
+struct drop_first {
+  typedef combine_list<Cs...> type;
+};
+
+template <typename L>
+struct policy_table;
+
+template <combine... Cs>
+struct policy_table<combine_list<Cs...>> {
+  static VISIT_STRUCT_CONSTEXPR const std::size_t size = sizeof...(Cs);
+
+  static const combine * get() {
+    static const combine values[] = { Cs... };
+    return values;
+  }
+};
+
+template <typename L, std::size_t idx>
+struct policy_at;
+
+template <combine C, combine... Cs>
+struct policy_at<combine_list<C, Cs...>, 0> {
+  static VISIT_STRUCT_CONSTEXPR const combine value = C;
+};
+
+template <combine C, combine... Cs, std::size_t idx>
+struct policy_at<combine_list<C, Cs...>, idx> : policy_at<combine_list<Cs...>, idx - 1> {};
+
+// Neutral element and combination of two values
+template <typename T>
+T combine_identity(combine c) {
+  return c == combine::sum ? T(0)
+       : c == combine::min ? std::numeric_limits<T>::max()
+                           : std::numeric_limits<T>::lowest();
+}
+
+template <typename T>
+T combine_values(combine c, T a, T b) {
+  return c == combine::sum ? static_cast<T>(a + b)
+       : c == combine::min ? (b < a ? b : a)
+                           : (a < b ? b : a);
+}
+
+// Combine into an atomic, compare_exchange loop unless there is a fetch_add
+template <typename T>
+void combine_atomic(std::atomic<T> & a, T v, std::integral_constant<combine, combine::sum>,
+                    typename std::enable_if<std::is_integral<T>::value>::type * = nullptr) {
+  a.fetch_add(v, std::memory_order_relaxed);
+}
+
+template <typename T, combine C>
+void combine_atomic(std::atomic<T> & a, T v, std::integral_constant<combine, C>,
+                    typename std::enable_if<!std::is_integral<T>::value || C != combine::sum>::type * = nullptr) {
+  T current = a.load(std::memory_order_relaxed);
+  T next = combine_values(C, current, v);
+  // Nothing to do if a min / max doesn't change
+  while (next != current && !a.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+    next = combine_values(C, current, v);
+  }
+}
+
+// Two-instance visitor which combines the second instance into the first
+struct combine_visitor {
+  const combine * policies;
+  std::size_t index;
+
+  template <typename T>
+  void operator()(const char *, T & acc, const T & v) {
+    acc = combine_values(policies[index++], acc, v);
+  }
+};
+
+struct identity_visitor {
+  const combine * policies;
+  std::size_t index;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    static_assert(std::is_arithmetic<T>::value, "sharded requires arithmetic members");
+    t = combine_identity<T>(policies[index++]);
+  }
+};
+
+template <typename S, typename Seq = field_indices<S>>
+struct shard_cells;
+
+template <typename S, int... Is>
+struct shard_cells<S, integer_sequence<int, Is...>> {
+  typedef typename policies<S>::type list;
+  typedef std::tuple<std::atomic<type_at<Is, S>>...> type;
+
+  static void store(type & cells, const S & s) {
+    (void) swallow{ 0, (std::get<Is>(cells).store(visit_struct::get<Is>(s), std::memory_order_relaxed), 0)... };
+  }
+
+  static void load(const type & cells, S & s) {
+    (void) swallow{ 0, (visit_struct::get<Is>(s) = std::get<Is>(cells).load(std::memory_order_relaxed), 0)... };
+  }
+
+  static void update(type & cells, const S & s) {
+    (void) swallow{ 0, (combine_atomic(std::get<Is>(cells), visit_struct::get<Is>(s),
+                                       std::integral_constant<combine, policy_at<list, Is>::value>{}), 0)... };
+  }
+};
+
+// Small index of the calling thread, assigned on first use
+inline std::size_t thread_slot() {
+  static std::atomic<std::size_t> next{0};
+  static thread_local const std::size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+  return slot;
+}
+
+} // end namespace detail
+
+template <typename S>
+class sharded {
+  static_assert(traits::is_visitable<S>::value, "sharded requires a visitable structure");
+
+  typedef detail::shard_cells<S> cells;
+  typedef typename detail::policies<S>::type list;
+  typedef detail::policy_table<list> table;
+  static_assert(table::size == visit_struct::field_count<S>(), "combine_policies must give one policy per registered member");
+
+  struct alignas(VISIT_STRUCT_CACHE_LINE_SIZE) shard {
+    typename cells::type values;
+  };
+
+  // Storage is aligned by hand, operator new doesn't respect extended alignment before C++17
+  std::unique_ptr<unsigned char[]> storage_;
+  shard * shards_;
+  std::size_t count_;
+
+  static S identity() {
+    S s;
+    visit_struct::for_each(s, detail::identity_visitor{table::get(), 0});
+    return s;
+  }
+
+  shard & local() {
+    return shards_[detail::thread_slot() % count_];
+  }
+
+public:
+  static std::size_t default_shard_count() {
+    const unsigned n = std::thread::hardware_concurrency();
+    return n ? n : 1;
+  }
+
+  explicit sharded(std::size_t shards = default_shard_count())
+    : storage_(new unsigned char[(shards ? shards : 1) * sizeof(shard) + alignof(shard)])
+    , count_(shards ? shards : 1)
+  {
+    void * p = storage_.get();
+    std::size_t space = count_ * sizeof(shard) + alignof(shard);
+    p = std::align(alignof(shard), count_ * sizeof(shard), p, space);
+    shards_ = static_cast<shard *>(p);
+    for (std::size_t i = 0; i < count_; ++i) { new (shards_ + i) shard; }
+    this->reset();
+  }
+
+  ~sharded() {
+    for (std::size_t i = 0; i < count_; ++i) { shards_[i].~shard(); }
+  }
+
+  sharded(const sharded &) = delete;
+  sharded & operator = (const sharded &) = delete;
+
+  // Combine `value` into the shard of the calling thread
+  void update(const S & value) {
+    cells::update(this->local().values, value);
+  }
+
+  // Combine a single member into the shard of the calling thread
+  template <int idx>
+  void update(const type_at<idx, S> & value) {
+    detail::combine_atomic(std::get<idx>(this->local().values), value,
+                           std::integral_constant<combine, detail::policy_at<list, idx>::value>{});
+  }
+
+  // Combination of all shards
+  S load() const {
+    S result = identity();
+    S part;
+    for (std::size_t i = 0; i < count_; ++i) {
+      cells::load(shards_[i].values, part);
+      visit_struct::for_each(result, part, detail::combine_visitor{table::get(), 0});
+    }
+    return result;
+  }
+
+  // Reset every shard to the neutral element of its policies. Not atomic with respect to concurrent updates.
+  void reset() {
+    const S s = identity();
+    for (std::size_t i = 0; i < count_; ++i) { cells::store(shards_[i].values, s); }
+  }
+
+  std::size_t shard_count() const { return count_; }
+};
+
+} // end namespace visit_struct
+
+#define VISIT_STRUCT_COMBINE_POLICY(POLICY) , visit_struct::combine::POLICY
+
+// Register how each member of a visitable structure is combined by `sharded`, in registration order
+#define VISITABLE_COMBINE(STRUCT_NAME, ...)                                                        \
+namespace visit_struct {                                                                           \
+                                                                                                   \
+template <>                                                                                        \
+struct combine_policies<STRUCT_NAME>                                                               \
+  : detail::drop_first<combine::sum                                                                \
+                       VISIT_STRUCT_PP_MAP(VISIT_STRUCT_COMBINE_POLICY, __VA_ARGS__)>::type {};    \
+                                                                                                   \
+}                                                                                                  \
+static_assert(true, "")
+
+#endif // VISIT_STRUCT_SHARDED_HPP_INCLUDED
@@ -0,0 +1,285 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_SOA_HPP_INCLUDED
+#define VISIT_STRUCT_SOA_HPP_INCLUDED
+
+/***
+ * `visit_struct::soa_vector<S>` stores a sequence of visitable structures as
+ * a structure of arrays: one `std::vector<type_at<idx, S>>` per registered
+ * member.
+ *
+ * Sorting and partitioning by a member never moves whole records. A
+ * permutation is computed from the key column alone, and then applied to each
+ * column in turn. Integral keys are sorted with a parallel LSD radix sort on
+ * a `thread_pool`, other keys with `std::stable_sort`. All sorts are stable.
+ *
+ * Members are named by index, or by name through the constexpr
+ * `member_index`:
+ *
+ *   v.sort_by<visit_struct::member_index<trade>("price")>();
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_parallel.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace visit_struct {
+
+namespace detail {
+
+template <typename S, typename Seq = field_indices<S>>
+struct soa_columns;
+
+template <typename S, int... Is>
+struct soa_columns<S, integer_sequence<int, Is...>> {
+  typedef std::tuple<std::vector<type_at<Is, S>>...> type;
+
+  static void push_back(type & c, const S & s) {
+    (void) swallow{ 0, (std::get<Is>(c).push_back(visit_struct::get<Is>(s)), 0)... };
+  }
+
+  static void load(const type & c, std::size_t i, S & s) {
+    (void) swallow{ 0, (visit_struct::get<Is>(s) = std::get<Is>(c)[i], 0)... };
+  }
+
+  static void store(type & c, std::size_t i, const S & s) {
+    (void) swallow{ 0, (std::get<Is>(c)[i] = visit_struct::get<Is>(s), 0)... };
+  }
+
+  static void reserve(type & c, std::size_t n) {
+    (void) swallow{ 0, (std::get<Is>(c).reserve(n), 0)... };
+  }
+
+  static void resize(type & c, std::size_t n) {
+    (void) swallow{ 0, (std::get<Is>(c).resize(n), 0)... };
+  }
+
+  template <typename T>
+  static void gather(std::vector<T> & column, const std::vector<std::size_t> & perm) {
+    std::vector<T> result;
+    result.reserve(column.size());
+    for (std::size_t i : perm) { result.push_back(std::move(column[i])); }
+    column.swap(result);
+  }
+
+  static void apply(type & c, const std::vector<std::size_t> & perm) {
+    (void) swallow{ 0, (gather(std::get<Is>(c), perm), 0)... };
+  }
+};
+
+// Radix sort of (key, index) pairs, one byte per pass, passes where all keys
+// share the byte are skipped. Each pass counts digits per chunk in parallel,
+// then each chunk scatters to its own offsets, which keeps the sort stable.
+template <typename K>
+std::vector<std::size_t> radix_permutation(const K * keys, std::size_t n, thread_pool & pool) {
+  typedef typename std::make_unsigned<K>::type bits_type;
+  static VISIT_STRUCT_CONSTEXPR const bits_type flip =
+    std::is_signed<K>::value ? bits_type(bits_type(1) << (8 * sizeof(K) - 1)) : bits_type(0);
+
+  const std::size_t chunks = n < 65536 ? 1 : std::min<std::size_t>(pool.slots(), n / 16384);
+  std::vector<bits_type> bits(n), bits_out(n);
+  std::vector<std::size_t> perm(n), perm_out(n);
+  std::vector<std::array<std::size_t, 256>> counts(chunks);
+
+  for (std::size_t i = 0; i < n; ++i) {
+    bits[i] = static_cast<bits_type>(keys[i]) ^ flip;
+    perm[i] = i;
+  }
+
+  for (unsigned shift = 0; shift < 8 * sizeof(K); shift += 8) {
+    pool.run(chunks, [&](std::size_t c) {
+      std::array<std::size_t, 256> & count = counts[c];
+      count.fill(0);
+      for (std::size_t i = n * c / chunks, end = n * (c + 1) / chunks; i < end; ++i) {
+        ++count[(bits[i] >> shift) & 0xff];
+      }
+    });
+
+    // Offsets: by digit, then by chunk
+    std::size_t total = 0;
+    bool trivial = false;
+    for (unsigned d = 0; d < 256; ++d) {
+      std::size_t digit_total = 0;
+      for (std::size_t c = 0; c < chunks; ++c) {
+        const std::size_t k = counts[c][d];
+        counts[c][d] = total + digit_total;
+        digit_total += k;
+      }
+      trivial = trivial || digit_total == n;
+      total += digit_total;
+    }
+    if (trivial) { continue; }
+
+    pool.run(chunks, [&](std::size_t c) {
+      std::array<std::size_t, 256> & offset = counts[c];
+      for (std::size_t i = n * c / chunks, end = n * (c + 1) / chunks; i < end; ++i) {
+        const std::size_t pos = offset[(bits[i] >> shift) & 0xff]++;
+        bits_out[pos] = bits[i];
+        perm_out[pos] = perm[i];
+      }
+    });
+    bits.swap(bits_out);
+    perm.swap(perm_out);
+  }
+  return perm;
+}
+
+template <typename K>
+struct is_radix_key : std::integral_constant<bool, std::is_integral<K>::value && !std::is_same<K, bool>::value> {};
+
+// Whether two values of type K can be compared with <
+template <typename K, typename ENABLE = void>
+struct is_less_comparable : std::false_type {};
+
+template <typename K>
+struct is_less_comparable<K, typename std::enable_if<
+  std::is_convertible<decltype(std::declval<const K &>() < std::declval<const K &>()), bool>::value>::type>
+  : std::true_type {};
+
+} // end namespace detail
+
+template <typename S>
+class soa_vector {
+  static_assert(traits::is_visitable<S>::value, "soa_vector requires a visitable structure");
+  static_assert(visit_struct::field_count<S>() > 0, "soa_vector requires a structure with at least one member");
+
+  typedef detail::soa_columns<S> columns;
+  typename columns::type columns_;
+
+  template <int idx>
+  std::vector<std::size_t> sort_permutation(thread_pool & pool, std::true_type /* radix */) const {
+    return detail::radix_permutation(this->column<idx>().data(), this->size(), pool);
+  }
+
+  template <int idx>
+  std::vector<std::size_t> sort_permutation(thread_pool &, std::false_type) const {
+    return this->sort_permutation<idx>(std::less<type_at<idx, S>>{});
+  }
+
+  // Only members which can be compared are instantiated, the others are never sorted by name
+  template <int idx>
+  bool sort_by_name(thread_pool & pool, std::true_type /* comparable */) {
+    this->sort_by<idx>(pool);
+    return true;
+  }
+
+  template <int idx>
+  bool sort_by_name(thread_pool &, std::false_type) { return false; }
+
+  template <int... Is>
+  bool sort_by_name(const char * name, thread_pool & pool, detail::integer_sequence<int, Is...>) {
+    bool found = false;
+    (void) detail::swallow{ 0, ((!found && !std::strcmp(visit_struct::get_name<Is, S>(), name))
+                                ? (found = this->sort_by_name<Is>(pool, detail::is_less_comparable<type_at<Is, S>>{}), true)
+                                : false, 0)... };
+    return found;
+  }
+
+public:
+  template <int idx>
+  using column_type = std::vector<type_at<idx, S>>;
+
+  soa_vector() = default;
+
+  std::size_t size() const { return std::get<0>(columns_).size(); }
+  bool empty() const { return !this->size(); }
+
+  void reserve(std::size_t n) { columns::reserve(columns_, n); }
+  void resize(std::size_t n) { columns::resize(columns_, n); }
+  void clear() { columns::resize(columns_, 0); }
+
+  void push_back(const S & s) { columns::push_back(columns_, s); }
+
+  // Copy of the element at `i`
+  S get(std::size_t i) const {
+    S s;
+    columns::load(columns_, i, s);
+    return s;
+  }
+
+  S operator[](std::size_t i) const { return this->get(i); }
+
+  void set(std::size_t i, const S & s) { columns::store(columns_, i, s); }
+
+  template <int idx>
+  column_type<idx> & column() { return std::get<idx>(columns_); }
+
+  template <int idx>
+  const column_type<idx> & column() const { return std::get<idx>(columns_); }
+
+  // Move element perm[i] to position i, in every column
+  void apply_permutation(const std::vector<std::size_t> & perm) {
+    columns::apply(columns_, perm);
+  }
+
+  // Permutation which sorts member `idx`, stable
+  template <int idx>
+  std::vector<std::size_t> sort_permutation(thread_pool & pool = default_thread_pool()) const {
+    return this->sort_permutation<idx>(pool, detail::is_radix_key<type_at<idx, S>>{});
+  }
+
+  template <int idx, typename Compare>
+  std::vector<std::size_t> sort_permutation(Compare comp) const {
+    const column_type<idx> & key = this->column<idx>();
+    std::vector<std::size_t> perm(this->size());
+    std::iota(perm.begin(), perm.end(), std::size_t(0));
+    std::stable_sort(perm.begin(), perm.end(), [&](std::size_t a, std::size_t b) { return comp(key[a], key[b]); });
+    return perm;
+  }
+
+  // Stable sort of all elements by member `idx`
+  template <int idx>
+  void sort_by(thread_pool & pool = default_thread_pool()) {
+    this->apply_permutation(this->sort_permutation<idx>(pool));
+  }
+
+  template <int idx, typename Compare>
+  void sort_by(Compare comp) {
+    this->apply_permutation(this->sort_permutation<idx>(comp));
+  }
+
+  // Sort by the member called `name`. Returns false if there is none, or if
+  // its type has no operator<.
+  bool sort_by(const char * name, thread_pool & pool = default_thread_pool()) {
+    return this->sort_by_name(name, pool, detail::field_indices<S>{});
+  }
+
+  // Stable partition by a predicate on member `idx`. Returns the number of
+  // elements for which it holds, which come first.
+  template <int idx, typename Pred>
+  std::size_t partition_by(Pred pred) {
+    const column_type<idx> & key = this->column<idx>();
+    std::vector<char> mask(key.size());
+    std::size_t selected = 0;
+    for (std::size_t i = 0; i < key.size(); ++i) {
+      mask[i] = pred(key[i]) ? 1 : 0;
+      selected += mask[i];
+    }
+    std::vector<std::size_t> perm(key.size());
+    std::size_t yes = 0, no = selected;
+    for (std::size_t i = 0; i < key.size(); ++i) {
+      perm[mask[i] ? yes++ : no++] = i;
+    }
+    this->apply_permutation(perm);
+    return selected;
+  }
+};
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_SOA_HPP_INCLUDED
@@ -0,0 +1,248 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_SYMBOL_HPP_INCLUDED
+#define VISIT_STRUCT_SYMBOL_HPP_INCLUDED
+
+/***
+ * Interned strings for members with many repeated values, such as venue or
+ * instrument names.
+ *
+ * A `symbol_table` keeps one copy of each distinct string. A `symbol` is a
+ * pointer-sized handle to one of them, with a compact id (dense, in order of
+ * first appearance, 0 for the empty string). Symbols from the same table are
+ * equal exactly when their pointers are.
+ *
+ * Members declared as `visit_struct::symbol` are encoded like `std::string` by
+ * the binary, compact and big endian serializers, so a stream written from
+ * `std::string` members can be loaded into `symbol` members. Reading requires
+ * a symbol table on the `binary::source`, into which each value is interned
+ * straight from the input buffer:
+ *
+ *   struct trade {
+ *     std::uint64_t id;
+ *     visit_struct::symbol venue;
+ *     double price;
+ *   };
+ *
+ *   visit_struct::symbol_table symbols;
+ *   visit_struct::binary::source in{data, size, nullptr, &symbols};
+ *   visit_struct::binary::deserialize(in, t);
+ *
+ * Symbols are valid as long as their table. A table is not thread safe.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_arena.hpp>
+#include <visit_struct/visit_struct_big_endian.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+#include <visit_struct/visit_struct_compact.hpp>
+#include <visit_struct/visit_struct_flat_map.hpp>
+#include <visit_struct/visit_struct_schema.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace visit_struct {
+
+namespace detail {
+
+// Header of an interned string, followed by its characters and a null
+struct symbol_entry {
+  std::uint64_t hash;
+  std::size_t size;
+  std::uint32_t id;
+
+  const char * data() const { return reinterpret_cast<const char *>(this + 1); }
+};
+
+} // end namespace detail
+
+class symbol {
+  const detail::symbol_entry * entry_;
+
+  friend class symbol_table;
+  explicit symbol(const detail::symbol_entry * e) : entry_(e) {}
+
+public:
+  symbol() noexcept : entry_(nullptr) {}
+
+  // Null terminated
+  const char * data() const { return entry_ ? entry_->data() : ""; }
+  const char * c_str() const { return this->data(); }
+  std::size_t size() const { return entry_ ? entry_->size : 0; }
+  bool empty() const { return !entry_; }
+
+  std::uint32_t id() const { return entry_ ? entry_->id : 0; }
+  std::uint64_t hash() const { return entry_ ? entry_->hash : detail::fnv1a_bytes("", 0); }
+  std::string str() const { return std::string(this->data(), this->size()); }
+
+  // Pointer comparison, unless the symbols come from different tables
+  friend bool operator == (symbol a, symbol b) {
+    return a.entry_ == b.entry_ ||
+           (a.size() == b.size() && a.hash() == b.hash() && !std::memcmp(a.data(), b.data(), a.size()));
+  }
+
+  friend bool operator != (symbol a, symbol b) { return !(a == b); }
+};
+
+class symbol_table {
+  typedef detail::symbol_entry entry;
+
+  struct text {
+    const char * data;
+    std::size_t size;
+    std::uint64_t hash;
+  };
+
+  struct text_hash {
+    std::size_t operator()(const text & t) const { return static_cast<std::size_t>(t.hash); }
+  };
+
+  struct text_equal {
+    bool operator()(const text & a, const text & b) const {
+      return a.size == b.size && !std::memcmp(a.data, b.data, a.size);
+    }
+  };
+
+  arena strings_;
+  std::vector<const entry *> entries_;   // by id, the empty string first
+  flat_map<text, const entry *, text_hash, text_equal> index_;
+
+public:
+  symbol_table()
+    : strings_(64 * 1024)
+    , entries_(1, nullptr)
+  {}
+
+  symbol intern(const char * data, std::size_t size) {
+    if (!size) { return symbol(); }
+    const text key{data, size, detail::fnv1a_bytes(data, size)};
+    auto it = index_.find(key);
+    if (it != index_.end()) { return symbol(it->second); }
+
+    if (entries_.size() > std::numeric_limits<std::uint32_t>::max()) { throw std::length_error("symbol_table: too many symbols"); }
+    char * p = static_cast<char *>(strings_.allocate(sizeof(entry) + size + 1, alignof(entry)));
+    entry * e = new (p) entry{key.hash, size, static_cast<std::uint32_t>(entries_.size())};
+    std::memcpy(p + sizeof(entry), data, size);
+    p[sizeof(entry) + size] = '\0';
+
+    index_.try_emplace(text{e->data(), size, key.hash}, e);
+    entries_.push_back(e);
+    return symbol(e);
+  }
+
+  symbol intern(const std::string & s) { return this->intern(s.data(), s.size()); }
+
+  // The symbol of a string already interned, or an empty symbol
+  symbol find(const char * data, std::size_t size) const {
+    auto it = index_.find(text{data, size, detail::fnv1a_bytes(data, size)});
+    return it == index_.end() ? symbol() : symbol(it->second);
+  }
+
+  symbol find(const std::string & s) const { return this->find(s.data(), s.size()); }
+
+  // The symbol with a given id
+  symbol operator[](std::uint32_t id) const { return symbol(entries_[id]); }
+
+  // Number of ids in use, including 0 for the empty string
+  std::size_t size() const { return entries_.size(); }
+
+  // Bytes used to store the strings
+  std::size_t memory() const { return strings_.reserved(); }
+};
+
+namespace binary {
+
+namespace detail {
+
+inline bool read_symbol(source & in, symbol & s, std::size_t n) {
+  if (!in.symbols() || n > in.remaining()) { return false; }
+  s = in.symbols()->intern(in.position(), n);
+  return in.skip(n);
+}
+
+} // end namespace detail
+
+// Encoded as a string, interned when read
+template <>
+struct codec<symbol> {
+  template <typename Sink>
+  static void write(Sink & out, const symbol & s) {
+    detail::write_size(out, s.size());
+    if (!s.empty()) { out.put_range(s.data(), s.size()); }
+  }
+
+  static bool read(source & in, symbol & s) {
+    std::size_t n;
+    return detail::read_size(in, n) && detail::read_symbol(in, s, n);
+  }
+};
+
+namespace compact {
+
+template <>
+struct codec<symbol> {
+  template <typename Sink>
+  static void write(Sink & out, const symbol & s) {
+    detail::write_varint(out, s.size());
+    if (!s.empty()) { out.put_range(s.data(), s.size()); }
+  }
+
+  static bool read(source & in, symbol & s) {
+    std::size_t n;
+    return detail::read_size(in, n) && binary::detail::read_symbol(in, s, n);
+  }
+};
+
+} // end namespace compact
+
+namespace big_endian {
+
+template <>
+struct codec<symbol> {
+  template <typename Sink>
+  static void write(Sink & out, const symbol & s) {
+    detail::write_size(out, s.size());
+    if (!s.empty()) { out.put_range(s.data(), s.size()); }
+  }
+
+  static bool read(source & in, symbol & s) {
+    std::size_t n;
+    return detail::read_size(in, n) && binary::detail::read_symbol(in, s, n);
+  }
+};
+
+} // end namespace big_endian
+
+// Deserialize one object which must occupy the whole buffer, interning its
+// symbol members into `symbols`
+template <typename T>
+bool deserialize(const std::string & buffer, T & t, symbol_table & symbols) {
+  source in{buffer.data(), buffer.size(), nullptr, &symbols};
+  return binary::deserialize(in, t) && !in.remaining();
+}
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+namespace std {
+
+template <>
+struct hash<visit_struct::symbol> {
+  std::size_t operator()(visit_struct::symbol s) const { return static_cast<std::size_t>(s.hash()); }
+};
+
+} // end namespace std
+
+#endif // VISIT_STRUCT_SYMBOL_HPP_INCLUDED
@@ -0,0 +1,265 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_TABLE_HPP_INCLUDED
+#define VISIT_STRUCT_TABLE_HPP_INCLUDED
+
+/***
+ * `visit_struct::table<S, Indexes...>` is an in-memory table of visitable
+ * structures, stored in a `std::vector<S>`, with secondary hash indexes on
+ * registered members:
+ *
+ *   visit_struct::table<order,
+ *                       visit_struct::unique_index<0>,
+ *                       visit_struct::hash_index<visit_struct::member_index<order>("account")>> orders;
+ *
+ *   orders.insert(o);
+ *   const order * o = orders.find<0>(42);
+ *   std::vector<std::size_t> rows = orders.find_all<2>("ACME");
+ *
+ * Indexes map member values to row positions, and are kept up to date by
+ * `insert`, `update` and `erase`. Inserts and updates which would give a
+ * unique index a duplicate key are refused, without changing anything.
+ *
+ * `erase` moves the last row into the erased position, so row positions are
+ * stable only until the next erase. Members with an index need `std::hash`
+ * and `operator ==`.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace visit_struct {
+
+// Index on member `idx`, any number of rows per key
+template <int idx>
+struct hash_index {
+  static VISIT_STRUCT_CONSTEXPR const int member = idx;
+  static VISIT_STRUCT_CONSTEXPR const bool unique = false;
+};
+
+// Index on member `idx`, at most one row per key
+template <int idx>
+struct unique_index {
+  static VISIT_STRUCT_CONSTEXPR const int member = idx;
+  static VISIT_STRUCT_CONSTEXPR const bool unique = true;
+};
+
+namespace detail {
+
+template <typename S, typename Index>
+class table_index {
+  static VISIT_STRUCT_CONSTEXPR const int idx = Index::member;
+  typedef type_at<idx, S> key_type;
+  typedef std::unordered_multimap<key_type, std::size_t> map_type;
+
+  map_type map_;
+
+  typename map_type::iterator locate(const key_type & key, std::size_t row) {
+    auto range = map_.equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == row) { return it; }
+    }
+    return map_.end();
+  }
+
+public:
+  // Whether storing `s` at `row` would duplicate a key of a unique index
+  bool conflicts(const S & s, std::size_t row) const {
+    if (!Index::unique) { return false; }
+    auto it = map_.find(visit_struct::get<idx>(s));
+    return it != map_.end() && it->second != row;
+  }
+
+  void insert(const S & s, std::size_t row) {
+    map_.emplace(visit_struct::get<idx>(s), row);
+  }
+
+  void erase(const S & s, std::size_t row) {
+    auto it = this->locate(visit_struct::get<idx>(s), row);
+    if (it != map_.end()) { map_.erase(it); }
+  }
+
+  void move(const S & s, std::size_t from, std::size_t to) {
+    auto it = this->locate(visit_struct::get<idx>(s), from);
+    if (it != map_.end()) { it->second = to; }
+  }
+
+  void update(const S & before, const S & after, std::size_t row) {
+    if (!(visit_struct::get<idx>(before) == visit_struct::get<idx>(after))) {
+      this->erase(before, row);
+      this->insert(after, row);
+    }
+  }
+
+  void clear() { map_.clear(); }
+
+  std::pair<typename map_type::const_iterator, typename map_type::const_iterator> equal_range(const key_type & key) const {
+    return map_.equal_range(key);
+  }
+};
+
+// Position of the index on member `idx` in a list of indexes, or -1
+template <int idx, int pos, typename... Indexes>
+struct index_position;
+
+template <int idx, int pos>
+struct index_position<idx, pos> {
+  static VISIT_STRUCT_CONSTEXPR const int value = -1;
+};
+
+template <int idx, int pos, typename Index, typename... Indexes>
+struct index_position<idx, pos, Index, Indexes...> {
+  static VISIT_STRUCT_CONSTEXPR const int value = Index::member == idx ? pos : index_position<idx, pos + 1, Indexes...>::value;
+};
+
+} // end namespace detail
+
+template <typename S, typename... Indexes>
+class table {
+  static_assert(traits::is_visitable<S>::value, "table requires a visitable structure");
+
+  typedef std::tuple<detail::table_index<S, Indexes>...> indexes_type;
+  typedef detail::make_integer_sequence<int, sizeof...(Indexes)> index_sequence;
+
+  // Clamped, so that a missing index fails on the static_assert below
+  template <int idx>
+  using index_slot = std::integral_constant<std::size_t, (detail::index_position<idx, 0, Indexes...>::value < 0
+                                                            ? 0 : detail::index_position<idx, 0, Indexes...>::value)>;
+
+  template <int idx>
+  using index_for = typename std::tuple_element<index_slot<idx>::value, indexes_type>::type;
+
+  std::vector<S> rows_;
+  indexes_type indexes_;
+
+  template <int idx>
+  const index_for<idx> & index() const {
+    static_assert(detail::index_position<idx, 0, Indexes...>::value >= 0, "no index is declared on this member");
+    return std::get<index_slot<idx>::value>(indexes_);
+  }
+
+  template <int... Ks>
+  bool conflicts(const S & s, std::size_t row, detail::integer_sequence<int, Ks...>) const {
+    bool result = false;
+    (void) detail::swallow{ 0, (result = result || std::get<Ks>(indexes_).conflicts(s, row), 0)... };
+    return result;
+  }
+
+  template <int... Ks>
+  void index_insert(const S & s, std::size_t row, detail::integer_sequence<int, Ks...>) {
+    (void) detail::swallow{ 0, (std::get<Ks>(indexes_).insert(s, row), 0)... };
+  }
+
+  template <int... Ks>
+  void index_erase(const S & s, std::size_t row, detail::integer_sequence<int, Ks...>) {
+    (void) detail::swallow{ 0, (std::get<Ks>(indexes_).erase(s, row), 0)... };
+  }
+
+  template <int... Ks>
+  void index_move(const S & s, std::size_t from, std::size_t to, detail::integer_sequence<int, Ks...>) {
+    (void) detail::swallow{ 0, (std::get<Ks>(indexes_).move(s, from, to), 0)... };
+  }
+
+  template <int... Ks>
+  void index_update(const S & before, const S & after, std::size_t row, detail::integer_sequence<int, Ks...>) {
+    (void) detail::swallow{ 0, (std::get<Ks>(indexes_).update(before, after, row), 0)... };
+  }
+
+  template <int... Ks>
+  void index_clear(detail::integer_sequence<int, Ks...>) {
+    (void) detail::swallow{ 0, (std::get<Ks>(indexes_).clear(), 0)... };
+  }
+
+public:
+  static VISIT_STRUCT_CONSTEXPR const std::size_t npos = static_cast<std::size_t>(-1);
+
+  std::size_t size() const { return rows_.size(); }
+  bool empty() const { return rows_.empty(); }
+  void reserve(std::size_t n) { rows_.reserve(n); }
+
+  const S & operator[](std::size_t row) const { return rows_[row]; }
+  const std::vector<S> & rows() const { return rows_; }
+
+  typename std::vector<S>::const_iterator begin() const { return rows_.begin(); }
+  typename std::vector<S>::const_iterator end() const { return rows_.end(); }
+
+  // Append a row. Returns false if a unique index already has one of its keys.
+  bool insert(const S & s) {
+    if (this->conflicts(s, npos, index_sequence{})) { return false; }
+    rows_.push_back(s);
+    this->index_insert(rows_.back(), rows_.size() - 1, index_sequence{});
+    return true;
+  }
+
+  // Replace a row, reindexing the members which changed. Returns false if a
+  // unique index already has one of its keys in another row.
+  bool update(std::size_t row, const S & s) {
+    if (this->conflicts(s, row, index_sequence{})) { return false; }
+    this->index_update(rows_[row], s, row, index_sequence{});
+    rows_[row] = s;
+    return true;
+  }
+
+  // Remove a row. The last row takes its position.
+  void erase(std::size_t row) {
+    const std::size_t last = rows_.size() - 1;
+    this->index_erase(rows_[row], row, index_sequence{});
+    if (row != last) {
+      this->index_move(rows_[last], last, row, index_sequence{});
+      rows_[row] = std::move(rows_[last]);
+    }
+    rows_.pop_back();
+  }
+
+  void clear() {
+    rows_.clear();
+    this->index_clear(index_sequence{});
+  }
+
+  // Position of a row whose member `idx` equals `key`, or npos
+  template <int idx>
+  std::size_t find_row(const type_at<idx, S> & key) const {
+    auto range = this->index<idx>().equal_range(key);
+    return range.first == range.second ? npos : range.first->second;
+  }
+
+  // A row whose member `idx` equals `key`, or nullptr
+  template <int idx>
+  const S * find(const type_at<idx, S> & key) const {
+    const std::size_t row = this->find_row<idx>(key);
+    return row == npos ? nullptr : &rows_[row];
+  }
+
+  // Positions of all rows whose member `idx` equals `key`, in no particular order
+  template <int idx>
+  std::vector<std::size_t> find_all(const type_at<idx, S> & key) const {
+    std::vector<std::size_t> result;
+    auto range = this->index<idx>().equal_range(key);
+    for (auto it = range.first; it != range.second; ++it) { result.push_back(it->second); }
+    return result;
+  }
+
+  template <int idx>
+  std::size_t count(const type_at<idx, S> & key) const {
+    auto range = this->index<idx>().equal_range(key);
+    return static_cast<std::size_t>(std::distance(range.first, range.second));
+  }
+};
+
+template <typename S, typename... Indexes>
+VISIT_STRUCT_CONSTEXPR const std::size_t table<S, Indexes...>::npos;
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_TABLE_HPP_INCLUDED
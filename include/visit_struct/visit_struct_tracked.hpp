@@ -0,0 +1,300 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_TRACKED_HPP_INCLUDED
+#define VISIT_STRUCT_TRACKED_HPP_INCLUDED
+
+/***
+ * `visit_struct::tracked<S>` wraps a visitable structure and records which of
+ * its registered members have been modified since the last `clear()`.
+ *
+ * Reads go through `value()`. Writes go through `set<idx>`, the `field<idx>`
+ * proxy, `set(name, value)`, `modify<idx>()` or `update(s)`, each of which
+ * marks the affected members dirty. The dirty set is a `std::bitset` with one
+ * bit per registered member.
+ *
+ * `binary::serialize_changes` and `binary::deserialize_changes` write and
+ * apply only the modified members, prefixed by the dirty mask.
+ */
+
+#include <visit_struct/visit_struct.hpp>
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <bitset>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace visit_struct {
+
+template <typename S>
+class tracked;
+
+namespace detail {
+
+// Assign `value` to the member called `name`, if it is assignable from it
+template <typename S, typename U>
+struct assign_by_name_visitor {
+  S & instance;
+  const char * name;
+  U && value;
+  std::size_t index;
+  std::size_t found;
+
+  template <typename A>
+  void operator()(const char * member_name, A a) {
+    if (found == std::size_t(-1) && !std::strcmp(name, member_name)) {
+      if (assign(a(instance), std::is_assignable<decltype(a(instance)), U>{})) { found = index; }
+    }
+    ++index;
+  }
+
+  template <typename T>
+  bool assign(T && member, std::true_type) {
+    std::forward<T>(member) = std::forward<U>(value);
+    return true;
+  }
+
+  template <typename T>
+  bool assign(T &&, std::false_type) {
+    return false;
+  }
+};
+
+// Call v(name, member) for the members whose bit is set
+template <typename Bits, typename V>
+struct masked_visitor {
+  const Bits & bits;
+  V & visitor;
+  std::size_t index;
+
+  template <typename T>
+  void operator()(const char * name, T && t) {
+    if (bits.test(index++)) { visitor(name, std::forward<T>(t)); }
+  }
+};
+
+// Member comparison and copy, element by element for C arrays
+template <typename T>
+bool member_equal(const T & a, const T & b) {
+  return a == b;
+}
+
+template <typename T, std::size_t N>
+bool member_equal(const T (&a)[N], const T (&b)[N]) {
+  for (std::size_t i = 0; i < N; ++i) {
+    if (!detail::member_equal(a[i], b[i])) { return false; }
+  }
+  return true;
+}
+
+template <typename T>
+void member_assign(T & dest, const T & src) {
+  dest = src;
+}
+
+template <typename T, std::size_t N>
+void member_assign(T (&dest)[N], const T (&src)[N]) {
+  for (std::size_t i = 0; i < N; ++i) { detail::member_assign(dest[i], src[i]); }
+}
+
+// Copy members which differ, marking them
+template <typename Bits>
+struct update_visitor {
+  Bits & bits;
+  std::size_t index;
+
+  template <typename T>
+  void operator()(const char *, T & dest, const T & src) {
+    if (!detail::member_equal(dest, src)) {
+      detail::member_assign(dest, src);
+      bits.set(index);
+    }
+    ++index;
+  }
+};
+
+} // end namespace detail
+
+template <typename S>
+class tracked {
+public:
+  static VISIT_STRUCT_CONSTEXPR const std::size_t size = visit_struct::field_count<S>();
+  typedef std::bitset<size> mask_type;
+
+  // Assignable reference to one member, which marks it dirty on write
+  template <int idx>
+  class field_ref {
+    tracked & owner_;
+
+    type_at<idx, S> & mark() {
+      owner_.dirty_.set(idx);
+      return visit_struct::get<idx>(owner_.value_);
+    }
+
+  public:
+    explicit field_ref(tracked & owner) : owner_(owner) {}
+
+    const type_at<idx, S> & get() const { return visit_struct::get<idx>(owner_.value_); }
+    operator const type_at<idx, S> & () const { return this->get(); }
+
+    template <typename U>
+    field_ref & operator = (U && u) { this->mark() = std::forward<U>(u); return *this; }
+    template <typename U>
+    field_ref & operator += (U && u) { this->mark() += std::forward<U>(u); return *this; }
+    template <typename U>
+    field_ref & operator -= (U && u) { this->mark() -= std::forward<U>(u); return *this; }
+    template <typename U>
+    field_ref & operator |= (U && u) { this->mark() |= std::forward<U>(u); return *this; }
+    template <typename U>
+    field_ref & operator &= (U && u) { this->mark() &= std::forward<U>(u); return *this; }
+    field_ref & operator ++ () { ++this->mark(); return *this; }
+    field_ref & operator -- () { --this->mark(); return *this; }
+  };
+
+  tracked() = default;
+  explicit tracked(const S & s) : value_(s) {}
+  explicit tracked(S && s) : value_(std::move(s)) {}
+
+  // Read access
+  const S & value() const { return value_; }
+
+  template <int idx>
+  const type_at<idx, S> & get() const { return visit_struct::get<idx>(value_); }
+
+  // Write access, by index
+  template <int idx, typename U>
+  void set(U && u) {
+    visit_struct::get<idx>(value_) = std::forward<U>(u);
+    dirty_.set(idx);
+  }
+
+  template <int idx>
+  field_ref<idx> field() { return field_ref<idx>{*this}; }
+
+  // Mutable reference to a member, which is marked dirty up front
+  template <int idx>
+  type_at<idx, S> & modify() {
+    dirty_.set(idx);
+    return visit_struct::get<idx>(value_);
+  }
+
+  // Write access, by name. Returns false if there is no such member, or
+  // if it cannot be assigned from `u`.
+  template <typename U>
+  bool set(const char * name, U && u) {
+    detail::assign_by_name_visitor<S, U> vis{value_, name, std::forward<U>(u), 0, std::size_t(-1)};
+    visit_struct::visit_accessors<S>(vis);
+    if (vis.found == std::size_t(-1)) { return false; }
+    dirty_.set(vis.found);
+    return true;
+  }
+
+  // Replace the whole value, only members which compare unequal become dirty
+  void update(const S & s) {
+    detail::update_visitor<mask_type> vis{dirty_, 0};
+    visit_struct::for_each(value_, s, vis);
+  }
+
+  // Dirty set
+  const mask_type & dirty() const { return dirty_; }
+  bool is_dirty(std::size_t idx) const { return dirty_.test(idx); }
+  bool any_dirty() const { return dirty_.any(); }
+  void mark_all() { dirty_.set(); }
+  void clear() { dirty_.reset(); }
+
+  // Call v(name, member) for each dirty member, in registration order
+  template <typename V>
+  void for_each_dirty(V && v) const {
+    detail::masked_visitor<mask_type, V> vis{dirty_, v, 0};
+    visit_struct::for_each(value_, vis);
+  }
+
+private:
+  S value_;
+  mask_type dirty_;
+};
+
+namespace binary {
+
+namespace detail {
+
+template <typename Sink, std::size_t N>
+void write_mask(Sink & out, const std::bitset<N> & mask) {
+  for (std::size_t byte = 0; byte < (N + 7) / 8; ++byte) {
+    unsigned char c = 0;
+    for (std::size_t bit = 0; bit < 8 && byte * 8 + bit < N; ++bit) {
+      if (mask.test(byte * 8 + bit)) { c |= static_cast<unsigned char>(1u << bit); }
+    }
+    out.put(&c, 1);
+  }
+}
+
+template <std::size_t N>
+bool read_mask(source & in, std::bitset<N> & mask) {
+  mask.reset();
+  for (std::size_t byte = 0; byte < (N + 7) / 8; ++byte) {
+    unsigned char c;
+    if (!in.get(&c, 1)) { return false; }
+    for (std::size_t bit = 0; bit < 8; ++bit) {
+      if (!(c & (1u << bit))) { continue; }
+      // Bits beyond the member count indicate a mismatched schema
+      if (byte * 8 + bit >= N) { return false; }
+      mask.set(byte * 8 + bit);
+    }
+  }
+  return true;
+}
+
+template <typename Bits>
+struct masked_read_visitor {
+  const Bits & bits;
+  source & in;
+  std::size_t index;
+  bool ok;
+
+  template <typename T>
+  void operator()(const char *, T & t) {
+    if (ok && bits.test(index)) { ok = binary::deserialize(in, t); }
+    ++index;
+  }
+};
+
+} // end namespace detail
+
+// Write the dirty mask, followed by the encoding of each dirty member.
+// This does not clear the dirty set.
+template <typename S, typename Sink>
+void serialize_changes(const tracked<S> & t, Sink & out) {
+  detail::write_mask(out, t.dirty());
+  t.for_each_dirty(detail::write_visitor<Sink>{out});
+}
+
+// Same, appending to a string
+template <typename S>
+void serialize_changes(const tracked<S> & t, std::string & out) {
+  string_sink sink{out};
+  binary::serialize_changes(t, sink);
+}
+
+// Apply a change set written by `serialize_changes` to `s`.
+// If `changed` is given, it receives the mask of members which were present.
+template <typename S>
+bool deserialize_changes(source & in, S & s, typename tracked<S>::mask_type * changed = nullptr) {
+  typename tracked<S>::mask_type mask;
+  if (!detail::read_mask(in, mask)) { return false; }
+  detail::masked_read_visitor<decltype(mask)> vis{mask, in, 0, true};
+  visit_struct::for_each(s, vis);
+  if (changed) { *changed = mask; }
+  return vis.ok;
+}
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_TRACKED_HPP_INCLUDED
@@ -0,0 +1,109 @@
+//  (C) Copyright 2015 - 2018 Christopher Beck
+
+//  Distributed under the Boost Software License, Version 1.0. (See accompanying
+//  file LICENSE or copy at http://www.boost.org/LICENSE_1_0.txt)
+
+#ifndef VISIT_STRUCT_WRITEV_HPP_INCLUDED
+#define VISIT_STRUCT_WRITEV_HPP_INCLUDED
+
+/***
+ * Flush a `visit_struct::binary::gather_list` to a file descriptor with
+ * `writev`, so that large members of the serialized records are written
+ * straight from the records themselves, without a staging copy.
+ *
+ * This header is POSIX only.
+ */
+
+#include <visit_struct/visit_struct_binary.hpp>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <vector>
+
+#include <sys/types.h>
+#include <sys/uio.h>
+
+namespace visit_struct {
+
+namespace binary {
+
+namespace detail {
+
+#ifdef IOV_MAX
+static VISIT_STRUCT_CONSTEXPR const std::size_t iov_max = IOV_MAX;
+#else
+static VISIT_STRUCT_CONSTEXPR const std::size_t iov_max = 1024;
+#endif
+
+} // end namespace detail
+
+// Write out all the segments of the list, in order.
+// Handles partial writes, EINTR and lists longer than IOV_MAX.
+// Returns false on error, in which case errno is set by `writev`, or is EIO
+// if `writev` wrote nothing although bytes remained. The bytes which were
+// written are then removed from the list, so that calling again (after EAGAIN
+// on a non-blocking descriptor, say) resumes where the write stopped.
+// The list is cleared on success.
+inline bool write_gathered(int fd, gather_list & list) {
+  const std::vector<segment> & segs = list.segments();
+
+  std::vector<iovec> iov;
+  iov.reserve(segs.size());
+  for (const segment & s : segs) {
+    iov.push_back(iovec{const_cast<void *>(s.data), s.size});
+  }
+
+  std::size_t idx = 0;
+  std::size_t done = 0;
+  while (idx < iov.size()) {
+    std::size_t count = iov.size() - idx;
+    if (count > detail::iov_max) { count = detail::iov_max; }
+
+    ssize_t written = ::writev(fd, &iov[idx], static_cast<int>(count));
+    if (written < 0) {
+      if (errno == EINTR) { continue; }
+      const int error = errno;
+      list.consume(done);
+      errno = error;
+      return false;
+    }
+
+    // Advance past what was written, which may end inside a segment
+    std::size_t n = static_cast<std::size_t>(written);
+    done += n;
+    while (idx < iov.size() && n >= iov[idx].iov_len) {
+      n -= iov[idx].iov_len;
+      ++idx;
+    }
+    if (n) {
+      iov[idx].iov_base = static_cast<char *>(iov[idx].iov_base) + n;
+      iov[idx].iov_len -= n;
+    }
+
+    // No progress with bytes left (only empty segments were skipped)
+    if (!written && idx < iov.size()) {
+      list.consume(done);
+      errno = EIO;
+      return false;
+    }
+  }
+
+  list.clear();
+  return true;
+}
+
+// Serialize one object and write it with a single gathered write.
+// `scratch` is cleared first, pass the same list every time to reuse its storage.
+template <typename T>
+bool write_gathered(int fd, const T & t, gather_list & scratch) {
+  scratch.clear();
+  binary::gather(t, scratch);
+  return binary::write_gathered(fd, scratch);
+}
+
+} // end namespace binary
+
+} // end namespace visit_struct
+
+#endif // VISIT_STRUCT_WRITEV_HPP_INCLUDED
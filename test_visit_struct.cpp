@@ -199,6 +199,46 @@ static_assert(std::is_same<visit_struct::type_at<0, test_struct_one>, int>::valu
 static_assert(std::is_same<visit_struct::type_at<1, test_struct_one>, float>::value, "");
 static_assert(std::is_same<visit_struct::type_at<2, test_struct_one>, std::string>::value, "");
 
+// Compile-time folds
+
+struct size_sum {
+  template <typename T>
+  constexpr std::size_t operator()(std::size_t acc, const char *, visit_struct::type_c<T>) const {
+    return acc + sizeof(T);
+  }
+};
+
+struct name_length_sum {
+  static constexpr std::size_t length(const char * s) { return *s ? 1 + length(s + 1) : 0; }
+
+  template <typename T>
+  constexpr std::size_t operator()(std::size_t acc, const char * name, const T &) const {
+    return acc + length(name);
+  }
+};
+
+struct int_sum {
+  constexpr int operator()(int acc, const char *, int x) const { return acc + x; }
+};
+
+struct fold_point {
+  int x;
+  int y;
+  int z;
+};
+
+VISITABLE_STRUCT(fold_point, x, y, z);
+
+static_assert(visit_struct::fold_types<fold_point>(size_sum{}, std::size_t(0)) == 3 * sizeof(int), "");
+static_assert(visit_struct::fold_types<test_struct_one>(size_sum{}, std::size_t(1)) == 1 + sizeof(int) + sizeof(float) + sizeof(std::string), "");
+static_assert(visit_struct::fold_pointers<test_struct_one>(name_length_sum{}, std::size_t(0)) == 3, "");
+static_assert(visit_struct::fold(fold_point{1, 2, 3}, int_sum{}, 10) == 16, "");
+
+static_assert(visit_struct::member_index<test_struct_one>("a") == 0, "");
+static_assert(visit_struct::member_index<test_struct_one>("c") == 2, "");
+static_assert(visit_struct::member_index<test_struct_one>("d") == -1, "");
+static_assert(visit_struct::member_index<test_struct_one>("") == -1, "");
+
 int main() {
   // Test version string
   std::cout << VISIT_STRUCT_VERSION_STRING << std::endl;
@@ -0,0 +1,290 @@
+#include <visit_struct/visit_struct_arena.hpp>
+#include <visit_struct/visit_struct_big_endian.hpp>
+#include <visit_struct/visit_struct_compact.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+/***
+ * Count calls to the global operator new
+ */
+
+static std::size_t new_calls = 0;
+
+void * operator new(std::size_t size) {
+  ++new_calls;
+  if (void * p = std::malloc(size ? size : 1)) { return p; }
+  throw std::bad_alloc();
+}
+
+void operator delete(void * p) noexcept { std::free(p); }
+void operator delete(void * p, std::size_t) noexcept { std::free(p); }
+
+/***
+ * Test structures
+ */
+
+struct leg {
+  visit_struct::arena_string venue;
+  std::int32_t quantity;
+};
+
+VISITABLE_STRUCT(leg, venue, quantity);
+
+struct message {
+  std::uint64_t id;
+  visit_struct::arena_string symbol;
+  visit_struct::arena_vector<double> prices;
+  visit_struct::arena_vector<visit_struct::arena_string> tags;
+  visit_struct::arena_vector<leg> legs;
+  leg primary;
+};
+
+VISITABLE_STRUCT(message, id, symbol, prices, tags, legs, primary);
+
+struct plain {
+  std::uint64_t id;
+  std::string symbol;
+};
+
+VISITABLE_STRUCT(plain, id, symbol);
+
+struct mixed {
+  std::string name;
+  std::vector<leg> legs;
+};
+
+VISITABLE_STRUCT(mixed, name, legs);
+
+static_assert(visit_struct::binary::uses_arena<message>(), "");
+static_assert(visit_struct::binary::uses_arena<leg>(), "");
+static_assert(visit_struct::binary::uses_arena<mixed>(), "");
+static_assert(!visit_struct::binary::uses_arena<plain>(), "");
+static_assert(visit_struct::binary::uses_arena<visit_struct::arena_vector<int>>(), "");
+static_assert(!visit_struct::binary::uses_arena<std::vector<std::string>>(), "");
+
+message make_message(std::uint64_t id) {
+  message m;
+  m.id = id;
+  m.symbol = ("a fairly long instrument symbol " + std::to_string(id)).c_str();
+  for (int i = 0; i < 10; ++i) { m.prices.push_back(id + i * 0.25); }
+  for (int i = 0; i < 5; ++i) { m.tags.push_back(visit_struct::arena_string("tag number ") + std::to_string(i).c_str()); }
+  for (int i = 0; i < 3; ++i) { m.legs.push_back(leg{("venue with a long name " + std::to_string(i)).c_str(), i}); }
+  m.primary = leg{"primary venue with a long name", 7};
+  return m;
+}
+
+bool same(const message & a, const message & b) {
+  if (a.id != b.id || a.symbol != b.symbol || a.prices != b.prices || a.tags != b.tags || a.legs.size() != b.legs.size()) { return false; }
+  for (std::size_t i = 0; i < a.legs.size(); ++i) {
+    if (a.legs[i].venue != b.legs[i].venue || a.legs[i].quantity != b.legs[i].quantity) { return false; }
+  }
+  return a.primary.venue == b.primary.venue && a.primary.quantity == b.primary.quantity;
+}
+
+// Every arena allocated member of `m` uses `a`
+bool allocated_from(const message & m, visit_struct::arena * a) {
+  bool result = m.symbol.get_allocator().resource() == a && m.prices.get_allocator().resource() == a &&
+                m.tags.get_allocator().resource() == a && m.legs.get_allocator().resource() == a &&
+                m.primary.venue.get_allocator().resource() == a;
+  for (const auto & t : m.tags) { result = result && t.get_allocator().resource() == a; }
+  for (const auto & l : m.legs) { result = result && l.venue.get_allocator().resource() == a; }
+  return result;
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  bool ok = true;
+  (void) ok;
+
+  // Arena basics
+  {
+    visit_struct::arena a(64);
+    assert(a.used() == 0 && a.reserved() == 0);
+    void * p = a.allocate(10, 1);
+    void * q = a.allocate(8, 8);
+    assert(p && q && reinterpret_cast<std::uintptr_t>(q) % 8 == 0);
+    assert(static_cast<char *>(q) >= static_cast<char *>(p) + 10);
+    void * big = a.allocate(1000, 16);
+    assert(reinterpret_cast<std::uintptr_t>(big) % 16 == 0);
+    assert(a.used() == 1018 && a.reserved() >= 1064);
+    (void) p;
+    (void) q;
+    (void) big;
+
+    a.release();
+    assert(a.used() == 0 && a.reserved() >= 1000);
+    const std::size_t calls = new_calls;
+    a.allocate(500, 8);
+    assert(new_calls == calls);
+    (void) calls;
+  }
+
+  // Without an arena, the allocator uses operator new
+  {
+    visit_struct::arena_string s("a string long enough to need the heap");
+    assert(s.get_allocator().resource() == nullptr);
+    visit_struct::arena_string t = s;
+    assert(t == s);
+  }
+
+  std::vector<std::string> buffers;
+  for (std::uint64_t i = 0; i < 100; ++i) {
+    buffers.emplace_back();
+    visit_struct::binary::serialize(make_message(i), buffers.back());
+  }
+
+  // Decoding without an arena works as before
+  {
+    message m;
+    ok = visit_struct::binary::deserialize(buffers[3], m);
+    assert(ok);
+    assert(same(m, make_message(3)));
+    assert(allocated_from(m, nullptr));
+  }
+
+  // Decoding with an arena: after the first round, no calls to operator new
+  {
+    visit_struct::arena memory;
+    message m;
+    for (int round = 0; round < 3; ++round) {
+      for (std::uint64_t i = 0; i < buffers.size(); ++i) {
+        const std::size_t calls = new_calls;
+        ok = visit_struct::binary::deserialize(buffers[i], m, memory);
+        assert(ok);
+        assert(!round || new_calls == calls);
+        (void) calls;
+        assert(allocated_from(m, &memory));
+        assert(same(m, make_message(i)));
+      }
+      assert(memory.used() > 0);
+      memory.release();
+    }
+  }
+
+  // An object read again after a release is rebuilt in fresh memory
+  {
+    visit_struct::arena memory;
+    message m;
+    ok = visit_struct::binary::deserialize(buffers[1], m, memory);
+    assert(ok);
+    const visit_struct::arena_allocator<char> before(&memory);
+    assert(m.symbol.get_allocator() == before);
+
+    memory.release();
+    assert(memory.generation() == 1);
+    assert(m.symbol.get_allocator().released() && m.symbol.get_allocator() != visit_struct::arena_allocator<char>(&memory));
+
+    // Overwrite the released memory
+    std::memset(memory.allocate(memory.reserved() / 2, 1), 0xab, memory.reserved() / 2);
+    const std::size_t calls = new_calls;
+    ok = visit_struct::binary::deserialize(buffers[2], m, memory);
+    assert(ok);
+    assert(new_calls == calls);
+    (void) calls;
+    assert(same(m, make_message(2)));
+    assert(allocated_from(m, &memory) && !m.tags.get_allocator().released());
+
+    // Shorter contents too
+    memory.release();
+    std::memset(memory.allocate(memory.reserved(), 1), 0xcd, memory.reserved());
+    message shorter;
+    shorter.id = 9;
+    shorter.primary.venue = "v";
+    std::string buffer;
+    visit_struct::binary::serialize(shorter, buffer);
+    ok = visit_struct::binary::deserialize(buffer, m, memory);
+    assert(ok);
+    assert(same(m, shorter));
+  }
+
+  // Records read from one stream share the arena
+  {
+    std::string stream;
+    for (std::uint64_t i = 0; i < 10; ++i) { visit_struct::binary::serialize(make_message(i), stream); }
+
+    visit_struct::arena memory;
+    visit_struct::binary::source in{stream.data(), stream.size(), &memory};
+    std::vector<message> out(10);
+    for (message & m : out) {
+      ok = visit_struct::binary::deserialize(in, m);
+      assert(ok);
+    }
+    assert(!in.remaining());
+    for (std::uint64_t i = 0; i < 10; ++i) {
+      assert(same(out[i], make_message(i)));
+      assert(allocated_from(out[i], &memory));
+    }
+    out.clear();
+  }
+
+  // Members which don't use arena allocators are untouched
+  {
+    mixed x{"a name too long for the small string buffer", {leg{"first", 1}, leg{"second", 2}}};
+    std::string buffer;
+    visit_struct::binary::serialize(x, buffer);
+
+    visit_struct::arena memory;
+    mixed y;
+    ok = visit_struct::binary::deserialize(buffer, y, memory);
+    assert(ok);
+    assert(y.name == x.name && y.legs.size() == 2 && y.legs[1].venue == "second");
+    assert(y.legs[0].venue.get_allocator().resource() == &memory);
+    y.legs.clear();
+  }
+
+  // Truncated input fails cleanly
+  {
+    visit_struct::arena memory;
+    message m;
+    ok = visit_struct::binary::deserialize(buffers[5].substr(0, buffers[5].size() / 2), m, memory);
+    assert(!ok);
+  }
+
+  // The compact and big endian encodings bind to the arena too
+  {
+    visit_struct::arena memory;
+    const message original = make_message(42);
+
+    std::string buffer;
+    visit_struct::binary::compact::serialize(original, buffer);
+    message m;
+    visit_struct::binary::source in{buffer.data(), buffer.size(), &memory};
+    ok = visit_struct::binary::compact::deserialize(in, m);
+    assert(ok && !in.remaining());
+    assert(same(m, original) && allocated_from(m, &memory));
+
+    buffer.clear();
+    visit_struct::binary::big_endian::serialize(original, buffer);
+    message n;
+    visit_struct::binary::source in2{buffer.data(), buffer.size(), &memory};
+    ok = visit_struct::binary::big_endian::deserialize(in2, n);
+    assert(ok && !in2.remaining());
+    assert(same(n, original) && allocated_from(n, &memory));
+  }
+
+#ifdef VISIT_STRUCT_HAS_PMR
+  // std::pmr containers
+  {
+    visit_struct::arena memory;
+    std::pmr::string name("a pmr string which does not fit inline");
+    std::string buffer;
+    visit_struct::binary::serialize(name, buffer);
+    std::pmr::string out;
+    ok = visit_struct::binary::deserialize(buffer, out, memory);
+    assert(ok);
+    assert(out == name && out.get_allocator().resource() == &memory);
+  }
+#endif
+}
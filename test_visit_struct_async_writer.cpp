@@ -0,0 +1,123 @@
+#include <visit_struct/visit_struct_async_writer.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+/***
+ * Test structures
+ */
+
+struct capture {
+  std::uint64_t timestamp;
+  std::int32_t channel;
+  std::string data;
+};
+
+VISITABLE_STRUCT(capture, timestamp, channel, data);
+
+capture make_capture(std::uint64_t i, std::size_t data_size) {
+  return capture{i, static_cast<std::int32_t>(i % 7), std::string(data_size, static_cast<char>('a' + i % 26))};
+}
+
+std::string read_file(int fd) {
+  std::string result;
+  char buf[4096];
+  ssize_t n;
+  off_t pos = 0;
+  while ((n = ::pread(fd, buf, sizeof(buf), pos)) > 0) {
+    result.append(buf, static_cast<std::size_t>(n));
+    pos += n;
+  }
+  return result;
+}
+
+void test_writer(bool use_io_uring, bool datasync) {
+  namespace binary = visit_struct::binary;
+
+  char path[] = "/tmp/visit_struct_async_writer_XXXXXX";
+  int fd = ::mkstemp(path);
+  assert(fd >= 0);
+  ::unlink(path);
+
+  binary::async_writer_options options;
+  options.buffer_size = 1024;
+  options.queue_depth = 4;
+  options.datasync = datasync;
+  options.use_io_uring = use_io_uring;
+
+  const std::uint64_t count = 500;
+  std::vector<int> results(count, 1);
+
+  {
+    binary::async_writer writer{fd, 0, options};
+    assert(writer.uses_io_uring() == (use_io_uring && binary::io_uring_available()));
+
+    for (std::uint64_t i = 0; i < count; ++i) {
+      // Every 100th record is larger than a buffer
+      const std::size_t size = (i % 100 == 50) ? 5000 : (i % 40);
+      writer.write(make_capture(i, size), [&results, i](int res) { results[i] = res; });
+      if (i % 64 == 0) { writer.poll(); }
+    }
+
+    writer.drain();
+    for (int r : results) {
+      assert(r == 0);
+      (void) r;
+    }
+
+    // Writing continues after a drain
+    writer.write(make_capture(count, 3));
+    writer.flush();
+  }
+
+  const std::string contents = read_file(fd);
+  ::close(fd);
+
+  binary::source in{contents.data(), contents.size()};
+  for (std::uint64_t i = 0; i <= count; ++i) {
+    capture c;
+    const bool ok = binary::deserialize(in, c);
+    assert(ok);
+    (void) ok;
+    const std::size_t size = (i == count) ? 3 : (i % 100 == 50) ? 5000 : (i % 40);
+    const capture expected = make_capture(i, size);
+    assert(c.timestamp == expected.timestamp);
+    assert(c.channel == expected.channel);
+    assert(c.data == expected.data);
+  }
+  assert(!in.remaining());
+}
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  test_writer(true, false);
+  test_writer(true, true);
+  test_writer(false, false);
+  test_writer(false, true);
+
+  // A queue depth of zero is rejected
+  {
+    int fd = ::open("/dev/null", O_WRONLY);
+    assert(fd >= 0);
+    visit_struct::binary::async_writer_options options;
+    options.queue_depth = 0;
+    bool rejected = false;
+    try {
+      visit_struct::binary::async_writer writer{fd, 0, options};
+    } catch (const std::invalid_argument &) {
+      rejected = true;
+    }
+    assert(rejected);
+    (void) rejected;
+    ::close(fd);
+  }
+}
@@ -0,0 +1,120 @@
+#include <visit_struct/visit_struct_atomic_mirror.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+enum class health : std::uint8_t { ok, degraded, down };
+
+struct server_stats {
+  std::uint64_t requests;
+  std::int64_t in_flight;
+  double latency_sum;
+  std::uint32_t errors;
+  health status;
+};
+
+VISITABLE_STRUCT(server_stats, requests, in_flight, latency_sum, errors, status);
+
+struct counters {
+  std::uint64_t hits;
+  std::uint64_t misses;
+};
+
+VISITABLE_STRUCT(counters, hits, misses);
+
+struct latency {
+  std::uint64_t count;
+  double sum;
+};
+
+VISITABLE_STRUCT(latency, count, sum);
+
+struct name_printer {
+  std::vector<const char *> names;
+
+  template <typename T>
+  void operator()(const char * name, std::atomic<T> &) {
+    names.push_back(name);
+  }
+};
+
+/***
+ * tests
+ */
+
+static_assert(sizeof(visit_struct::atomic_mirror<counters, true>) >= 2 * VISIT_STRUCT_CACHE_LINE_SIZE, "");
+static_assert(sizeof(visit_struct::atomic_mirror<counters>) == 2 * sizeof(std::atomic<std::uint64_t>), "");
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  // Single thread
+  {
+    visit_struct::atomic_mirror<server_stats> m{server_stats{1, 2, 3.5, 4, health::ok}};
+    server_stats s = m.load_snapshot();
+    assert(s.requests == 1 && s.in_flight == 2 && s.latency_sum == 3.5 && s.errors == 4 && s.status == health::ok);
+
+    m.get<3>().fetch_add(10);
+    m.get<4>().store(health::down);
+    m.store_from(server_stats{7, -1, 0.25, 0, health::degraded});
+    m.get<0>()++;
+    m.load_snapshot(s);
+    assert(s.requests == 8 && s.in_flight == -1 && s.latency_sum == 0.25 && s.errors == 0 && s.status == health::degraded);
+
+    name_printer p;
+    m.visit(p);
+    assert(p.names.size() == 5);
+    assert(!std::strcmp(p.names[2], "latency_sum"));
+  }
+
+  // Concurrent updates
+  for (int padded = 0; padded < 2; ++padded) {
+    visit_struct::atomic_mirror<counters, false> packed_mirror;
+    visit_struct::atomic_mirror<counters, true> padded_mirror;
+
+    const int threads = 8, iterations = 20000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+      workers.emplace_back([&, t] {
+        for (int i = 0; i < iterations; ++i) {
+          const counters delta{1, static_cast<std::uint64_t>(t)};
+          if (padded) {
+            padded_mirror.add(delta);
+          } else {
+            packed_mirror.add(delta);
+          }
+        }
+      });
+    }
+    for (std::thread & w : workers) { w.join(); }
+
+    const counters c = padded ? padded_mirror.load_snapshot() : packed_mirror.load_snapshot();
+    assert(c.hits == static_cast<std::uint64_t>(threads) * iterations);
+    assert(c.misses == static_cast<std::uint64_t>(iterations) * (threads * (threads - 1) / 2));
+    (void) c;
+  }
+
+  // Floating point accumulation
+  {
+    visit_struct::atomic_mirror<latency> m;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+      workers.emplace_back([&m] {
+        for (int i = 0; i < 1000; ++i) { m.add(latency{1, 0.5}); }
+      });
+    }
+    for (std::thread & w : workers) { w.join(); }
+    const latency l = m.load_snapshot();
+    assert(l.count == 4000 && l.sum == 2000.0);
+    (void) l;
+  }
+}
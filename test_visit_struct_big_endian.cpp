@@ -0,0 +1,149 @@
+#include <visit_struct/visit_struct_big_endian.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+enum class opcode : std::uint16_t { nop = 0x0102, halt = 0xfffe };
+
+// Fixed size, staged through one buffer
+struct header {
+  std::uint32_t magic;
+  opcode op;
+  std::int16_t deltas[2];
+  double scale;
+  std::array<std::uint8_t, 3> tag;
+};
+
+VISITABLE_STRUCT(header, magic, op, deltas, scale, tag);
+
+// Variable size
+struct message {
+  header h;
+  std::string text;
+  std::vector<std::uint32_t> words;
+  std::vector<header> headers;
+  float big[300];
+};
+
+VISITABLE_STRUCT(message, h, text, words, headers, big);
+
+// Runs of scalars of the same width across nested members
+struct vec3 {
+  std::int32_t v[3];
+};
+
+VISITABLE_STRUCT(vec3, v);
+
+struct particle {
+  std::uint32_t id;
+  vec3 pos;
+  float mass;
+  std::array<std::uint16_t, 2> flags;
+};
+
+VISITABLE_STRUCT(particle, id, pos, mass, flags);
+
+bool operator == (const header & a, const header & b) {
+  return a.magic == b.magic && a.op == b.op && a.deltas[0] == b.deltas[0] && a.deltas[1] == b.deltas[1] &&
+         a.scale == b.scale && a.tag == b.tag;
+}
+
+std::string bytes(std::initializer_list<int> list) {
+  std::string s;
+  for (int b : list) { s.push_back(static_cast<char>(b)); }
+  return s;
+}
+
+/***
+ * tests
+ */
+
+namespace be = visit_struct::binary::big_endian;
+
+static_assert(be::detail::fixed_size<header>::value == 4 + 2 + 4 + 8 + 3, "");
+static_assert(be::detail::is_staged<header>::value, "");
+static_assert(!be::detail::is_staged<message>::value, "");
+static_assert(!be::detail::is_staged<float[300]>::value, "");
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  bool ok = true;
+  (void) ok;
+
+  // Exact bytes
+  {
+    const header h{ 0x11223344u, opcode::nop, { -2, 0x0506 }, 1.0, {{ 7, 8, 9 }} };
+    std::string out;
+    be::serialize(h, out);
+    assert(out == bytes({ 0x11, 0x22, 0x33, 0x44,
+                          0x01, 0x02,
+                          0xff, 0xfe, 0x05, 0x06,
+                          0x3f, 0xf0, 0, 0, 0, 0, 0, 0,
+                          7, 8, 9 }));
+
+    header g;
+    ok = be::deserialize(out, g);
+    assert(ok);
+    assert(g == h);
+
+    out.clear();
+    be::serialize(std::string("ab"), out);
+    assert(out == bytes({ 0, 0, 0, 0, 0, 0, 0, 2, 'a', 'b' }));
+
+    out.clear();
+    be::serialize(std::vector<std::uint16_t>{ 0x0a0b, 0x0c0d }, out);
+    assert(out == bytes({ 0, 0, 0, 0, 0, 0, 0, 2, 0x0a, 0x0b, 0x0c, 0x0d }));
+
+    const particle p{ 0x01020304u, {{ -1, 2, 0x7f000001 }}, 2.0f, {{ 0x0a0b, 0x0c0d }} };
+    out.clear();
+    be::serialize(p, out);
+    assert(out == bytes({ 0x01, 0x02, 0x03, 0x04,
+                          0xff, 0xff, 0xff, 0xff, 0, 0, 0, 2, 0x7f, 0, 0, 1,
+                          0x40, 0, 0, 0,
+                          0x0a, 0x0b, 0x0c, 0x0d }));
+
+    particle q;
+    ok = be::deserialize(out, q);
+    assert(ok);
+    assert(q.id == p.id && q.pos.v[0] == -1 && q.pos.v[2] == p.pos.v[2] && q.mass == p.mass && q.flags == p.flags);
+  }
+
+  // Round trip of a larger structure
+  {
+    message m;
+    m.h = header{ 1, opcode::halt, { 3, -4 }, -2.5, {{ 1, 2, 3 }} };
+    m.text = "hello";
+    for (std::uint32_t i = 0; i < 1000; ++i) { m.words.push_back(i * 2654435761u); }
+    for (int i = 0; i < 300; ++i) {
+      m.headers.push_back(header{ static_cast<std::uint32_t>(i), opcode::nop, { 0, static_cast<std::int16_t>(i) }, i / 3.0, {{ 0, 0, 0 }} });
+      m.big[i] = i * 0.5f;
+    }
+
+    std::string out;
+    be::serialize(m, out);
+    std::string native;
+    visit_struct::binary::serialize(m, native);
+    assert(out.size() == native.size());
+
+    message n;
+    ok = be::deserialize(out, n);
+    assert(ok);
+    assert(n.h == m.h && n.text == m.text && n.words == m.words && n.headers == m.headers);
+    for (int i = 0; i < 300; ++i) { assert(n.big[i] == m.big[i]); }
+
+    for (std::size_t len = 0; len < out.size(); len += 97) {
+      message k;
+      ok = be::deserialize(out.substr(0, len), k);
+      assert(!ok);
+    }
+  }
+}
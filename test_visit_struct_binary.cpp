@@ -0,0 +1,307 @@
+#include <visit_struct/visit_struct_binary.hpp>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define TEST_WRITEV
+#include <visit_struct/visit_struct_writev.hpp>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+enum class color : std::uint8_t { red, green, blue };
+
+struct point {
+  int x;
+  int y;
+};
+
+VISITABLE_STRUCT(point, x, y);
+
+struct journal_record {
+  std::uint64_t sequence;
+  color tag;
+  double values[3];
+  std::array<point, 2> bounds;
+  std::string payload;
+  std::vector<char> blob;
+  std::vector<point> points;
+};
+
+VISITABLE_STRUCT(journal_record, sequence, tag, values, bounds, payload, blob, points);
+
+bool operator == (const point & a, const point & b) {
+  return a.x == b.x && a.y == b.y;
+}
+
+struct eq_visitor {
+  bool result = true;
+
+  template <typename T>
+  void operator()(const char *, const T & t1, const T & t2) {
+    result = result && (t1 == t2);
+  }
+
+  template <typename T, std::size_t N>
+  void operator()(const char *, const T (&t1)[N], const T (&t2)[N]) {
+    for (std::size_t i = 0; i < N; ++i) {
+      result = result && (t1[i] == t2[i]);
+    }
+  }
+};
+
+template <typename T>
+bool struct_eq(const T & t1, const T & t2) {
+  eq_visitor vis;
+  visit_struct::for_each(t1, t2, vis);
+  return vis.result;
+}
+
+journal_record make_record(std::size_t payload_size) {
+  journal_record r;
+  r.sequence = 77;
+  r.tag = color::blue;
+  r.values[0] = 1.5;
+  r.values[1] = -2.5;
+  r.values[2] = 1e10;
+  r.bounds[0] = point{1, 2};
+  r.bounds[1] = point{-3, 4};
+  r.payload.assign(payload_size, 'p');
+  r.blob = {'a', 'b', 'c'};
+  r.points = {point{5, 6}, point{7, 8}, point{9, 10}};
+  return r;
+}
+
+// Concatenate the segments of a gather list
+std::string flatten(visit_struct::binary::gather_list & list) {
+  std::string result;
+  for (const auto & s : list.segments()) {
+    result.append(static_cast<const char *>(s.data), s.size);
+  }
+  return result;
+}
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  namespace binary = visit_struct::binary;
+  bool ok = true;
+  (void) ok;
+
+  // Round trip
+  {
+    journal_record r = make_record(10);
+
+    std::string buffer;
+    binary::serialize(r, buffer);
+
+    const std::size_t expected = sizeof(std::uint64_t) + sizeof(color) + 3 * sizeof(double)
+                               + 4 * sizeof(int)
+                               + sizeof(binary::size_type) + 10
+                               + sizeof(binary::size_type) + 3
+                               + sizeof(binary::size_type) + 6 * sizeof(int);
+    assert(buffer.size() == expected);
+    (void) expected;
+
+    journal_record r2;
+    ok = binary::deserialize(buffer, r2);
+    assert(ok);
+    assert(struct_eq(r, r2));
+  }
+
+  // Empty containers
+  {
+    journal_record r = make_record(0);
+    r.blob.clear();
+    r.points.clear();
+
+    std::string buffer;
+    binary::serialize(r, buffer);
+
+    journal_record r2 = make_record(5);
+    ok = binary::deserialize(buffer, r2);
+    assert(ok);
+    assert(struct_eq(r, r2));
+  }
+
+  // Truncated and trailing input is rejected
+  {
+    journal_record r = make_record(10);
+
+    std::string buffer;
+    binary::serialize(r, buffer);
+
+    for (std::size_t n = 0; n < buffer.size(); ++n) {
+      journal_record r2;
+      ok = binary::deserialize(buffer.substr(0, n), r2);
+      assert(!ok);
+    }
+
+    journal_record r2;
+    ok = binary::deserialize(buffer + "x", r2);
+    assert(!ok);
+  }
+
+  // Several records from one source
+  {
+    journal_record a = make_record(3);
+    journal_record b = make_record(4);
+    b.sequence = 78;
+
+    std::string buffer;
+    binary::serialize(a, buffer);
+    binary::serialize(b, buffer);
+
+    binary::source in{buffer.data(), buffer.size()};
+    journal_record a2, b2;
+    ok = binary::deserialize(in, a2);
+    assert(ok);
+    ok = binary::deserialize(in, b2);
+    assert(ok);
+    assert(!in.remaining());
+    assert(struct_eq(a, a2));
+    assert(struct_eq(b, b2));
+  }
+
+  // Gather list: large ranges are referenced, not copied
+  {
+    journal_record r = make_record(4096);
+
+    binary::gather_list list;
+    binary::gather(r, list);
+
+    bool payload_referenced = false;
+    for (const auto & s : list.segments()) {
+      if (s.data == r.payload.data()) {
+        assert(s.size == 4096);
+        payload_referenced = true;
+      }
+    }
+    assert(payload_referenced);
+    (void) payload_referenced;
+
+    // Staged pieces are coalesced: before payload, payload, after payload
+    assert(list.segments().size() == 3);
+
+    std::string buffer;
+    binary::serialize(r, buffer);
+    assert(list.size() == buffer.size());
+    assert(flatten(list) == buffer);
+
+    // Small ranges are staged
+    journal_record small = make_record(10);
+    binary::gather_list list2;
+    binary::gather(small, list2);
+    assert(list2.segments().size() == 1);
+
+    list.clear();
+    assert(list.empty());
+    assert(list.segments().empty());
+  }
+
+  // Several records in one list
+  {
+    journal_record a = make_record(1000);
+    journal_record b = make_record(2000);
+
+    binary::gather_list list{512};
+    binary::gather(a, list);
+    binary::gather(b, list);
+
+    std::string buffer;
+    binary::serialize(a, buffer);
+    binary::serialize(b, buffer);
+    assert(flatten(list) == buffer);
+
+    // Dropping written bytes, inside and across segments
+    for (std::size_t n : {std::size_t(3), std::size_t(1500), std::size_t(0), std::size_t(1)}) {
+      list.consume(n);
+      buffer.erase(0, n);
+      assert(list.size() == buffer.size());
+      assert(flatten(list) == buffer);
+    }
+    list.consume(list.size());
+    assert(list.empty() && list.segments().empty());
+  }
+
+#ifdef TEST_WRITEV
+  // Write to a pipe with writev
+  {
+    int fds[2];
+    ok = ::pipe(fds) == 0;
+    assert(ok);
+
+    journal_record r = make_record(4096);
+    binary::gather_list scratch;
+    ok = binary::write_gathered(fds[1], r, scratch);
+    assert(ok);
+    assert(scratch.empty());
+    ::close(fds[1]);
+
+    std::string received;
+    char buf[1024];
+    ssize_t n;
+    while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+      received.append(buf, static_cast<std::size_t>(n));
+    }
+    ::close(fds[0]);
+
+    journal_record r2;
+    ok = binary::deserialize(received, r2);
+    assert(ok);
+    assert(struct_eq(r, r2));
+  }
+
+  // A write interrupted by a full non-blocking pipe resumes where it stopped
+  {
+    int fds[2];
+    ok = ::pipe(fds) == 0;
+    assert(ok);
+    ok = ::fcntl(fds[1], F_SETFL, ::fcntl(fds[1], F_GETFL) | O_NONBLOCK) == 0;
+    assert(ok);
+
+    journal_record r = make_record(1 << 20);
+    binary::gather_list list;
+    binary::gather(r, list);
+    const std::size_t total = list.size();
+
+    std::string received;
+    char buf[4096];
+    int stalls = 0;
+    while (!list.empty()) {
+      if (!binary::write_gathered(fds[1], list)) {
+        assert(errno == EAGAIN || errno == EWOULDBLOCK);
+        assert(list.size() + received.size() <= total);
+        ++stalls;
+      }
+      ssize_t n;
+      while (received.size() + list.size() < total && (n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+        received.append(buf, static_cast<std::size_t>(n));
+      }
+    }
+    ::close(fds[1]);
+    ssize_t n;
+    while ((n = ::read(fds[0], buf, sizeof(buf))) > 0) {
+      received.append(buf, static_cast<std::size_t>(n));
+    }
+    ::close(fds[0]);
+    assert(stalls > 0);
+    (void) stalls;
+
+    journal_record r2;
+    ok = binary::deserialize(received, r2);
+    assert(ok);
+    assert(struct_eq(r, r2));
+  }
+#endif
+}
@@ -0,0 +1,203 @@
+#include <visit_struct/visit_struct_bitpack.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+
+/***
+ * Test structures
+ */
+
+enum class severity : std::uint8_t { debug, info, warning, error, fatal };
+
+struct telemetry {
+  severity level;
+  bool valid;
+  bool throttled;
+  std::int8_t trend;
+  std::uint16_t channel;
+  float reading;
+  std::uint64_t timestamp;
+  std::int32_t offset;
+};
+
+VISITABLE_STRUCT(telemetry, level, valid, throttled, trend, channel, reading, timestamp, offset);
+VISITABLE_BIT_WIDTHS(telemetry, 3, 1, 1, 5, 12, 32, 40, 20);
+
+// Members which straddle word boundaries, and a full 64 bit member
+struct wide {
+  std::uint64_t a;
+  std::int64_t b;
+  std::uint64_t c;
+  std::int16_t d;
+};
+
+VISITABLE_STRUCT(wide, a, b, c, d);
+VISITABLE_BIT_WIDTHS(wide, 60, 64, 63, 9);
+
+// Members stored as offsets within a range
+struct quote {
+  severity level;
+  std::int16_t spread;
+  std::uint32_t venue;
+  std::int64_t delta;
+  std::uint8_t version;
+  std::int32_t tick;
+};
+
+VISITABLE_STRUCT(quote, level, spread, venue, delta, version, tick);
+
+// Ranges which need 2, 12, 4, 64, 0 and 1 bits
+VISITABLE_BIT_FIELDS(quote, bit_range<1, 4>, bit_range<-2000, 2000>, bit_range<100, 115>,
+                     bit_width<64>, bit_range<7, 7>, bit_range<-1, 0>);
+
+bool operator == (const telemetry & x, const telemetry & y) {
+  return x.level == y.level && x.valid == y.valid && x.throttled == y.throttled && x.trend == y.trend &&
+         x.channel == y.channel && x.reading == y.reading && x.timestamp == y.timestamp && x.offset == y.offset;
+}
+
+/***
+ * tests
+ */
+
+using visit_struct::binary::packed;
+
+static_assert(packed<telemetry>::bits == 114, "");
+static_assert(packed<telemetry>::bytes == 15, "");
+static_assert(packed<telemetry>::words == 2, "");
+static_assert(packed<wide>::bits == 196, "");
+static_assert(packed<quote>::bits == 2 + 12 + 4 + 64 + 0 + 1, "");
+static_assert(packed<quote>::words == 2, "");
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+  bool ok = true;
+  (void) ok;
+
+  // Round trip
+  {
+    const telemetry t{ severity::warning, true, false, -9, 4000, 3.25f, (std::uint64_t(1) << 39) + 17, -300000 };
+    packed<telemetry> p;
+    ok = p.pack(t);
+    assert(ok);
+    assert(p.unpack() == t);
+
+    assert(p.get<0>() == severity::warning);
+    assert(p.get<3>() == -9);
+    assert(p.get<6>() == t.timestamp);
+    assert(p.get<7>() == -300000);
+
+    ok = p.set<4>(17);
+    assert(ok);
+    assert(p.get<4>() == 17);
+    assert(p.get<3>() == -9 && p.get<5>() == 3.25f);
+  }
+
+  // Extreme values of each width
+  {
+    const telemetry lo{ severity::debug, false, false, -16, 0, -0.0f, 0, -(1 << 19) };
+    const telemetry hi{ severity::fatal, true, true, 15, 4095, 1e30f, (std::uint64_t(1) << 40) - 1, (1 << 19) - 1 };
+    assert(packed<telemetry>(lo).unpack() == lo);
+    assert(packed<telemetry>(hi).unpack() == hi);
+    (void) lo;
+    (void) hi;
+
+    const wide w{ (std::uint64_t(1) << 60) - 1, INT64_MIN, (std::uint64_t(1) << 63) - 1, -256 };
+    packed<wide> p;
+    ok = p.pack(w);
+    assert(ok);
+    const wide u = p.unpack();
+    assert(u.a == w.a && u.b == w.b && u.c == w.c && u.d == w.d);
+    (void) u;
+
+    // Neighbours are not disturbed
+    p.set<1>(-1);
+    assert(p.get<0>() == w.a && p.get<2>() == w.c && p.get<1>() == -1);
+  }
+
+  // Values which don't fit are reported, and truncated
+  {
+    telemetry t{ severity::info, true, false, 16, 4096, 0.0f, 0, 0 };
+    packed<telemetry> p;
+    ok = p.pack(t);
+    assert(!ok);
+    assert(p.get<3>() == -16);
+    assert(p.get<4>() == 0);
+    ok = p.set<7>(1 << 19);
+    assert(!ok);
+    ok = p.set<7>(-(1 << 19));
+    assert(ok);
+  }
+
+  // Ranges
+  {
+    const quote q{ severity::fatal, -2000, 115, INT64_MIN, 7, -1 };
+    packed<quote> p;
+    ok = p.pack(q);
+    assert(ok);
+    assert(p.get<0>() == severity::fatal);
+    assert(p.get<1>() == -2000);
+    assert(p.get<2>() == 115);
+    assert(p.get<3>() == INT64_MIN);
+    assert(p.get<4>() == 7);
+    assert(p.get<5>() == -1);
+
+    // Offsets from the lower bound
+    assert((p.data()[0] & 0x3) == 3);
+    assert(((p.data()[0] >> 2) & 0xfff) == 0);
+    assert(((p.data()[0] >> 14) & 0xf) == 15);
+
+    ok = p.set<1>(2000);
+    assert(ok && p.get<1>() == 2000);
+    ok = p.set<2>(100);
+    assert(ok && p.get<2>() == 100);
+    ok = p.set<5>(0);
+    assert(ok && p.get<5>() == 0);
+    assert(p.get<3>() == INT64_MIN && p.get<0>() == severity::fatal);
+
+    // Values outside their range are reported
+    ok = p.set<0>(severity::debug);
+    assert(!ok);
+    ok = p.set<1>(2001);
+    assert(!ok);
+    ok = p.set<1>(-2001);
+    assert(!ok);
+    ok = p.set<2>(99);
+    assert(!ok);
+    ok = p.set<2>(116);
+    assert(!ok);
+    ok = p.set<4>(8);
+    assert(!ok);
+    const quote r{ severity::info, 0, 0, 0, 7, 0 };
+    ok = p.pack(r);
+    assert(!ok);
+    ok = p.set<2>(107) && p.set<1>(-5);
+    assert(ok);
+
+    std::string buffer;
+    visit_struct::binary::serialize(p, buffer);
+    assert(buffer.size() == 11);
+    packed<quote> u;
+    ok = visit_struct::binary::deserialize(buffer, u);
+    assert(ok && u == p);
+    assert(u.get<1>() == -5 && u.get<2>() == 107 && u.get<4>() == 7);
+  }
+
+  // Binary encoding
+  {
+    const telemetry t{ severity::error, false, true, 3, 1234, -1.5f, 987654321, 42 };
+    std::string buffer;
+    visit_struct::binary::serialize(packed<telemetry>(t), buffer);
+    assert(buffer.size() == packed<telemetry>::bytes);
+    assert((static_cast<unsigned char>(buffer[0]) & 0x7) == 3);
+
+    packed<telemetry> p;
+    ok = visit_struct::binary::deserialize(buffer, p);
+    assert(ok);
+    assert(p == packed<telemetry>(t));
+    assert(p.unpack() == t);
+    ok = visit_struct::binary::deserialize(buffer.substr(1), p);
+    assert(!ok);
+  }
+}
@@ -0,0 +1,178 @@
+#include <visit_struct/visit_struct_compact.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+enum class state : std::uint16_t { idle, busy = 300 };
+
+struct counters {
+  std::uint32_t requests;
+  std::int32_t delta;
+  std::int64_t balance;
+  std::uint64_t bytes;
+  state s;
+  bool active;
+  char code;
+  double ratio;
+  std::int16_t history[4];
+  std::array<std::uint8_t, 3> flags;
+};
+
+VISITABLE_STRUCT(counters, requests, delta, balance, bytes, s, active, code, ratio, history, flags);
+
+struct snapshot {
+  std::string host;
+  std::vector<counters> items;
+  std::vector<std::int32_t> samples;
+  std::vector<std::uint64_t> offsets;
+};
+
+VISITABLE_STRUCT(snapshot, host, items, samples, offsets);
+
+counters make_counters(int i) {
+  counters c;
+  c.requests = static_cast<std::uint32_t>(i);
+  c.delta = -i;
+  c.balance = std::numeric_limits<std::int64_t>::min() + i;
+  c.bytes = std::numeric_limits<std::uint64_t>::max() - static_cast<std::uint64_t>(i);
+  c.s = i % 2 ? state::busy : state::idle;
+  c.active = i % 3 == 0;
+  c.code = static_cast<char>('a' + i);
+  c.ratio = i / 7.0;
+  for (int k = 0; k < 4; ++k) { c.history[k] = static_cast<std::int16_t>(k * 1000 - i); }
+  c.flags = {{ 1, 2, static_cast<std::uint8_t>(i) }};
+  return c;
+}
+
+bool operator == (const counters & a, const counters & b) {
+  for (int k = 0; k < 4; ++k) {
+    if (a.history[k] != b.history[k]) { return false; }
+  }
+  return a.requests == b.requests && a.delta == b.delta && a.balance == b.balance &&
+         a.bytes == b.bytes && a.s == b.s && a.active == b.active && a.code == b.code &&
+         a.ratio == b.ratio && a.flags == b.flags;
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  namespace binary = visit_struct::binary;
+  namespace compact = visit_struct::binary::compact;
+  bool ok = true;
+  (void) ok;
+
+  // Varint sizes
+  {
+    std::string out;
+    compact::serialize(std::uint32_t(127), out);
+    assert(out.size() == 1);
+    out.clear();
+    compact::serialize(std::uint32_t(128), out);
+    assert(out.size() == 2);
+    out.clear();
+    compact::serialize(std::int64_t(-1), out);
+    assert(out.size() == 1);
+    out.clear();
+    compact::serialize(std::int64_t(-64), out);
+    assert(out.size() == 1);
+    out.clear();
+    compact::serialize(std::numeric_limits<std::uint64_t>::max(), out);
+    assert(out.size() == 10);
+    out.clear();
+    compact::serialize(std::numeric_limits<std::int64_t>::min(), out);
+    assert(out.size() == 10);
+  }
+
+  // Round trip of a structure, and comparison with the fixed-width encoding
+  {
+    snapshot s;
+    s.host = "localhost";
+    for (int i = 0; i < 20; ++i) { s.items.push_back(make_counters(i)); }
+    for (int i = -500; i < 500; ++i) { s.samples.push_back(i * i * (i % 2 ? -1 : 1)); }
+    for (std::uint64_t i = 0; i < 100; ++i) { s.offsets.push_back(i << (i % 64)); }
+
+    std::string small, fixed;
+    compact::serialize(s, small);
+    binary::serialize(s, fixed);
+    assert(small.size() < fixed.size());
+
+    snapshot t;
+    ok = compact::deserialize(small, t);
+    assert(ok);
+    assert(t.host == s.host);
+    assert(t.items.size() == s.items.size());
+    for (std::size_t i = 0; i < s.items.size(); ++i) { assert(t.items[i] == s.items[i]); }
+    assert(t.samples == s.samples);
+    assert(t.offsets == s.offsets);
+
+    // Every truncation is detected
+    for (std::size_t n = 0; n < small.size(); ++n) {
+      snapshot u;
+      ok = compact::deserialize(small.substr(0, n), u);
+      assert(!ok);
+    }
+  }
+
+  // Bulk decoding, across mixed lengths and the end of the buffer
+  {
+    std::vector<std::uint64_t> values;
+    for (int i = 0; i < 64; ++i) { values.push_back(static_cast<std::uint64_t>(i)); }
+    for (int shift = 0; shift < 64; ++shift) {
+      values.push_back(std::uint64_t(1) << shift);
+      values.push_back((std::uint64_t(1) << shift) - 1);
+      values.push_back(3);
+    }
+    values.push_back(std::numeric_limits<std::uint64_t>::max());
+
+    std::string out;
+    binary::string_sink sink{out};
+    for (std::uint64_t v : values) { compact::detail::write_varint(sink, v); }
+
+    std::vector<std::uint64_t> decoded(values.size());
+    binary::source in{out.data(), out.size()};
+    ok = compact::read_varints(in, decoded.data(), decoded.size());
+    assert(ok);
+    assert(decoded == values);
+    assert(!in.remaining());
+
+    binary::source short_in{out.data(), out.size() - 1};
+    ok = compact::read_varints(short_in, decoded.data(), decoded.size());
+    assert(!ok);
+  }
+
+  // Out of range values are rejected
+  {
+    std::string out;
+    compact::serialize(std::uint32_t(70000), out);
+    std::uint16_t narrow;
+    ok = compact::deserialize(out, narrow);
+    assert(!ok);
+
+    out.clear();
+    compact::serialize(std::vector<std::int32_t>{ 1, -40000, 3 }, out);
+    std::vector<std::int16_t> narrow_vec;
+    ok = compact::deserialize(out, narrow_vec);
+    assert(!ok);
+
+    // Overlong: eleven bytes
+    const std::string overlong(10, '\xff');
+    std::uint64_t wide;
+    ok = compact::deserialize(overlong + '\x01', wide);
+    assert(!ok);
+    ok = compact::deserialize(std::string(9, '\xff') + '\x02', wide);
+    assert(!ok);
+  }
+}
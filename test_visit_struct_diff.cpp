@@ -0,0 +1,187 @@
+#include <visit_struct/visit_struct_diff.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct limits {
+  double max_position;
+  double max_order;
+  int thresholds[3];
+};
+
+VISITABLE_STRUCT(limits, max_position, max_order, thresholds);
+
+struct endpoint {
+  std::string host;
+  std::uint16_t port;
+};
+
+VISITABLE_STRUCT(endpoint, host, port);
+
+struct config {
+  std::uint64_t version;
+  endpoint primary;
+  endpoint backup;
+  limits risk;
+  std::vector<std::string> symbols;
+};
+
+VISITABLE_STRUCT(config, version, primary, backup, risk, symbols);
+
+struct eq_visitor {
+  bool result = true;
+
+  template <typename T>
+  void operator()(const char *, const T & t1, const T & t2) {
+    result = result && visit_struct::binary::detail::leaf_equal(t1, t2);
+  }
+
+  void operator()(const char *, const endpoint & a, const endpoint & b) {
+    visit_struct::for_each(a, b, *this);
+  }
+
+  void operator()(const char *, const limits & a, const limits & b) {
+    visit_struct::for_each(a, b, *this);
+  }
+};
+
+bool struct_eq(const config & a, const config & b) {
+  eq_visitor vis;
+  visit_struct::for_each(a, b, vis);
+  return vis.result;
+}
+
+config make_config() {
+  return config{1, endpoint{"10.0.0.1", 9000}, endpoint{"10.0.0.2", 9000},
+                limits{1e6, 1e4, {1, 2, 3}}, {"AAPL", "MSFT"}};
+}
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  namespace binary = visit_struct::binary;
+  bool ok = true;
+  std::size_t changed = 0;
+  (void) ok;
+  (void) changed;
+
+  // No difference
+  {
+    config a = make_config();
+    std::string p;
+    changed = binary::diff(a, a, p);
+    assert(changed == 0);
+    assert(p.size() == sizeof(std::uint16_t));
+
+    config b = make_config();
+    ok = binary::patch(p, b);
+    assert(ok);
+    assert(struct_eq(a, b));
+  }
+
+  // Top level and nested changes
+  {
+    config a = make_config();
+    config b = a;
+    b.version = 2;
+    b.backup.port = 9001;
+    b.risk.thresholds[1] = 20;
+
+    std::string p;
+    changed = binary::diff(a, b, p);
+    assert(changed == 3);
+
+    std::string full;
+    binary::serialize(b, full);
+    assert(p.size() < full.size());
+
+    // version: index + value
+    // backup: index + count + (index + port)
+    // risk: index + count + (index + thresholds)
+    const std::size_t idx = sizeof(std::uint16_t);
+    assert(p.size() == idx
+                     + idx + sizeof(std::uint64_t)
+                     + idx + idx + idx + sizeof(std::uint16_t)
+                     + idx + idx + idx + 3 * sizeof(int));
+    (void) idx;
+
+    config c = a;
+    ok = binary::patch(p, c);
+    assert(ok);
+    assert(struct_eq(b, c));
+    assert(!struct_eq(a, c));
+  }
+
+  // Container members are replaced as a whole
+  {
+    config a = make_config();
+    config b = a;
+    b.symbols.push_back("GOOG");
+    b.primary.host = "10.0.0.3";
+
+    std::string p;
+    changed = binary::diff(a, b, p);
+    assert(changed == 2);
+
+    config c = a;
+    ok = binary::patch(p, c);
+    assert(ok);
+    assert(struct_eq(b, c));
+  }
+
+  // A sequence of patches stored back to back
+  {
+    config v1 = make_config();
+    config v2 = v1;
+    v2.version = 2;
+    config v3 = v2;
+    v3.risk.max_order = 5;
+
+    std::string log;
+    binary::diff(v1, v2, log);
+    binary::diff(v2, v3, log);
+
+    config replay = v1;
+    binary::source in{log.data(), log.size()};
+    ok = binary::patch(in, replay);
+    assert(ok);
+    assert(struct_eq(replay, v2));
+    ok = binary::patch(in, replay);
+    assert(ok);
+    assert(struct_eq(replay, v3));
+    assert(!in.remaining());
+  }
+
+  // Malformed patches are rejected
+  {
+    config a = make_config();
+    config b = a;
+    b.version = 5;
+    b.risk.max_position = 1;
+
+    std::string p;
+    binary::diff(a, b, p);
+
+    for (std::size_t n = 0; n < p.size(); ++n) {
+      config c = a;
+      ok = binary::patch(p.substr(0, n), c);
+      assert(!ok);
+    }
+
+    // Index out of range
+    std::string bad;
+    const std::uint16_t count = 1, index = 7;
+    bad.append(reinterpret_cast<const char *>(&count), sizeof(count));
+    bad.append(reinterpret_cast<const char *>(&index), sizeof(index));
+    config c = a;
+    ok = binary::patch(bad, c);
+    assert(!ok);
+  }
+}
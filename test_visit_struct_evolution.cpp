@@ -0,0 +1,314 @@
+#include <visit_struct/visit_struct_evolution.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures: two versions of the same record
+ */
+
+struct point {
+  double x;
+  double y;
+};
+
+VISITABLE_STRUCT(point, x, y);
+
+namespace v1 {
+
+struct account {
+  std::uint64_t id;
+  std::string owner;
+  std::int32_t balance;
+  std::vector<std::string> tags;   // removed in v2, variable size
+  std::int16_t legacy_flags[3];    // removed in v2, fixed size
+  point location;
+};
+
+} // end namespace v1
+
+namespace v2 {
+
+enum class tier : std::uint8_t { basic, gold };
+
+// Reordered, two members removed, one renamed, two added
+struct account {
+  point location;
+  std::int32_t balance;
+  std::uint64_t id;
+  std::string name;                // was `owner`
+  tier level;                      // new
+  std::array<float, 2> limits;     // new
+};
+
+} // end namespace v2
+
+VISITABLE_STRUCT(v1::account, id, owner, balance, tags, legacy_flags, location);
+VISITABLE_STRUCT(v2::account, location, balance, id, name, level, limits);
+
+// Same names as v1, but a member changed type
+namespace retyped {
+
+struct account {
+  std::uint64_t id;
+  std::string owner;
+  double balance;
+};
+
+} // end namespace retyped
+
+VISITABLE_STRUCT(retyped::account, id, owner, balance);
+
+// Removed members with nested variable parts
+namespace nested {
+
+struct leg {
+  std::int32_t quantity;
+  std::string venue;
+  double price;
+  point at;
+};
+
+struct order_v1 {
+  std::uint64_t id;
+  std::array<leg, 2> legs;
+  std::vector<point> path;
+  std::vector<std::vector<std::int16_t>> matrix;
+  std::uint8_t flag;
+};
+
+struct order_v2 {
+  std::uint64_t id;
+  std::uint8_t flag;
+};
+
+} // end namespace nested
+
+VISITABLE_STRUCT(nested::leg, quantity, venue, price, at);
+VISITABLE_STRUCT(nested::order_v1, id, legs, path, matrix, flag);
+VISITABLE_STRUCT(nested::order_v2, id, flag);
+
+// Character members
+struct label {
+  std::string text;
+  signed char low;
+  unsigned char high;
+};
+
+VISITABLE_STRUCT(label, text, low, high);
+
+v1::account make_v1(std::uint64_t id) {
+  v1::account a;
+  a.id = id;
+  a.owner = "owner" + std::to_string(id);
+  a.balance = static_cast<std::int32_t>(id * 100);
+  a.tags = { "a", "bb", std::string(id, 'c') };
+  a.legacy_flags[0] = 1;
+  a.legacy_flags[1] = 2;
+  a.legacy_flags[2] = 3;
+  a.location = point{ 1.5 * id, -2.0 };
+  return a;
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  namespace binary = visit_struct::binary;
+  bool ok = true;
+  (void) ok;
+
+  // Write a v1 stream
+  std::string stream;
+  binary::write_schema<v1::account>(stream);
+  for (std::uint64_t i = 0; i < 4; ++i) {
+    binary::serialize(make_v1(i), stream);
+  }
+
+  // Read it back with v1, nothing to remap
+  {
+    binary::source in{stream.data(), stream.size()};
+    binary::schema_reader<v1::account> reader;
+    assert(!reader.valid());
+    ok = reader.read_header(in);
+    assert(ok);
+    assert(reader.identical());
+    assert(!reader.skipped_count() && !reader.missing_count());
+
+    for (std::uint64_t i = 0; i < 4; ++i) {
+      v1::account a;
+      ok = reader.read(in, a);
+      assert(ok);
+      const v1::account expected = make_v1(i);
+      assert(a.id == expected.id && a.owner == expected.owner && a.tags == expected.tags);
+      assert(a.legacy_flags[2] == 3);
+    }
+    assert(!in.remaining());
+  }
+
+  // Read it with v2
+  {
+    v2::account defaults{};
+    defaults.level = v2::tier::gold;
+    defaults.limits = {{ 10.0f, 20.0f }};
+
+    binary::source in{stream.data(), stream.size()};
+    binary::schema_reader<v2::account> reader{defaults};
+    reader.rename("owner", "name");
+    ok = reader.read_header(in);
+    assert(ok);
+    assert(reader.valid() && !reader.identical());
+    assert(reader.skipped_count() == 2);
+    assert(reader.missing_count() == 2);
+
+    for (std::uint64_t i = 0; i < 4; ++i) {
+      v2::account a{};
+      ok = reader.read(in, a);
+      assert(ok);
+      assert(a.id == i);
+      assert(a.name == "owner" + std::to_string(i));
+      assert(a.balance == static_cast<std::int32_t>(i * 100));
+      assert(a.location.x == 1.5 * i && a.location.y == -2.0);
+      assert(a.level == v2::tier::gold);
+      assert(a.limits[1] == 20.0f);
+    }
+    assert(!in.remaining());
+  }
+
+  // Without the rename, `owner` is skipped and `name` is defaulted
+  {
+    binary::source in{stream.data(), stream.size()};
+    binary::schema_reader<v2::account> reader;
+    ok = reader.read_header(in);
+    assert(ok);
+    assert(reader.skipped_count() == 3);
+    assert(reader.missing_count() == 3);
+
+    v2::account a{};
+    a.name = "stale";
+    ok = reader.read(in, a);
+    assert(ok);
+    assert(a.name.empty());
+    assert(a.id == 0);
+  }
+
+  // Changed member types are rejected
+  {
+    binary::source in{stream.data(), stream.size()};
+    binary::schema_reader<retyped::account> reader;
+    ok = reader.read_header(in);
+    assert(!ok);
+    retyped::account a;
+    ok = reader.read(in, a);
+    assert(!ok);
+  }
+
+  // Truncated headers and records are rejected
+  {
+    std::string header;
+    binary::write_schema<v1::account>(header);
+    for (std::size_t n = 0; n < header.size(); ++n) {
+      binary::source in{header.data(), n};
+      binary::schema_reader<v2::account> reader;
+      ok = reader.read_header(in);
+      assert(!ok);
+    }
+
+    std::string record;
+    binary::serialize(make_v1(3), record);
+    for (std::size_t n = 0; n < record.size(); ++n) {
+      binary::source hin{header.data(), header.size()};
+      binary::schema_reader<v2::account> reader;
+      ok = reader.read_header(hin);
+      assert(ok);
+      binary::source in{record.data(), n};
+      v2::account a;
+      ok = reader.read(in, a);
+      assert(!ok);
+    }
+  }
+
+  // Nested arrays, vectors and structures are skipped
+  {
+    std::string stream;
+    binary::write_schema<nested::order_v1>(stream);
+    for (std::uint64_t i = 0; i < 5; ++i) {
+      nested::order_v1 o{};
+      o.id = i;
+      o.legs[0] = nested::leg{1, std::string(i, 'v'), 2.5, point{1, 2}};
+      o.legs[1] = nested::leg{3, "XNYS", 4.5, point{3, 4}};
+      o.path.assign(i, point{5, 6});
+      o.matrix.assign(i, std::vector<std::int16_t>(i + 1, 7));
+      o.flag = static_cast<std::uint8_t>(10 + i);
+      binary::serialize(o, stream);
+    }
+
+    binary::source in{stream.data(), stream.size()};
+    binary::schema_reader<nested::order_v2> reader;
+    ok = reader.read_header(in);
+    assert(ok);
+    assert(reader.skipped_count() == 3);
+    for (std::uint64_t i = 0; i < 5; ++i) {
+      nested::order_v2 o{};
+      ok = reader.read(in, o);
+      assert(ok);
+      assert(o.id == i && o.flag == 10 + i);
+    }
+    assert(!in.remaining());
+
+    // Truncated anywhere inside the skipped members
+    binary::source hin{stream.data(), stream.size()};
+    ok = reader.read_header(hin);
+    assert(ok);
+    const std::size_t record = stream.size() - hin.remaining();
+    std::string first;
+    {
+      binary::source rin{stream.data() + record, stream.size() - record};
+      nested::order_v2 o;
+      ok = reader.read(rin, o);
+      assert(ok);
+      first.assign(stream.data() + record, stream.size() - record - rin.remaining());
+    }
+    for (std::size_t n = 0; n < first.size(); ++n) {
+      binary::source tin{first.data(), n};
+      nested::order_v2 o;
+      ok = reader.read(tin, o);
+      assert(!ok);
+    }
+  }
+
+  // Corrupt shapes are rejected
+  {
+    std::string header;
+    binary::write_schema<point>(header);
+    const std::size_t shape_pos = 3 * sizeof(std::uint16_t) + 1;  // count, name length, "x", shape length
+    assert(header[shape_pos] == 'f');
+    header[shape_pos] = 'z';
+    binary::source in{header.data(), header.size()};
+    binary::schema_reader<point> reader;
+    ok = reader.read_header(in);
+    assert(!ok);
+  }
+
+  // Plain char has its own shape code, whatever its signedness
+  {
+    std::string header;
+    binary::write_schema<label>(header);
+    // count, then name length, name, shape length, shape for each member
+    const std::size_t text_pos = 3 * sizeof(std::uint16_t) + 4;
+    const std::size_t low_pos = text_pos + 3 + 2 * sizeof(std::uint16_t) + 3;
+    const std::size_t high_pos = low_pos + 2 + 2 * sizeof(std::uint16_t) + 4;
+    assert(header.size() == high_pos + 2);
+    assert(header.compare(text_pos, 3, "vc\x01") == 0);
+    assert(header.compare(low_pos, 2, "i\x01") == 0);
+    assert(header.compare(high_pos, 2, "u\x01") == 0);
+    (void) high_pos;
+  }
+}
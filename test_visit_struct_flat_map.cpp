@@ -0,0 +1,218 @@
+#include <visit_struct/visit_struct_flat_map.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+enum class side : std::uint8_t { buy, sell };
+
+namespace std {
+template <>
+struct hash<side> {
+  std::size_t operator()(side s) const { return static_cast<std::size_t>(s); }
+};
+}
+
+struct instrument_key {
+  int venue;
+  std::string symbol;
+  side s;
+};
+
+VISITABLE_STRUCT(instrument_key, venue, symbol, s);
+
+struct nested_key {
+  instrument_key instrument;
+  std::uint32_t account;
+};
+
+VISITABLE_STRUCT(nested_key, instrument, account);
+
+// Every key collides in the map, so probing and comparison do all the work
+struct constant_hash {
+  std::size_t operator()(const instrument_key &) const { return 7; }
+};
+
+typedef visit_struct::flat_map<instrument_key, double> book_map;
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+  bool ok = true;
+  (void) ok;
+  std::size_t erased = 0;
+  (void) erased;
+
+  // Generated hash and equality
+  {
+    visit_struct::struct_hash<instrument_key> h;
+    visit_struct::struct_equal<instrument_key> eq;
+    instrument_key a{1, "ACME", side::buy};
+    instrument_key b{1, "ACME", side::buy};
+    instrument_key c{1, "ACME", side::sell};
+    instrument_key d{2, "ACME", side::buy};
+
+    assert(eq(a, b) && h(a) == h(b));
+    assert(!eq(a, c) && h(a) != h(c));
+    assert(!eq(a, d) && h(a) != h(d));
+    (void) h;
+    (void) eq;
+
+    visit_struct::struct_hash<nested_key> hn;
+    visit_struct::struct_equal<nested_key> eqn;
+    nested_key x{a, 5};
+    nested_key y{b, 5};
+    nested_key z{c, 5};
+    assert(eqn(x, y) && hn(x) == hn(y));
+    assert(!eqn(x, z) && hn(x) != hn(z));
+    (void) hn;
+    (void) eqn;
+
+    // Usable with the standard containers
+    std::unordered_map<instrument_key, int, visit_struct::struct_hash<instrument_key>, visit_struct::struct_equal<instrument_key>> m;
+    m[a] = 1;
+    m[b] += 1;
+    m[c] = 5;
+    assert(m.size() == 2 && m[a] == 2);
+  }
+
+  // Basic operations
+  {
+    book_map m;
+    assert(m.empty() && m.capacity() == 0);
+    assert(m.find(instrument_key{1, "ACME", side::buy}) == m.end());
+    erased = m.erase(instrument_key{1, "ACME", side::buy});
+    assert(erased == 0);
+
+    auto r = m.insert(std::make_pair(instrument_key{1, "ACME", side::buy}, 10.5));
+    assert(r.second && r.first->second == 10.5);
+    r = m.insert(std::make_pair(instrument_key{1, "ACME", side::buy}, 11.0));
+    assert(!r.second && r.first->second == 10.5);
+
+    m[instrument_key{1, "ACME", side::sell}] = 11.0;
+    m[instrument_key{2, "ACME", side::buy}] += 1.0;
+    assert(m.size() == 3);
+    assert(m.count(instrument_key{1, "ACME", side::sell}) == 1);
+    assert(m.find(instrument_key{2, "ACME", side::buy})->second == 1.0);
+    assert(m.count(instrument_key{2, "ACME", side::sell}) == 0);
+
+    ok = m.try_emplace(instrument_key{3, "XYZ", side::sell}, 4.0).second;
+    assert(ok);
+    ok = m.try_emplace(instrument_key{3, "XYZ", side::sell}, 5.0).second;
+    assert(!ok);
+
+    double total = 0;
+    std::size_t n = 0;
+    for (const book_map::value_type & v : m) {
+      total += v.second;
+      ++n;
+    }
+    assert(n == 4 && total == 10.5 + 11.0 + 1.0 + 4.0);
+
+    erased = m.erase(instrument_key{1, "ACME", side::buy});
+    assert(erased == 1);
+    assert(m.size() == 3 && m.count(instrument_key{1, "ACME", side::buy}) == 0);
+
+    // Erase through iterators
+    for (auto it = m.begin(); it != m.end();) {
+      if (it->first.venue == 1) {
+        it = m.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    assert(m.size() == 2 && m.count(instrument_key{1, "ACME", side::sell}) == 0);
+
+    // Copy and move
+    book_map copy = m;
+    assert(copy.size() == 2 && copy.find(instrument_key{3, "XYZ", side::sell})->second == 4.0);
+    book_map moved = std::move(copy);
+    assert(moved.size() == 2 && moved.count(instrument_key{2, "ACME", side::buy}) == 1);
+    m.clear();
+    assert(m.empty() && m.begin() == m.end());
+    assert(moved.size() == 2);
+  }
+
+  // Growth and reserve
+  {
+    visit_struct::flat_map<instrument_key, int> m;
+    m.reserve(1000);
+    const std::size_t capacity = m.capacity();
+    assert(capacity >= 1000);
+    for (int i = 0; i < 1000; ++i) { m[instrument_key{i, "S" + std::to_string(i % 10), side::buy}] = i; }
+    assert(m.capacity() == capacity && m.size() == 1000);
+    (void) capacity;
+
+    for (int i = 1000; i < 10000; ++i) { m[instrument_key{i, "S", side::sell}] = i; }
+    assert(m.size() == 10000);
+    for (int i = 0; i < 1000; ++i) { assert(m.find(instrument_key{i, "S" + std::to_string(i % 10), side::buy})->second == i); }
+    for (int i = 1000; i < 10000; ++i) { assert(m.find(instrument_key{i, "S", side::sell})->second == i); }
+  }
+
+  // Colliding hashes
+  {
+    visit_struct::flat_map<instrument_key, int, constant_hash> m;
+    for (int i = 0; i < 100; ++i) { m[instrument_key{i, "C", side::buy}] = i; }
+    for (int i = 0; i < 100; i += 2) {
+      erased = m.erase(instrument_key{i, "C", side::buy});
+      assert(erased == 1);
+    }
+    assert(m.size() == 50);
+    for (int i = 0; i < 100; ++i) { assert(m.count(instrument_key{i, "C", side::buy}) == std::size_t(i % 2)); }
+  }
+
+  // Random operations against std::unordered_map, with many erasures so
+  // that deleted slots are reused and cleaned up
+  {
+    std::mt19937 gen(48);
+    std::uniform_int_distribution<int> key_dist(0, 3000);
+    std::uniform_int_distribution<int> op_dist(0, 2);
+
+    visit_struct::flat_map<instrument_key, int> m;
+    std::unordered_map<instrument_key, int, visit_struct::struct_hash<instrument_key>, visit_struct::struct_equal<instrument_key>> expected;
+
+    for (int step = 0; step < 200000; ++step) {
+      const int k = key_dist(gen);
+      const instrument_key key{k % 50, std::to_string(k / 50), k % 3 ? side::buy : side::sell};
+      switch (op_dist(gen)) {
+        case 0:
+          m[key] = step;
+          expected[key] = step;
+          break;
+        case 1:
+          erased = m.erase(key);
+          ok = erased == expected.erase(key);
+          assert(ok);
+          break;
+        default: {
+          auto it = m.find(key);
+          auto jt = expected.find(key);
+          assert((it == m.end()) == (jt == expected.end()));
+          if (jt != expected.end()) { assert(it->second == jt->second); }
+          (void) it;
+        }
+      }
+      assert(m.size() == expected.size());
+    }
+
+    std::size_t n = 0;
+    for (const auto & v : m) {
+      assert(expected.at(v.first) == v.second);
+      (void) v;
+      ++n;
+    }
+    assert(n == expected.size());
+    assert(m.capacity() <= 8192);
+  }
+}
@@ -0,0 +1,154 @@
+#include <visit_struct/visit_struct_logger.hpp>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+enum class side : std::uint8_t { buy, sell };
+
+struct point {
+  int x;
+  int y;
+};
+
+VISITABLE_STRUCT(point, x, y);
+
+struct fill_event {
+  std::uint64_t id;
+  side s;
+  point where;
+  double price;
+  bool last;
+  std::uint8_t venue;
+};
+
+VISITABLE_STRUCT(fill_event, id, s, where, price, last, venue);
+
+struct book_update {
+  char venue[4];
+  char note[8];
+  std::int32_t sizes[3];
+  point corners[2];
+  side sides[2];
+};
+
+VISITABLE_STRUCT(book_update, venue, note, sizes, corners, sides);
+
+std::vector<std::string> lines(const std::string & text) {
+  std::vector<std::string> result;
+  std::istringstream in(text);
+  std::string line;
+  while (std::getline(in, line)) { result.push_back(line); }
+  return result;
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+  bool ok = true;
+  (void) ok;
+
+  // Formatting
+  {
+    std::ostringstream out;
+    {
+      visit_struct::binary_logger logger{out};
+      ok = logger.log(point{1, 2});
+      assert(ok);
+      ok = logger.log(fill_event{7, side::sell, point{-3, 4}, 2.5, true, 65});
+      assert(ok);
+      logger.flush();
+
+      const std::vector<std::string> l = lines(out.str());
+      assert(l.size() == 2);
+      assert(l[0] == "point { x: 1, y: 2 }");
+      assert(l[1] == "fill_event { id: 7, s: 1, where: point { x: -3, y: 4 }, price: 2.5, last: true, venue: 65 }");
+
+      ok = logger.log(point{5, 6});
+      assert(ok);
+    }
+    // Remaining records are formatted on destruction
+    assert(lines(out.str()).size() == 3);
+  }
+
+  // Array members, and char arrays without a null
+  {
+    std::ostringstream out;
+    {
+      visit_struct::binary_logger logger{out};
+      const book_update u{{'X', 'N', 'Y', 'S'}, "open", {100, -200, 300}, {point{1, 2}, point{3, 4}}, {side::buy, side::sell}};
+      ok = logger.log(u);
+      assert(ok);
+    }
+    assert(out.str() == "book_update { venue: \"XNYS\", note: \"open\", sizes: [100, -200, 300], "
+                        "corners: [point { x: 1, y: 2 }, point { x: 3, y: 4 }], sides: [0, 1] }\n");
+  }
+
+  // Full buffers drop records instead of blocking
+  {
+    std::ostringstream out;
+    visit_struct::logger_options options;
+    options.buffer_size = 256;
+    options.interval = std::chrono::milliseconds(60 * 1000);
+    visit_struct::binary_logger logger{out, options};
+
+    std::size_t logged = 0;
+    for (int i = 0; i < 100; ++i) {
+      if (logger.log(point{i, i})) { ++logged; }
+    }
+    assert(logged == 256 / 16 && logger.dropped() == 100 - logged);
+
+    // Space is reused after a drain, also across the end of the buffer
+    logger.flush();
+    for (int round = 0; round < 5; ++round) {
+      for (int i = 0; i < 5; ++i) {
+        ok = logger.log(fill_event{std::uint64_t(i), side::buy, point{0, 0}, 0.0, false, 0});
+        assert(ok);
+      }
+      logger.flush();
+    }
+    assert(lines(out.str()).size() == logged + 25);
+  }
+
+  // Many threads
+  {
+    std::ostringstream out;
+    const int threads = 4, per_thread = 5000;
+    {
+      visit_struct::logger_options options;
+      options.buffer_size = 1 << 20;
+      visit_struct::binary_logger logger{out, options};
+
+      std::vector<std::thread> workers;
+      for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&logger, t] {
+          for (int i = 0; i < per_thread; ++i) {
+            const bool logged = logger.log(point{t, i});
+            assert(logged);
+            (void) logged;
+          }
+        });
+      }
+      for (std::thread & w : workers) { w.join(); }
+    }
+
+    const std::vector<std::string> l = lines(out.str());
+    assert(l.size() == threads * per_thread);
+    std::set<std::string> unique(l.begin(), l.end());
+    assert(unique.size() == l.size());
+    assert(unique.count("point { x: 3, y: 4999 }"));
+  }
+}
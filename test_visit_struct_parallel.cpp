@@ -0,0 +1,192 @@
+#include <visit_struct/visit_struct_parallel.hpp>
+#include <visit_struct/visit_struct_intrusive.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct reading {
+  double value;
+  std::int32_t offset;
+  float scale;
+};
+
+VISITABLE_STRUCT(reading, value, offset, scale);
+
+// Doubles every member, counts visits per member name
+struct normalize {
+  std::atomic<std::size_t> * counts;
+
+  void operator()(const char * name, double & d) const { d *= 2; counts[!std::strcmp(name, "value") ? 0 : 3]++; }
+  void operator()(const char *, std::int32_t & i) const { i *= 2; counts[1]++; }
+  void operator()(const char *, float & f) const { f *= 2; counts[2]++; }
+};
+
+struct trade {
+  std::int64_t quantity;
+  double price;
+  std::string venue;
+  bool buy;
+  std::uint16_t latency;
+};
+
+VISITABLE_STRUCT(trade, quantity, price, venue, buy, latency);
+
+// No registered members
+struct marker {
+  BEGIN_VISITABLES(marker);
+  END_VISITABLES;
+};
+
+struct count_visits {
+  std::atomic<std::size_t> * visits;
+
+  template <typename T>
+  void operator()(const char *, T &) const { ++*visits; }
+};
+
+struct thrower {
+  template <typename T>
+  void operator()(const char *, T & t) const {
+    if (t == T(777)) { throw std::runtime_error("bad value"); }
+  }
+};
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  const std::size_t n = 100003;
+  const visit_struct::parallel_schedule schedules[] = { visit_struct::parallel_schedule::records,
+                                                        visit_struct::parallel_schedule::fields };
+
+  for (unsigned threads : {0u, 1u, 4u}) {
+    visit_struct::thread_pool pool{threads};
+    assert(pool.slots() == threads + 1);
+
+    for (visit_struct::parallel_schedule schedule : schedules) {
+      for (std::size_t grain : {std::size_t(0), std::size_t(1000), std::size_t(n + 5)}) {
+        std::vector<reading> data(n);
+        for (std::size_t i = 0; i < n; ++i) {
+          data[i] = reading{double(i), std::int32_t(i % 1000), float(i % 7)};
+        }
+
+        std::atomic<std::size_t> counts[4];
+        for (auto & c : counts) { c = 0; }
+
+        visit_struct::parallel_options options;
+        options.schedule = schedule;
+        options.grain = grain;
+        visit_struct::parallel_for_each_field(pool, data, normalize{counts}, options);
+
+        assert(counts[0] == n && counts[1] == n && counts[2] == n && counts[3] == 0);
+        for (std::size_t i = 0; i < n; ++i) {
+          assert(data[i].value == 2.0 * double(i));
+          assert(data[i].offset == 2 * std::int32_t(i % 1000));
+          assert(data[i].scale == 2.0f * float(i % 7));
+        }
+      }
+    }
+
+    // Exceptions propagate, and the pool stays usable
+    {
+      std::vector<reading> data(5000);
+      data[4321].offset = 777;
+      bool caught = false;
+      try {
+        visit_struct::parallel_for_each_field(pool, data, thrower{});
+      } catch (const std::runtime_error &) {
+        caught = true;
+      }
+      assert(caught);
+      (void) caught;
+
+      std::atomic<std::size_t> total{0};
+      pool.run(1000, [&total](std::size_t i) { total += i; });
+      assert(total == 999 * 1000 / 2);
+    }
+  }
+
+  // Default pool, arrays, empty ranges
+  {
+    reading data[3] = { {1.0, 1, 1.0f}, {2.0, 2, 2.0f}, {3.0, 3, 3.0f} };
+    std::atomic<std::size_t> counts[4];
+    for (auto & c : counts) { c = 0; }
+    visit_struct::parallel_for_each_field(data, normalize{counts});
+    assert(data[2].value == 6.0 && data[2].offset == 6 && data[2].scale == 6.0f);
+
+    std::vector<reading> empty;
+    visit_struct::parallel_for_each_field(empty, normalize{counts});
+    assert(counts[0] == 3);
+  }
+
+  // Reductions
+  for (unsigned threads : {0u, 3u}) {
+    visit_struct::thread_pool pool{threads};
+
+    const std::size_t count = 54321;
+    std::vector<trade> trades(count);
+    for (std::size_t i = 0; i < count; ++i) {
+      trades[i] = trade{std::int64_t(i) - 1000, 0.25 * double(i % 400), "X", i % 2 == 0, std::uint16_t(i % 100)};
+    }
+
+    visit_struct::field_summary<trade> r = visit_struct::parallel_reduce_fields(pool, trades);
+    assert(r.count == count);
+    assert(r.sum.quantity == std::int64_t(count) * std::int64_t(count - 1) / 2 - 1000 * std::int64_t(count));
+    assert(r.min.quantity == -1000 && r.max.quantity == std::int64_t(count) - 1001);
+    assert(r.min.price == 0.0 && r.max.price == 0.25 * 399);
+    assert(r.min.latency == 0 && r.max.latency == 99);
+    assert(r.sum.venue.empty() && !r.sum.buy);
+    assert(r.bins == 0 && r.counts.empty());
+
+    double price_sum = 0;
+    for (const trade & t : trades) { price_sum += t.price; }
+    assert(r.sum.price == price_sum);  // multiples of 0.25 are summed exactly
+
+    // Histograms
+    trade lower{0, 0.0, "", false, 0};
+    trade upper{1000, 100.0, "", false, 100};
+    r = visit_struct::parallel_reduce_fields(pool, trades, lower, upper, 10);
+    assert(r.count == count && r.bins == 10 && r.counts.size() == 5 * 10);
+    std::uint64_t total = 0;
+    for (std::size_t b = 0; b < 10; ++b) {
+      total += r.histogram(4)[b];
+      assert(r.histogram(4)[b] == (b < 2 ? 5440u : b == 2 ? 5431u : 5430u));  // 543 or 544 of each value
+      assert(r.histogram(2)[b] == 0 && r.histogram(3)[b] == 0);
+    }
+    assert(total == count);
+    assert(r.histogram(0)[0] == 1100);          // negative values, and [0, 100)
+    assert(r.histogram(0)[9] == count - 1900);  // from 900, and all above the upper bound
+  }
+
+  // Empty range
+  {
+    std::vector<trade> none;
+    visit_struct::field_summary<trade> r = visit_struct::parallel_reduce_fields(none);
+    assert(r.count == 0 && r.sum.quantity == 0 && r.max.price == 0.0);
+  }
+
+  // Structures without members
+  {
+    std::vector<marker> markers(1000);
+    std::atomic<std::size_t> visits{0};
+    for (visit_struct::parallel_schedule s : schedules) {
+      visit_struct::parallel_options options;
+      options.schedule = s;
+      visit_struct::parallel_for_each_field(markers, count_visits{&visits}, options);
+    }
+    assert(visits == 0);
+  }
+}
@@ -0,0 +1,85 @@
+#include <visit_struct/visit_struct_query.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct trade {
+  std::int32_t account;
+  double price;
+  std::string venue;
+  std::uint8_t side;
+};
+
+VISITABLE_STRUCT(trade, account, price, venue, side);
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  using visit_struct::member_index;
+  namespace query = visit_struct::query;
+
+  const std::size_t n = 5000;
+  std::vector<trade> reference;
+  visit_struct::soa_vector<trade> v;
+  for (std::size_t i = 0; i < n; ++i) {
+    const trade t{std::int32_t(i % 100) - 50, double(i) / 4, i % 3 ? "XNYS" : "BATS", std::uint8_t(i % 2)};
+    reference.push_back(t);
+    v.push_back(t);
+  }
+
+  // No predicates selects everything
+  query::selection s = query::select(v);
+  assert(s.size() == n && s[0] == 0 && s[n - 1] == n - 1);
+
+  // Single predicates, by index and by name
+  s = query::select(v, query::greater<member_index<trade>("price")>(1000.0));
+  assert(s.size() == n - 4001 && s[0] == 4001);
+
+  s = query::select(v, query::equal_to<3>(std::uint8_t(1)));
+  assert(s.size() == n / 2 && s[1] == 3);
+
+  assert(query::count(v, query::less<0>(-40)) == 10 * (n / 100));
+  assert(query::count(v, query::less_equal<0>(-40)) == 11 * (n / 100));
+  assert(query::count(v, query::greater_equal<0>(40)) == 10 * (n / 100));
+  assert(query::count(v, query::not_equal_to<3>(std::uint8_t(0))) == n / 2);
+
+  // Conjunctions, checked against a scalar filter
+  s = query::select(v,
+                    query::between<0>(-10, 10),
+                    query::less<1>(900.0),
+                    query::equal_to<2>(std::string("BATS")),
+                    query::where<3>([](std::uint8_t side) { return side == 0; }));
+  query::selection expected;
+  for (std::size_t i = 0; i < n; ++i) {
+    const trade & t = reference[i];
+    if (t.account >= -10 && t.account <= 10 && t.price < 900.0 && t.venue == "BATS" && t.side == 0) { expected.push_back(i); }
+  }
+  assert(!expected.empty() && s == expected);
+
+  // Projections
+  const std::vector<double> prices = query::gather<1>(v, s);
+  assert(prices.size() == s.size());
+  for (std::size_t k = 0; k < s.size(); ++k) { assert(prices[k] == reference[s[k]].price); }
+
+  const visit_struct::soa_vector<trade> t = query::take(v, s);
+  assert(t.size() == s.size());
+  for (std::size_t k = 0; k < s.size(); ++k) {
+    assert(t[k].account == reference[s[k]].account && t[k].venue == "BATS");
+  }
+
+  // Empty input
+  visit_struct::soa_vector<trade> empty;
+  assert(query::select(empty, query::less<1>(1.0)).empty());
+  assert(query::take(empty, query::selection{}).empty());
+}
@@ -0,0 +1,209 @@
+#include <visit_struct/visit_struct_recursive.hpp>
+#include <visit_struct/visit_struct_intrusive.hpp>
+
+#include <cassert>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct price_level {
+  double price;
+  int quantity;
+};
+
+VISITABLE_STRUCT(price_level, price, quantity);
+
+struct order {
+  long id;
+  price_level level;
+  std::string symbol;
+};
+
+VISITABLE_STRUCT(order, id, level, symbol);
+
+struct fill {
+  order original;
+  price_level executed;
+  bool final_fill;
+};
+
+VISITABLE_STRUCT(fill, original, executed, final_fill);
+
+struct intrusive_outer {
+  BEGIN_VISITABLES(intrusive_outer);
+  VISITABLE(int, a);
+  VISITABLE(price_level, b);
+  END_VISITABLES;
+};
+
+/***
+ * Flattened indexing
+ */
+
+static_assert(visit_struct::flat_field_count<price_level>() == 2, "");
+static_assert(visit_struct::flat_field_count<order>() == 4, "");
+static_assert(visit_struct::flat_field_count<fill>() == 7, "");
+
+static_assert(std::is_same<visit_struct::flat_type_at<0, fill>, long>::value, "");
+static_assert(std::is_same<visit_struct::flat_type_at<1, fill>, double>::value, "");
+static_assert(std::is_same<visit_struct::flat_type_at<2, fill>, int>::value, "");
+static_assert(std::is_same<visit_struct::flat_type_at<3, fill>, std::string>::value, "");
+static_assert(std::is_same<visit_struct::flat_type_at<6, fill>, bool>::value, "");
+
+static_assert(std::is_same<decltype(visit_struct::get_flat<1>(std::declval<fill &>())), double &>::value, "");
+static_assert(std::is_same<decltype(visit_struct::get_flat<1>(std::declval<const fill &>())), const double &>::value, "");
+static_assert(std::is_same<decltype(visit_struct::get_flat<3>(std::declval<fill>())), std::string &&>::value, "");
+
+static_assert(std::is_same<decltype(visit_struct::get_flat_name<2, fill>()), const char (&)[24]>::value, "");
+static_assert(visit_struct::get_flat_name<2, fill>()[14] == '.', "");
+
+// Split records into one column per leaf, like a columnar container would
+
+template <typename S, typename Seq = visit_struct::detail::make_integer_sequence<std::size_t, visit_struct::flat_field_count<S>()>>
+struct columns;
+
+template <typename S, std::size_t... Is>
+struct columns<S, visit_struct::detail::integer_sequence<std::size_t, Is...>> {
+  std::tuple<std::vector<visit_struct::flat_type_at<Is, S>>...> data;
+
+  void push_back(const S & s) {
+    (void) visit_struct::detail::swallow{ 0, (std::get<Is>(data).push_back(visit_struct::get_flat<Is>(s)), 0)... };
+  }
+};
+
+/***
+ * Test visitors
+ */
+
+struct path_collector {
+  std::vector<std::pair<std::string, std::string>> result;
+
+  void operator()(const char * path, const std::string & s) {
+    result.emplace_back(path, s);
+  }
+
+  void operator()(const char * path, bool b) {
+    result.emplace_back(path, b ? "true" : "false");
+  }
+
+  template <typename T>
+  void operator()(const char * path, const T & t) {
+    result.emplace_back(path, std::to_string(t));
+  }
+};
+
+struct doubler {
+  template <typename T>
+  void operator()(const char *, T & t) {
+    t = t + t;
+  }
+};
+
+struct pointer_collector {
+  std::vector<const char *> paths;
+
+  template <typename T>
+  void operator()(const char * path, const T &) {
+    paths.push_back(path);
+  }
+};
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  // Paths and values of nested leaves
+  {
+    fill f{order{7, price_level{1.5, 100}, "XYZ"}, price_level{1.25, 40}, true};
+
+    path_collector vis;
+    visit_struct::for_each_recursive(f, vis);
+
+    assert(vis.result.size() == 7);
+    assert(vis.result[0].first == "original.id");
+    assert(vis.result[0].second == "7");
+    assert(vis.result[1].first == "original.level.price");
+    assert(vis.result[1].second == "1.500000");
+    assert(vis.result[2].first == "original.level.quantity");
+    assert(vis.result[2].second == "100");
+    assert(vis.result[3].first == "original.symbol");
+    assert(vis.result[3].second == "XYZ");
+    assert(vis.result[4].first == "executed.price");
+    assert(vis.result[5].first == "executed.quantity");
+    assert(vis.result[5].second == "40");
+    assert(vis.result[6].first == "final_fill");
+    assert(vis.result[6].second == "true");
+  }
+
+  // Paths have static storage, the same pointer is passed every time
+  {
+    order o{1, price_level{2, 3}, "A"};
+
+    pointer_collector v1, v2;
+    visit_struct::for_each_recursive(o, v1);
+    visit_struct::for_each_recursive(o, v2);
+    assert(v1.paths == v2.paths);
+    assert(std::strcmp(v1.paths[1], "level.price") == 0);
+  }
+
+  // Mutation through the recursive visitor
+  {
+    order o{1, price_level{2, 3}, "ab"};
+    visit_struct::for_each_recursive(o, doubler{});
+    assert(o.id == 2);
+    assert(o.level.price == 4);
+    assert(o.level.quantity == 6);
+    assert(o.symbol == "abab");
+  }
+
+  // Intrusive syntax
+  {
+    path_collector vis;
+    intrusive_outer x;
+    x.a = 5;
+    x.b = price_level{0.5, 9};
+    visit_struct::for_each_recursive(x, vis);
+    assert(vis.result.size() == 3);
+    assert(vis.result[0].first == "a");
+    assert(vis.result[1].first == "b.price");
+    assert(vis.result[2].first == "b.quantity");
+  }
+
+  // Flattened access
+  {
+    fill f{order{7, price_level{1.5, 100}, "XYZ"}, price_level{1.25, 40}, true};
+
+    assert(visit_struct::get_flat<0>(f) == 7);
+    assert(visit_struct::get_flat<2>(f) == 100);
+    assert(visit_struct::get_flat<4>(f) == 1.25);
+
+    visit_struct::get_flat<5>(f) = 41;
+    assert(f.executed.quantity == 41);
+
+    assert(std::string(visit_struct::get_flat_name<0, fill>()) == "original.id");
+    assert(std::string(visit_struct::get_flat_name<2>(f)) == "original.level.quantity");
+    assert(std::string(visit_struct::get_flat_name<6, fill>()) == "final_fill");
+
+    // Flat names agree with the recursive traversal
+    pointer_collector vis;
+    visit_struct::for_each_recursive(f, vis);
+    assert(vis.paths.size() == visit_struct::flat_field_count(f));
+    assert((vis.paths[4] == visit_struct::get_flat_name<4, fill>()));
+
+    columns<fill> cols;
+    cols.push_back(f);
+    f.original.level.price = 2.5;
+    cols.push_back(f);
+    assert(std::get<1>(cols.data).size() == 2);
+    assert(std::get<1>(cols.data)[0] == 1.5);
+    assert(std::get<1>(cols.data)[1] == 2.5);
+    assert(std::get<3>(cols.data)[1] == "XYZ");
+  }
+}
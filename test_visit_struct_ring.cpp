@@ -0,0 +1,121 @@
+#include <visit_struct/visit_struct_ring.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct order {
+  std::uint8_t side;
+  std::uint64_t id;
+  double price;
+  std::uint16_t producer;
+};
+
+VISITABLE_STRUCT(order, side, id, price, producer);
+
+/***
+ * tests
+ */
+
+static_assert(visit_struct::record_view<order>::size == 1 + 8 + 8 + 2, "");
+static_assert(visit_struct::detail::packed_offset<order, 2>::value == 9, "");
+static_assert(visit_struct::detail::packed_offset<order, 3>::value == 17, "");
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+  bool ok = true;
+  (void) ok;
+
+  // Single thread
+  {
+    visit_struct::record_ring<order> ring{3};
+    assert(ring.capacity() == 4);
+
+    order o;
+    ok = ring.try_pop(o);
+    assert(!ok);
+
+    ok = ring.try_push(order{1, 42, 99.5, 7});
+    assert(ok);
+    ok = ring.try_emplace([](visit_struct::record_writer<order> & w) {
+      w.set<0>(2);
+      w.set<1>(43);
+      w.set<2>(100.25);
+      w.set<3>(8);
+    });
+    assert(ok);
+    ok = ring.try_push(order{3, 44, 0.5, 9});
+    assert(ok);
+    ok = ring.try_push(order{4, 45, 1.5, 10});
+    assert(ok);
+    ok = ring.try_push(order{5, 46, 2.5, 11});
+    assert(!ok);
+
+    ok = ring.try_pop(o);
+    assert(ok);
+    assert(o.side == 1 && o.id == 42 && o.price == 99.5 && o.producer == 7);
+
+    // Lazy decoding of single members
+    ok = ring.try_consume([](const visit_struct::record_view<order> & r) {
+      assert(r.get<1>() == 43 && r.get<2>() == 100.25);
+      assert(r.decode().producer == 8);
+      (void) r;
+    });
+    assert(ok);
+
+    // Wrap around
+    ok = ring.try_push(order{5, 46, 2.5, 11});
+    assert(ok);
+    for (std::uint64_t id = 44; id <= 46; ++id) {
+      ok = ring.try_pop(o);
+      assert(ok && o.id == id);
+    }
+    ok = ring.try_pop(o);
+    assert(!ok);
+  }
+
+  // Many producers, one consumer
+  {
+    visit_struct::record_ring<order> ring{64};
+    const int producers = 4;
+    const std::uint64_t per_producer = 50000;
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p) {
+      threads.emplace_back([&ring, p, per_producer] {
+        for (std::uint64_t i = 0; i < per_producer; ++i) {
+          while (!ring.try_emplace([&](visit_struct::record_writer<order> & w) {
+            w.assign(order{std::uint8_t(i % 2), i, double(i) * 0.5, std::uint16_t(p)});
+          })) {
+            std::this_thread::yield();
+          }
+        }
+      });
+    }
+
+    std::vector<std::uint64_t> next(producers, 0);
+    std::uint64_t received = 0;
+    while (received < producers * per_producer) {
+      order o;
+      if (!ring.try_pop(o)) {
+        std::this_thread::yield();
+        continue;
+      }
+      assert(o.producer < producers);
+      assert(o.id == next[o.producer]);
+      assert(o.side == o.id % 2 && o.price == double(o.id) * 0.5);
+      ++next[o.producer];
+      ++received;
+    }
+    for (std::thread & t : threads) { t.join(); }
+    order o;
+    ok = ring.try_pop(o);
+    assert(!ok);
+  }
+}
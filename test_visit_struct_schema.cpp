@@ -0,0 +1,197 @@
+#include <visit_struct/visit_struct_schema.hpp>
+#include <visit_struct/visit_struct_intrusive.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures: several variations of the same record
+ */
+
+enum class side : std::uint8_t { buy, sell };
+
+namespace v1 {
+
+struct order {
+  std::uint64_t id;
+  double price;
+  std::int32_t quantity;
+};
+
+struct fill {
+  order o;
+  std::vector<double> prices;
+};
+
+} // end namespace v1
+
+namespace v2 {
+
+// Member added
+struct order {
+  std::uint64_t id;
+  double price;
+  std::int32_t quantity;
+  side s;
+};
+
+// Nested change only
+struct fill {
+  order o;
+  std::vector<double> prices;
+};
+
+} // end namespace v2
+
+namespace reordered {
+
+struct order {
+  double price;
+  std::uint64_t id;
+  std::int32_t quantity;
+};
+
+} // end namespace reordered
+
+namespace renamed {
+
+struct order {
+  std::uint64_t id;
+  double px;
+  std::int32_t quantity;
+};
+
+} // end namespace renamed
+
+namespace widened {
+
+struct order {
+  std::uint64_t id;
+  double price;
+  std::int64_t quantity;
+};
+
+} // end namespace widened
+
+VISITABLE_STRUCT(v1::order, id, price, quantity);
+VISITABLE_STRUCT(v1::fill, o, prices);
+VISITABLE_STRUCT(v2::order, id, price, quantity, s);
+VISITABLE_STRUCT(v2::fill, o, prices);
+VISITABLE_STRUCT(reordered::order, price, id, quantity);
+VISITABLE_STRUCT(renamed::order, id, px, quantity);
+VISITABLE_STRUCT(widened::order, id, price, quantity);
+
+// Containers
+struct book {
+  std::string symbol;
+  std::array<double, 4> bids;
+  float asks[4];
+  std::vector<v1::order> orders;
+};
+
+VISITABLE_STRUCT(book, symbol, bids, asks, orders);
+
+// A user type with a custom hash
+struct price_t {
+  std::int64_t ticks;
+};
+
+namespace visit_struct {
+
+template <>
+struct type_hash<price_t> {
+  static constexpr schema_hash_type value() { return detail::tagged_hash("price", 1); }
+};
+
+} // end namespace visit_struct
+
+struct quote {
+  price_t bid;
+  price_t ask;
+};
+
+VISITABLE_STRUCT(quote, bid, ask);
+
+// Intrusive syntax
+struct intrusive_order {
+  BEGIN_VISITABLES(intrusive_order);
+  VISITABLE(std::uint64_t, id);
+  VISITABLE(double, price);
+  END_VISITABLES;
+};
+
+/***
+ * tests
+ */
+
+using visit_struct::schema_hash;
+
+// Usable in constant expressions
+template <visit_struct::schema_hash_type H>
+struct stamp {
+  static constexpr visit_struct::schema_hash_type value = H;
+};
+
+static_assert(stamp<schema_hash<v1::order>()>::value == schema_hash<v1::order>(), "");
+static_assert(schema_hash<v1::order>() == schema_hash<const v1::order &>(), "");
+
+// Any change to the member list changes the hash
+static_assert(schema_hash<v1::order>() != schema_hash<v2::order>(), "");
+static_assert(schema_hash<v1::order>() != schema_hash<reordered::order>(), "");
+static_assert(schema_hash<v1::order>() != schema_hash<renamed::order>(), "");
+static_assert(schema_hash<v1::order>() != schema_hash<widened::order>(), "");
+
+// Nested changes propagate
+static_assert(schema_hash<v1::fill>() != schema_hash<v2::fill>(), "");
+
+// Member types
+static_assert(visit_struct::type_hash<std::int32_t>::value() != visit_struct::type_hash<std::uint32_t>::value(), "");
+static_assert(visit_struct::type_hash<std::int32_t>::value() != visit_struct::type_hash<float>::value(), "");
+static_assert(visit_struct::type_hash<char>::value() != visit_struct::type_hash<signed char>::value(), "");
+static_assert(visit_struct::type_hash<side>::value() != visit_struct::type_hash<std::uint8_t>::value(), "");
+static_assert(visit_struct::type_hash<std::array<int, 3>>::value() == visit_struct::type_hash<int[3]>::value(), "");
+static_assert(visit_struct::type_hash<int[3]>::value() != visit_struct::type_hash<int[4]>::value(), "");
+static_assert(visit_struct::type_hash<std::string>::value() != visit_struct::type_hash<std::vector<char>>::value(), "");
+static_assert(visit_struct::type_hash<v1::order>::value() == schema_hash<v1::order>(), "");
+
+static_assert(schema_hash<book>() != 0, "");
+static_assert(schema_hash<quote>() != 0, "");
+static_assert(schema_hash<intrusive_order>() != 0, "");
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  // Same value at run time, through the instance overload
+  {
+    v1::order o{1, 2.5, 3};
+    assert(schema_hash(o) == schema_hash<v1::order>());
+    const visit_struct::schema_hash_type h = schema_hash<v2::fill>();
+    assert(h == schema_hash(v2::fill{}));
+    (void) o;
+    (void) h;
+  }
+
+  // Stamping a header and checking it on read
+  {
+    std::string file;
+    const visit_struct::schema_hash_type written = schema_hash<v1::order>();
+    file.append(reinterpret_cast<const char *>(&written), sizeof(written));
+
+    visit_struct::schema_hash_type read;
+    std::memcpy(&read, file.data(), sizeof(read));
+    assert(read == schema_hash<v1::order>());
+    assert(read != schema_hash<v2::order>());
+  }
+
+  // The run time hash of a byte range agrees with the compile time one
+  {
+    namespace detail = visit_struct::detail;
+    assert(detail::fnv1a_bytes("XNYS", 4) == detail::fnv1a("XNYS", detail::fnv_offset_basis));
+    assert(detail::fnv1a_bytes("", 0) == detail::fnv_offset_basis);
+  }
+}
@@ -0,0 +1,101 @@
+#include <visit_struct/visit_struct_seqlock.hpp>
+
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+// Every snapshot must satisfy: bid < ask, levels[i] == version + i, checksum == sum of the rest
+struct quote_state {
+  std::uint64_t version;
+  double bid;
+  double ask;
+  std::int32_t levels[8];
+  char venue[5];
+  std::uint64_t checksum;
+};
+
+VISITABLE_STRUCT(quote_state, version, bid, ask, levels, venue, checksum);
+
+quote_state make_state(std::uint64_t v) {
+  quote_state q;
+  q.version = v;
+  q.bid = static_cast<double>(v);
+  q.ask = static_cast<double>(v) + 0.5;
+  for (int i = 0; i < 8; ++i) { q.levels[i] = static_cast<std::int32_t>(v + i); }
+  for (int i = 0; i < 4; ++i) { q.venue[i] = static_cast<char>('a' + (v + i) % 26); }
+  q.venue[4] = '\0';
+  q.checksum = v * 3 + 7;
+  return q;
+}
+
+bool consistent(const quote_state & q) {
+  if (!(q.bid < q.ask) || q.bid != static_cast<double>(q.version)) { return false; }
+  for (int i = 0; i < 8; ++i) {
+    if (q.levels[i] != static_cast<std::int32_t>(q.version + i)) { return false; }
+  }
+  for (int i = 0; i < 4; ++i) {
+    if (q.venue[i] != static_cast<char>('a' + (q.version + i) % 26)) { return false; }
+  }
+  return q.checksum == q.version * 3 + 7;
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  // Single thread
+  {
+    visit_struct::seqlock<quote_state> lock{make_state(1)};
+    assert(lock.version() == 0);
+    assert(consistent(lock.load()));
+    assert(lock.load().version == 1);
+
+    lock.store(make_state(42));
+    assert(lock.version() == 1);
+    quote_state q;
+    const bool ok = lock.try_load(q);
+    assert(ok && q.version == 42 && consistent(q));
+    (void) ok;
+  }
+
+  // One writer, several readers
+  {
+    const std::uint64_t stores = 200000;
+    visit_struct::seqlock<quote_state> lock{make_state(0)};
+    std::atomic<bool> done{false};
+    std::atomic<int> failures{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+      readers.emplace_back([&] {
+        std::uint64_t last = 0;
+        while (!done.load(std::memory_order_acquire)) {
+          const quote_state q = lock.load();
+          // Snapshots are consistent, and versions never go backwards
+          if (!consistent(q) || q.version < last) { ++failures; }
+          last = q.version;
+        }
+      });
+    }
+
+    for (std::uint64_t v = 1; v <= stores; ++v) {
+      lock.store(make_state(v));
+    }
+    done.store(true, std::memory_order_release);
+    for (std::thread & t : readers) { t.join(); }
+
+    assert(failures.load() == 0);
+    assert(lock.load().version == stores);
+    assert(lock.version() == stores);
+  }
+}
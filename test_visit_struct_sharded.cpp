@@ -0,0 +1,98 @@
+#include <visit_struct/visit_struct_sharded.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct latency_stats {
+  std::uint64_t count;
+  double total;
+  std::int32_t worst;
+  std::int32_t best;
+};
+
+VISITABLE_STRUCT(latency_stats, count, total, worst, best);
+VISITABLE_COMBINE(latency_stats, sum, sum, max, min);
+
+struct counters {
+  std::uint64_t hits;
+  std::int64_t balance;
+};
+
+VISITABLE_STRUCT(counters, hits, balance);
+
+/***
+ * tests
+ */
+
+static_assert(visit_struct::detail::policy_at<visit_struct::detail::policies<latency_stats>::type, 2>::value
+              == visit_struct::combine::max, "");
+static_assert(visit_struct::detail::policy_at<visit_struct::detail::policies<counters>::type, 1>::value
+              == visit_struct::combine::sum, "");
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  // Single thread, empty and reset
+  {
+    visit_struct::sharded<latency_stats> s{4};
+    assert(s.shard_count() == 4);
+
+    latency_stats l = s.load();
+    assert(l.count == 0 && l.total == 0);
+    assert(l.worst == std::numeric_limits<std::int32_t>::lowest());
+    assert(l.best == std::numeric_limits<std::int32_t>::max());
+
+    s.update(latency_stats{1, 2.5, 7, 7});
+    s.update(latency_stats{1, 0.5, 3, 3});
+    s.update<2>(11);
+    s.update<3>(-4);
+    l = s.load();
+    assert(l.count == 2 && l.total == 3.0 && l.worst == 11 && l.best == -4);
+
+    s.reset();
+    l = s.load();
+    assert(l.count == 0 && l.best == std::numeric_limits<std::int32_t>::max());
+  }
+
+  // Default policy is sum
+  {
+    visit_struct::sharded<counters> s{1};
+    s.update(counters{3, -5});
+    s.update(counters{4, 2});
+    const counters c = s.load();
+    assert(c.hits == 7 && c.balance == -3);
+    (void) c;
+  }
+
+  // Concurrent updates, with fewer and with more shards than threads
+  for (std::size_t shards : {std::size_t(3), std::size_t(16)}) {
+    visit_struct::sharded<latency_stats> s{shards};
+
+    const int threads = 8, iterations = 20000;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+      workers.emplace_back([&s, t] {
+        for (int i = 0; i < iterations; ++i) {
+          const std::int32_t v = t * iterations + i;
+          s.update(latency_stats{1, 0.5, v, v});
+        }
+      });
+    }
+    for (std::thread & w : workers) { w.join(); }
+
+    const latency_stats l = s.load();
+    assert(l.count == static_cast<std::uint64_t>(threads) * iterations);
+    assert(l.total == 0.5 * threads * iterations);
+    assert(l.worst == threads * iterations - 1);
+    assert(l.best == 0);
+    (void) l;
+  }
+}
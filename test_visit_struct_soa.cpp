@@ -0,0 +1,154 @@
+#include <visit_struct/visit_struct_soa.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct trade {
+  std::int32_t account;
+  double price;
+  std::string venue;
+  std::uint64_t sequence;
+  std::int8_t flags;
+};
+
+VISITABLE_STRUCT(trade, account, price, venue, sequence, flags);
+
+// A member without operator<
+struct position {
+  double x;
+  double y;
+};
+
+struct marker {
+  std::uint32_t id;
+  position at;
+};
+
+VISITABLE_STRUCT(marker, id, at);
+
+bool same(const trade & a, const trade & b) {
+  return a.account == b.account && a.price == b.price && a.venue == b.venue && a.sequence == b.sequence && a.flags == b.flags;
+}
+
+/***
+ * tests
+ */
+
+static_assert(visit_struct::member_index<trade>("account") == 0, "");
+static_assert(visit_struct::member_index<trade>("sequence") == 3, "");
+static_assert(visit_struct::member_index<trade>("flags") == 4, "");
+static_assert(visit_struct::member_index<trade>("flag") == -1, "");
+static_assert(visit_struct::member_index<trade>("flagsx") == -1, "");
+
+template <int idx>
+void check_sorted(const visit_struct::soa_vector<trade> & v, const std::vector<trade> & reference) {
+  std::vector<trade> expected = reference;
+  std::stable_sort(expected.begin(), expected.end(), [](const trade & a, const trade & b) {
+    return visit_struct::get<idx>(a) < visit_struct::get<idx>(b);
+  });
+  assert(v.size() == expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) { assert(same(v[i], expected[i])); }
+  (void) v;
+}
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+  bool ok = true;
+  (void) ok;
+
+  std::mt19937_64 rng(7);
+  const std::string venues[] = { "XNYS", "XNAS", "BATS" };
+
+  for (std::size_t n : {std::size_t(0), std::size_t(1), std::size_t(1000), std::size_t(200000)}) {
+    std::vector<trade> reference;
+    for (std::size_t i = 0; i < n; ++i) {
+      reference.push_back(trade{static_cast<std::int32_t>(rng() % 2000) - 1000,
+                                double(rng() % 10000) / 4,
+                                venues[rng() % 3],
+                                rng() >> (rng() % 64),
+                                static_cast<std::int8_t>(rng())});
+    }
+
+    visit_struct::soa_vector<trade> v;
+    v.reserve(n);
+    for (const trade & t : reference) { v.push_back(t); }
+    assert(v.size() == n && v.column<2>().size() == n);
+
+    for (unsigned threads : {0u, 3u}) {
+      visit_struct::thread_pool pool{threads};
+
+      // Radix sorts, signed and unsigned, on a copy each time
+      visit_struct::soa_vector<trade> a = v;
+      a.sort_by<0>(pool);
+      check_sorted<0>(a, reference);
+
+      a = v;
+      a.sort_by<visit_struct::member_index<trade>("sequence")>(pool);
+      check_sorted<3>(a, reference);
+
+      a = v;
+      a.sort_by<4>(pool);
+      check_sorted<4>(a, reference);
+
+      // Comparison sorts
+      a = v;
+      ok = a.sort_by("price", pool);
+      assert(ok);
+      check_sorted<1>(a, reference);
+
+      a = v;
+      a.sort_by<2>();
+      check_sorted<2>(a, reference);
+
+      ok = a.sort_by("missing", pool);
+      assert(!ok);
+    }
+
+    // Custom order
+    visit_struct::soa_vector<trade> a = v;
+    a.sort_by<0>([](std::int32_t x, std::int32_t y) { return x > y; });
+    for (std::size_t i = 1; i < n; ++i) { assert(a.column<0>()[i - 1] >= a.column<0>()[i]); }
+
+    // Stable partition
+    a = v;
+    const std::size_t selected = a.partition_by<2>([](const std::string & s) { return s == "BATS"; });
+    std::vector<trade> expected;
+    std::copy_if(reference.begin(), reference.end(), std::back_inserter(expected), [](const trade & t) { return t.venue == "BATS"; });
+    assert(selected == expected.size());
+    (void) selected;
+    std::copy_if(reference.begin(), reference.end(), std::back_inserter(expected), [](const trade & t) { return t.venue != "BATS"; });
+    for (std::size_t i = 0; i < n; ++i) { assert(same(a[i], expected[i])); }
+  }
+
+  // Element access
+  {
+    visit_struct::soa_vector<trade> v;
+    v.resize(2);
+    v.set(1, trade{1, 2.0, "X", 3, 4});
+    assert(v.get(1).venue == "X" && v.column<3>()[1] == 3 && v[0].sequence == 0);
+    v.clear();
+    assert(v.empty());
+  }
+
+  // Members without operator< can't be sorted by name
+  {
+    visit_struct::soa_vector<marker> v;
+    v.push_back(marker{2, position{0, 0}});
+    v.push_back(marker{1, position{1, 1}});
+    ok = v.sort_by("at");
+    assert(!ok);
+    assert(v.column<0>()[0] == 2);
+    ok = v.sort_by("id");
+    assert(ok);
+    assert(v.column<0>()[0] == 1 && v.column<1>()[0].x == 1);
+  }
+}
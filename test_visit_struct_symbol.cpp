@@ -0,0 +1,182 @@
+#include <visit_struct/visit_struct_symbol.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+// The same record, with plain strings and with symbols
+struct trade_text {
+  std::uint64_t id;
+  std::string venue;
+  std::string instrument;
+  double price;
+};
+
+VISITABLE_STRUCT(trade_text, id, venue, instrument, price);
+
+struct trade {
+  std::uint64_t id;
+  visit_struct::symbol venue;
+  visit_struct::symbol instrument;
+  double price;
+};
+
+VISITABLE_STRUCT(trade, id, venue, instrument, price);
+
+struct book_key {
+  visit_struct::symbol venue;
+  visit_struct::symbol instrument;
+};
+
+VISITABLE_STRUCT(book_key, venue, instrument);
+
+const char * const venues[] = {"XNYS", "XNAS", "BATS", "ARCX", "a venue with a longer name than the others"};
+
+trade_text make_trade(std::uint64_t i) {
+  return trade_text{i, venues[i % 5], "INSTRUMENT-" + std::to_string(i % 37), 100.0 + i};
+}
+
+bool same(const trade & a, const trade_text & b) {
+  return a.id == b.id && a.venue.str() == b.venue && a.instrument.str() == b.instrument && a.price == b.price;
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  bool ok = true;
+  (void) ok;
+
+  // Table basics
+  {
+    visit_struct::symbol_table t;
+    assert(t.size() == 1);
+
+    visit_struct::symbol a = t.intern("XNYS");
+    visit_struct::symbol b = t.intern(std::string("XNAS"));
+    visit_struct::symbol c = t.intern("XNYS");
+    assert(a == c && a != b);
+    assert(a.id() == 1 && b.id() == 2 && c.id() == 1);
+    assert(a.str() == "XNYS" && a.size() == 4 && std::strlen(a.c_str()) == 4);
+    assert(t.size() == 3);
+    assert(t[2] == b && t[2].str() == "XNAS");
+
+    visit_struct::symbol e = t.intern("");
+    assert(e.empty() && e.id() == 0 && e == visit_struct::symbol{} && t[0] == e);
+    assert(std::string(e.c_str()).empty());
+    (void) a;
+    (void) b;
+    (void) c;
+    (void) e;
+
+    assert(t.find("XNAS") == b);
+    assert(t.find("BATS").empty() && t.size() == 3);
+
+    // Equal contents from different tables compare equal
+    visit_struct::symbol_table u;
+    const visit_struct::symbol other = u.intern("XNAS");
+    assert(other == b && other.id() == 1);
+    assert(std::hash<visit_struct::symbol>{}(other) == std::hash<visit_struct::symbol>{}(b));
+    (void) other;
+
+    // Many distinct strings keep their contents and ids
+    for (int i = 0; i < 10000; ++i) { t.intern("s" + std::to_string(i)); }
+    for (int i = 0; i < 10000; ++i) {
+      visit_struct::symbol s = t.find("s" + std::to_string(i));
+      assert(s.str() == "s" + std::to_string(i) && s.id() == std::uint32_t(i + 3) && t[s.id()] == s);
+      (void) s;
+    }
+  }
+
+  // Bulk load: streams written from strings are read into symbols
+  {
+    std::string stream;
+    const std::size_t n = 20000;
+    for (std::uint64_t i = 0; i < n; ++i) { visit_struct::binary::serialize(make_trade(i), stream); }
+
+    visit_struct::symbol_table symbols;
+    visit_struct::binary::source in{stream.data(), stream.size(), nullptr, &symbols};
+    std::vector<trade> trades(n);
+    for (trade & t : trades) {
+      ok = visit_struct::binary::deserialize(in, t);
+      assert(ok);
+    }
+    assert(!in.remaining());
+
+    // 5 venues, 37 instruments, and the empty string
+    assert(symbols.size() == 1 + 5 + 37);
+    for (std::uint64_t i = 0; i < n; ++i) { assert(same(trades[i], make_trade(i))); }
+    assert(trades[0].venue == trades[5].venue && trades[0].venue.data() == trades[5].venue.data());
+    assert(trades[0].instrument.id() == trades[37].instrument.id());
+
+    // Symbols write the same bytes as the strings
+    std::string again;
+    for (const trade & t : trades) { visit_struct::binary::serialize(t, again); }
+    assert(again == stream);
+
+    // Usable in generated hashes and flat_map keys
+    visit_struct::flat_map<book_key, double> last_price;
+    for (const trade & t : trades) { last_price[book_key{t.venue, t.instrument}] = t.price; }
+    assert(last_price.size() == 5 * 37);
+    const book_key key{symbols.find("XNYS"), symbols.find("INSTRUMENT-0")};
+    const auto it = last_price.find(key);
+    assert(it != last_price.end() && it->second == 100.0 + (n - 1) / 185 * 185);
+    (void) it;
+  }
+
+  // A symbol table is required to read symbols
+  {
+    std::string buffer;
+    visit_struct::binary::serialize(make_trade(1), buffer);
+    trade t;
+    ok = visit_struct::binary::deserialize(buffer, t);
+    assert(!ok);
+
+    visit_struct::symbol_table symbols;
+    ok = visit_struct::binary::deserialize(buffer, t, symbols);
+    assert(ok);
+    assert(same(t, make_trade(1)));
+
+    // Truncated input
+    ok = visit_struct::binary::deserialize(buffer.substr(0, 12), t, symbols);
+    assert(!ok);
+  }
+
+  // Compact and big endian encodings
+  {
+    visit_struct::symbol_table symbols;
+    const trade_text original = make_trade(4);
+
+    std::string buffer;
+    visit_struct::binary::compact::serialize(original, buffer);
+    trade t;
+    visit_struct::binary::source in{buffer.data(), buffer.size(), nullptr, &symbols};
+    ok = visit_struct::binary::compact::deserialize(in, t);
+    assert(ok && !in.remaining());
+    assert(same(t, original));
+    std::string again;
+    visit_struct::binary::compact::serialize(t, again);
+    assert(again == buffer);
+
+    buffer.clear();
+    visit_struct::binary::big_endian::serialize(original, buffer);
+    trade u;
+    visit_struct::binary::source in2{buffer.data(), buffer.size(), nullptr, &symbols};
+    ok = visit_struct::binary::big_endian::deserialize(in2, u);
+    assert(ok && !in2.remaining());
+    assert(same(u, original) && u.venue == t.venue);
+    again.clear();
+    visit_struct::binary::big_endian::serialize(u, again);
+    assert(again == buffer);
+  }
+}
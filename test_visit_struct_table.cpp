@@ -0,0 +1,137 @@
+#include <visit_struct/visit_struct_table.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct order {
+  std::uint64_t id;
+  double price;
+  std::string account;
+  int quantity;
+};
+
+VISITABLE_STRUCT(order, id, price, account, quantity);
+
+bool same(const order & a, const order & b) {
+  return a.id == b.id && a.price == b.price && a.account == b.account && a.quantity == b.quantity;
+}
+
+typedef visit_struct::table<order,
+                            visit_struct::unique_index<0>,
+                            visit_struct::hash_index<visit_struct::member_index<order>("account")>,
+                            visit_struct::hash_index<3>> order_table;
+
+// Every index agrees with a linear scan
+void check(const order_table & t) {
+  for (std::size_t row = 0; row < t.size(); ++row) {
+    const order & o = t[row];
+    assert(t.find_row<0>(o.id) == row);
+
+    std::vector<std::size_t> rows = t.find_all<2>(o.account);
+    std::size_t expected = 0;
+    for (const order & other : t) { expected += other.account == o.account; }
+    assert(rows.size() == expected && std::count(rows.begin(), rows.end(), row) == 1);
+
+    expected = 0;
+    for (const order & other : t) { expected += other.quantity == o.quantity; }
+    assert(t.count<3>(o.quantity) == expected);
+  }
+}
+
+/***
+ * tests
+ */
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+  bool ok = true;
+  (void) ok;
+
+  // Basic operations
+  {
+    order_table t;
+    ok = t.insert(order{1, 10.0, "ACME", 5});
+    assert(ok);
+    ok = t.insert(order{2, 11.0, "ACME", 7});
+    assert(ok);
+    ok = t.insert(order{3, 12.0, "INIT", 5});
+    assert(ok);
+    ok = t.insert(order{2, 99.0, "DUPE", 1});  // duplicate id
+    assert(!ok);
+    assert(t.size() == 3 && t.count<2>("DUPE") == 0);
+
+    assert(t.find<0>(2) && t.find<0>(2)->price == 11.0);
+    assert(!t.find<0>(4));
+    assert(t.find_all<2>("ACME").size() == 2);
+    assert(t.count<3>(5) == 2);
+
+    // Updates reindex changed members, and refuse duplicate unique keys
+    ok = t.update(0, order{1, 10.5, "INIT", 5});
+    assert(ok);
+    assert(t.count<2>("ACME") == 1 && t.count<2>("INIT") == 2);
+    ok = t.update(0, order{3, 10.5, "INIT", 5});
+    assert(!ok);
+    assert(t.find<0>(1)->price == 10.5);
+    ok = t.update(0, order{4, 10.5, "INIT", 5});
+    assert(ok);
+    assert(!t.find<0>(1) && t.find<0>(4));
+
+    // Erase moves the last row
+    t.erase(0);
+    assert(t.size() == 2 && t.find_row<0>(3) == 0 && !t.find<0>(4));
+    check(t);
+
+    t.clear();
+    assert(t.empty() && !t.find<0>(3) && t.count<3>(5) == 0);
+  }
+
+  // Random operations against a plain vector
+  {
+    std::mt19937 rng(11);
+    const char * accounts[] = { "A", "B", "C", "D" };
+    order_table t;
+    std::vector<order> reference;
+
+    for (int step = 0; step < 5000; ++step) {
+      const order o{rng() % 500, double(rng() % 100), accounts[rng() % 4], int(rng() % 10)};
+      const auto existing = std::find_if(reference.begin(), reference.end(), [&](const order & r) { return r.id == o.id; });
+      switch (rng() % 3) {
+        case 0: {
+          ok = t.insert(o);
+          assert(ok == (existing == reference.end()));
+          if (existing == reference.end()) { reference.push_back(o); }
+          break;
+        }
+        case 1: {
+          if (reference.empty()) { break; }
+          const std::size_t row = rng() % reference.size();
+          const bool allowed = existing == reference.end() || std::size_t(existing - reference.begin()) == row;
+          ok = t.update(row, o);
+          assert(ok == allowed);
+          if (allowed) { reference[row] = o; }
+          break;
+        }
+        default: {
+          if (reference.empty()) { break; }
+          const std::size_t row = rng() % reference.size();
+          t.erase(row);
+          reference[row] = reference.back();
+          reference.pop_back();
+        }
+      }
+      assert(t.size() == reference.size());
+    }
+
+    for (std::size_t row = 0; row < reference.size(); ++row) { assert(same(t[row], reference[row])); }
+    check(t);
+  }
+}
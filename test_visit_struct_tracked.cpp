@@ -0,0 +1,190 @@
+#include <visit_struct/visit_struct_tracked.hpp>
+
+#include <cassert>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/***
+ * Test structures
+ */
+
+struct replica_state {
+  std::uint64_t counter;
+  double price;
+  std::string venue;
+  std::vector<int> levels;
+  bool halted;
+};
+
+VISITABLE_STRUCT(replica_state, counter, price, venue, levels, halted);
+
+using tracked_state = visit_struct::tracked<replica_state>;
+
+struct book_top {
+  double bids[3];
+  char venue[8];
+  int depth;
+};
+
+VISITABLE_STRUCT(book_top, bids, venue, depth);
+
+static_assert(tracked_state::size == 5, "");
+static_assert(std::is_same<tracked_state::mask_type, std::bitset<5>>::value, "");
+
+struct name_collector {
+  std::vector<std::string> names;
+
+  template <typename T>
+  void operator()(const char * name, const T &) {
+    names.emplace_back(name);
+  }
+};
+
+// Sink which only counts bytes
+struct counting_sink {
+  std::size_t bytes;
+
+  void put(const void *, std::size_t size) { bytes += size; }
+  void put_range(const void *, std::size_t size) { bytes += size; }
+};
+
+int main() {
+  std::cout << __FILE__ << std::endl;
+
+  namespace binary = visit_struct::binary;
+  bool ok = true;
+  (void) ok;
+
+  // Dirty tracking
+  {
+    tracked_state t{replica_state{1, 2.5, "XNYS", {1, 2}, false}};
+    assert(!t.any_dirty());
+
+    t.set<1>(3.5);
+    assert(t.is_dirty(1));
+    assert(t.value().price == 3.5);
+
+    t.field<0>() += 5;
+    ++t.field<0>();
+    assert(t.is_dirty(0));
+    assert(t.get<0>() == 7);
+
+    t.modify<3>().push_back(3);
+    assert(t.is_dirty(3));
+    assert(t.value().levels.size() == 3);
+
+    assert(!t.is_dirty(2));
+    assert(!t.is_dirty(4));
+
+    name_collector vis;
+    t.for_each_dirty(vis);
+    assert((vis.names == std::vector<std::string>{"counter", "price", "levels"}));
+
+    t.clear();
+    assert(!t.any_dirty());
+  }
+
+  // Assignment by name
+  {
+    tracked_state t;
+    ok = t.set("venue", std::string("XLON"));
+    assert(ok);
+    assert(t.value().venue == "XLON");
+    assert(t.is_dirty(2));
+    assert(t.dirty().count() == 1);
+
+    ok = t.set("halted", true);
+    assert(ok);
+    assert(t.is_dirty(4));
+
+    ok = t.set("nonexistent", 5);
+    assert(!ok);
+    ok = t.set("levels", 5);
+    assert(!ok);
+    assert(t.dirty().count() == 2);
+  }
+
+  // Update from a snapshot marks only the members which differ
+  {
+    replica_state s{1, 2.5, "XNYS", {1, 2}, false};
+    tracked_state t{s};
+
+    s.counter = 2;
+    s.halted = true;
+    t.update(s);
+    assert(t.dirty() == tracked_state::mask_type("10001"));
+  }
+
+  // C array members are compared and copied element by element
+  {
+    book_top s{{1.0, 2.0, 3.0}, "XNYS", 3};
+    visit_struct::tracked<book_top> t{s};
+
+    t.update(s);
+    assert(!t.any_dirty());
+
+    s.bids[2] = 3.5;
+    t.update(s);
+    assert(t.dirty() == visit_struct::tracked<book_top>::mask_type("001"));
+    assert(t.value().bids[0] == 1.0 && t.value().bids[2] == 3.5);
+
+    t.clear();
+    s.venue[1] = 'L';
+    t.update(s);
+    assert(t.dirty() == visit_struct::tracked<book_top>::mask_type("010"));
+    assert(std::string(t.value().venue) == "XLYS");
+  }
+
+  // Incremental serialization
+  {
+    replica_state initial{1, 2.5, "XNYS", {1, 2}, false};
+    tracked_state t{initial};
+    replica_state replica = initial;
+
+    ++t.field<0>();
+    t.set<2>(std::string("BATS"));
+
+    std::string full;
+    binary::serialize(t.value(), full);
+
+    std::string delta;
+    binary::serialize_changes(t, delta);
+    assert(delta.size() == 1 + sizeof(std::uint64_t) + sizeof(binary::size_type) + 4);
+    assert(delta.size() < full.size());
+    t.clear();
+
+    tracked_state::mask_type changed;
+    binary::source in{delta.data(), delta.size()};
+    ok = binary::deserialize_changes(in, replica, &changed);
+    assert(ok);
+    assert(!in.remaining());
+    assert(changed == tracked_state::mask_type("00101"));
+    assert(replica.counter == 2);
+    assert(replica.venue == "BATS");
+    assert(replica.price == 2.5);
+
+    // An empty change set is just the mask
+    std::string empty;
+    binary::serialize_changes(t, empty);
+    assert(empty.size() == 1);
+
+    // Any sink can receive a change set
+    ++t.field<0>();
+    counting_sink counter{0};
+    binary::serialize_changes(t, counter);
+    assert(counter.bytes == 1 + sizeof(std::uint64_t));
+    t.clear();
+
+    // Truncated change sets and unknown bits are rejected
+    binary::source truncated{delta.data(), delta.size() - 1};
+    ok = binary::deserialize_changes(truncated, replica);
+    assert(!ok);
+
+    const char bad_mask = static_cast<char>(0x80);
+    binary::source bad{&bad_mask, 1};
+    ok = binary::deserialize_changes(bad, replica);
+    assert(!ok);
+  }
+}